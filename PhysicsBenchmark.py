@@ -0,0 +1,74 @@
+# name: PhysicsBenchmark.py
+#
+# Compares the "lean" physics list against QGSP_BIC_HP: startup time,
+# events per second and agreement of the light response. Run it from
+# the build directory, next to the RMatrixGen executable:
+#
+#   python3 PhysicsBenchmark.py --events 50000
+#
+import argparse
+import re
+import subprocess
+import time
+
+import numpy as np
+
+parser = argparse.ArgumentParser()
+parser.add_argument("--exe", default="./RMatrixGen")
+parser.add_argument("--events", type=int, default=20000)
+parser.add_argument("--seed", type=int, default=12345)
+parser.add_argument("--material", default="EJ301")
+parser.add_argument("--emin", type=float, default=1.)
+parser.add_argument("--emax", type=float, default=5.)
+args = parser.parse_args()
+
+results = {}
+for physics in ["QGSP_BIC_HP", "lean"]:
+    output = "PhysicsBenchmark_" + physics + ".csv"
+    command = [args.exe, "--batch", "-n", str(args.events), "-s", str(args.seed),
+               "-p", physics, "-m", args.material, "-o", output,
+               "--emin", str(args.emin), "--emax", str(args.emax)]
+    start = time.perf_counter()
+    log = subprocess.run(command, capture_output=True, text=True, check=True).stdout
+    total = time.perf_counter() - start
+
+    # The last run printed is the production run
+    run_time = float(re.findall(r"Run time: ([0-9.eE+-]+) s", log)[-1])
+    # Energy, photons and weight; the species and detector columns
+    # that follow are not needed for a neutron source
+    df = np.loadtxt(output, delimiter=";", ndmin=2, usecols=(0, 1, 2))
+    results[physics] = {"startup": total - run_time,
+                        "rate": args.events / run_time,
+                        "energy": df[:, 0],
+                        "photons": df[:, 1],
+                        "weight": df[:, 2]}
+
+# Response agreement: light spectrum per incident energy slice, and a
+# two-sample KS distance on the overall light distribution
+ref = results["QGSP_BIC_HP"]
+lean = results["lean"]
+e_edges = np.linspace(args.emin * 1000, args.emax * 1000, 5)
+l_edges = np.linspace(0, max(ref["photons"].max(), lean["photons"].max()), 51)
+h_ref, _, _ = np.histogram2d(ref["energy"], ref["photons"], [e_edges, l_edges], weights=ref["weight"])
+h_lean, _, _ = np.histogram2d(lean["energy"], lean["photons"], [e_edges, l_edges], weights=lean["weight"])
+filled = (h_ref + h_lean) > 0
+chi2 = np.sum((h_ref - h_lean)[filled] ** 2 / (h_ref + h_lean)[filled])
+
+def ks_distance(a, b):
+    grid = np.sort(np.concatenate([a, b]))
+    cdf_a = np.searchsorted(np.sort(a), grid, side="right") / len(a)
+    cdf_b = np.searchsorted(np.sort(b), grid, side="right") / len(b)
+    return np.max(np.abs(cdf_a - cdf_b))
+
+print("%-12s %12s %12s %14s" % ("physics", "startup [s]", "events/s", "events w/ light"))
+for physics, r in results.items():
+    print("%-12s %12.2f %12.1f %14d" % (physics, r["startup"], r["rate"], len(r["photons"])))
+print("\nStartup speedup: %.2fx, throughput speedup: %.2fx"
+      % (ref["startup"] / lean["startup"], lean["rate"] / ref["rate"]))
+print("Response chi2/ndf: %.2f (%d bins)" % (chi2 / max(filled.sum(), 1), filled.sum()))
+print("Light KS distance: %.4f" % ks_distance(ref["photons"], lean["photons"]))
+for i in range(len(e_edges) - 1):
+    in_ref = (ref["energy"] >= e_edges[i]) & (ref["energy"] < e_edges[i + 1])
+    in_lean = (lean["energy"] >= e_edges[i]) & (lean["energy"] < e_edges[i + 1])
+    print("  %5.0f-%5.0f keV: mean light %8.1f vs %8.1f photons"
+          % (e_edges[i], e_edges[i + 1], ref["photons"][in_ref].mean(), lean["photons"][in_lean].mean()))
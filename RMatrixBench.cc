@@ -0,0 +1,333 @@
+/*
+#############################################################################
+
+RMatrixBench
+
+Runs RMatrixGen on a fixed set of reference scenarios so that builds and
+nodes can be compared on the same work.  Every scenario sets its whole
+configuration, uses the same run seed and per-event seeding, runs once
+to warm up (geometry, materials and physics tables for the scenario are
+built then) and is then timed over several repetitions of the same
+events.  No event data is written.
+
+Scenarios:
+  EJ301        1" x 1" EJ301, 1-5 MeV neutrons
+  EJ309        1" x 1" EJ309, 1-5 MeV neutrons
+  LaBr3_gamma  1" x 1" LaBr3, 0.1-3 MeV gammas, gammas tracked
+  EJ301_large  5" x 5" EJ301, 1-5 MeV neutrons
+
+Usage:
+
+  RMatrixBench [options]
+
+Options:
+  -t, --threads N       number of worker threads (1 runs sequentially)
+  -n, --events N        events per repetition (default: per scenario)
+  -w, --warmup N        warm-up events per scenario (default: 10% of events)
+  -r, --repetitions N   timed repetitions per scenario (default: 3)
+  --scenario NAME       only run this scenario (may be repeated)
+  -p, --physics NAME    physics list (QGSP_BIC_HP or lean)
+  --em-option N         standard EM option of the lean list (0, 1, 3 or 4)
+  -o, --output FILE     summary file (default: RMatrixBench.csv)
+  --pin-threads         pin each worker thread to its own CPU
+  --numa                spread pinned workers over the NUMA nodes
+
+The summary has one ';' separated line per scenario: startup time of
+the application, warm-up time, mean and fastest repetition, events/s
+and optical photons/s (mean and standard deviation over repetitions)
+and the peak resident memory during the scenario.  The peak is reset
+through /proc/self/clear_refs before each scenario on Linux; elsewhere
+it is the peak of the process so far.
+############################################################################
+*/
+
+// G4 Header Files
+#include "G4RunManager.hh"
+#include "G4UImanager.hh"
+#include "Randomize.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+
+// User Header Files
+#include "runSetup.hh"
+#include "progressMonitor.hh"
+#include "workerInitialization.hh"
+
+namespace
+{
+  // Seeds are pinned so that every build and node runs the same events
+  const G4long benchSeed = 20240816;
+
+  struct benchScenario
+  {
+    G4String name;
+    G4int events;
+    std::vector<G4String> commands;
+  };
+
+  std::vector<benchScenario> ReferenceScenarios()
+  {
+    // Everything a scenario depends on is set by each one, so that they
+    // do not inherit settings from the one before
+    std::vector<G4String> neutronSource = runSetup::PlaneSourceCommands();
+    std::vector<G4String> gammaSource = neutronSource;
+    neutronSource.insert(neutronSource.end(), {
+      "/gps/particle neutron",
+      "/gps/ene/min 1. MeV",
+      "/gps/ene/max 5. MeV",
+      "/RMatrix/stack/trackGammas off"
+    });
+    gammaSource.insert(gammaSource.end(), {
+      "/gps/particle gamma",
+      "/gps/ene/min 0.1 MeV",
+      "/gps/ene/max 3. MeV",
+      "/RMatrix/stack/trackGammas on"
+    });
+
+    std::vector<G4String> oneInch = {
+      "/RMatrix/geometry/setRadius 1.27 cm",
+      "/RMatrix/geometry/setHalfLength 1.27 cm"
+    };
+    std::vector<G4String> fiveInch = {
+      "/RMatrix/geometry/setRadius 6.35 cm",
+      "/RMatrix/geometry/setHalfLength 6.35 cm"
+    };
+
+    std::vector<benchScenario> scenarios = {
+      {"EJ301", 20000, {"/RMatrix/geometry/setMaterial EJ301"}},
+      {"EJ309", 20000, {"/RMatrix/geometry/setMaterial EJ309"}},
+      {"LaBr3_gamma", 5000, {"/RMatrix/geometry/setMaterial LanthanumBromide"}},
+      {"EJ301_large", 5000, {"/RMatrix/geometry/setMaterial EJ301"}}
+    };
+
+    for(benchScenario &scenario : scenarios){
+      const std::vector<G4String> &size = (scenario.name == "EJ301_large") ? fiveInch : oneInch;
+      const std::vector<G4String> &source = (scenario.name == "LaBr3_gamma") ? gammaSource : neutronSource;
+      scenario.commands.insert(scenario.commands.end(), size.begin(), size.end());
+      scenario.commands.insert(scenario.commands.end(), source.begin(), source.end());
+    }
+    return scenarios;
+  }
+
+  G4double Seconds(std::chrono::steady_clock::time_point start)
+  {
+    return std::chrono::duration<G4double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  // Starts a new peak resident memory (VmHWM) for the process, if the
+  // kernel allows it
+  void ResetPeakMemory()
+  {
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+  }
+
+  G4double PeakMemoryMB()
+  {
+    std::ifstream status("/proc/self/status");
+    std::string key;
+    while(status >> key){
+      if(key == "VmHWM:"){
+	G4double kB;
+	if(status >> kB)
+	  return kB/1024.;
+	break;
+      }
+      status.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+
+    rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0)
+      return 0.;
+#ifdef __APPLE__
+    return usage.ru_maxrss/1048576.;
+#else
+    return usage.ru_maxrss/1024.;
+#endif
+  }
+
+  void MeanAndDeviation(const std::vector<G4double> &values, G4double &mean, G4double &deviation)
+  {
+    mean = 0.;
+    for(G4double value : values)
+      mean += value;
+    mean /= std::max<std::size_t>(values.size(), 1);
+
+    deviation = 0.;
+    for(G4double value : values)
+      deviation += (value - mean)*(value - mean);
+    deviation = (values.size() > 1) ? std::sqrt(deviation/(values.size() - 1)) : 0.;
+  }
+
+  void PrintUsage()
+  {
+    G4cerr << "Usage: RMatrixBench [-t threads] [-n events] [-w warmup] [-r repetitions]\n"
+	   << "                    [--scenario NAME ...] [-p physicsList] [--em-option N]\n"
+	   << "                    [-o summary.csv] [--pin-threads] [--numa]"
+	   << G4endl;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+  G4int nThreads = 1;
+  G4int nEvents = 0;
+  G4int nWarmup = -1;
+  G4int nRepetitions = 3;
+  G4String physics = "";
+  G4int emOption = -1;
+  G4String summaryFile = "RMatrixBench.csv";
+  G4bool pinThreads = false;
+  G4bool numaPlacement = false;
+  std::vector<G4String> selected;
+
+  try{
+    for(G4int i=1; i<argc; i++){
+      G4String arg = argv[i];
+      G4bool hasValue = (i+1 < argc);
+
+      if((arg == "-t" or arg == "--threads") and hasValue)
+	nThreads = std::stoi(argv[++i]);
+      else if((arg == "-n" or arg == "--events") and hasValue)
+	nEvents = std::stoi(argv[++i]);
+      else if((arg == "-w" or arg == "--warmup") and hasValue)
+	nWarmup = std::stoi(argv[++i]);
+      else if((arg == "-r" or arg == "--repetitions") and hasValue)
+	nRepetitions = std::stoi(argv[++i]);
+      else if(arg == "--scenario" and hasValue)
+	selected.push_back(argv[++i]);
+      else if((arg == "-p" or arg == "--physics") and hasValue)
+	physics = argv[++i];
+      else if(arg == "--em-option" and hasValue)
+	emOption = std::stoi(argv[++i]);
+      else if((arg == "-o" or arg == "--output") and hasValue)
+	summaryFile = argv[++i];
+      else if(arg == "--pin-threads")
+	pinThreads = true;
+      else if(arg == "--numa")
+	numaPlacement = true;
+      else if(arg == "-h" or arg == "--help"){
+	PrintUsage();
+	return 0;
+      }
+      else{
+	G4cerr << "RMatrixBench: unrecognised or incomplete option '" << arg << "'" << G4endl;
+	PrintUsage();
+	return 1;
+      }
+    }
+  }
+  catch(const std::exception &){
+    G4cerr << "RMatrixBench: invalid numeric option value" << G4endl;
+    PrintUsage();
+    return 1;
+  }
+
+  std::vector<benchScenario> scenarios;
+  for(const benchScenario &scenario : ReferenceScenarios())
+    if(selected.empty() or std::find(selected.begin(), selected.end(), scenario.name) != selected.end())
+      scenarios.push_back(scenario);
+  if(scenarios.empty() or nRepetitions < 1){
+    G4cerr << "RMatrixBench: nothing to run" << G4endl;
+    return 1;
+  }
+
+  CLHEP::HepRandom::setTheSeed(benchSeed);
+
+  // The same set up as RMatrixGen
+  workerInitialization::SetPinThreads(pinThreads);
+  workerInitialization::SetNUMAPlacement(numaPlacement);
+  G4RunManager* runManager = runSetup::CreateRunManager(nThreads, physics, emOption);
+  runManager -> Initialize();
+  G4UImanager* UI = G4UImanager::GetUIpointer();
+
+  G4double startupTime = Seconds(startTime);
+  workerInitialization::ReportPlacement();
+
+  UI -> ApplyCommand("/control/verbose 0");
+  UI -> ApplyCommand("/run/verbose 0");
+  UI -> ApplyCommand("/event/verbose 0");
+  UI -> ApplyCommand("/tracking/verbose 0");
+  UI -> ApplyCommand("/gps/verbose 0");
+  UI -> ApplyCommand("/RMatrix/output/setDataOutput off");
+  UI -> ApplyCommand("/RMatrix/random/perEventSeeding on");
+  UI -> ApplyCommand("/RMatrix/random/setRunSeed " + std::to_string(benchSeed));
+
+  // Photons are counted by the progress monitor; an interval longer
+  // than any run leaves a single report at the end of each
+  UI -> ApplyCommand("/RMatrix/progress/setInterval 3600 s");
+
+  std::ofstream summary(summaryFile.c_str());
+  summary << "Scenario;Threads;Pinning;Events;Repetitions;Startup_s;Warmup_s;Seconds_mean;Seconds_min;"
+	  << "EventsPerSecond_mean;EventsPerSecond_std;PhotonsPerSecond_mean;PhotonsPerSecond_std;PeakRSS_MB\n";
+
+  G4cout << "\n *********** RMatrixBench *************"
+	 << "\n Startup: " << startupTime << " s, " << nThreads << " thread(s)" << G4endl;
+
+  for(const benchScenario &scenario : scenarios){
+    ResetPeakMemory();
+    for(const G4String &command : scenario.commands)
+      UI -> ApplyCommand(command);
+
+    G4int events = (nEvents > 0) ? nEvents : scenario.events;
+    G4int warmup = (nWarmup >= 0) ? nWarmup : std::max(events/10, 1);
+
+    // The warm-up also pays for rebuilding the geometry and physics
+    // tables after the scenario's changes
+    std::chrono::steady_clock::time_point warmupStart = std::chrono::steady_clock::now();
+    if(warmup > 0){
+      UI -> ApplyCommand("/RMatrix/random/setEventOffset 0");
+      runManager -> BeamOn(warmup);
+    }
+    G4double warmupTime = Seconds(warmupStart);
+
+    // Every repetition runs the very same events
+    std::vector<G4double> times, eventRates, photonRates;
+    for(G4int repetition=0; repetition<nRepetitions; repetition++){
+      UI -> ApplyCommand("/RMatrix/random/setEventOffset 0");
+      std::chrono::steady_clock::time_point runStart = std::chrono::steady_clock::now();
+      runManager -> BeamOn(events);
+      G4double runTime = std::max(Seconds(runStart), 1e-9);
+
+      times.push_back(runTime);
+      eventRates.push_back(progressMonitor::GetEventsDone()/runTime);
+      photonRates.push_back(progressMonitor::GetPhotons()/runTime);
+    }
+
+    G4double eventRate, eventDeviation, photonRate, photonDeviation, meanTime, timeDeviation;
+    MeanAndDeviation(eventRates, eventRate, eventDeviation);
+    MeanAndDeviation(photonRates, photonRate, photonDeviation);
+    MeanAndDeviation(times, meanTime, timeDeviation);
+    G4double minTime = *std::min_element(times.begin(), times.end());
+    G4double peakMemory = PeakMemoryMB();
+
+    G4cout << "\n Scenario " << scenario.name << ": " << events << " events x " << nRepetitions
+	   << "\n   warm-up " << warmupTime << " s, run " << meanTime << " s (fastest " << minTime << " s)"
+	   << "\n   " << eventRate << " +- " << eventDeviation << " events/s, "
+	   << photonRate << " +- " << photonDeviation << " photons/s"
+	   << "\n   peak RSS " << peakMemory << " MB" << G4endl;
+
+    summary << scenario.name << ";" << nThreads << ";"
+	    << (numaPlacement ? "numa" : (pinThreads ? "pinned" : "none")) << ";" << events << ";" << nRepetitions << ";"
+	    << startupTime << ";" << warmupTime << ";" << meanTime << ";" << minTime << ";"
+	    << eventRate << ";" << eventDeviation << ";" << photonRate << ";" << photonDeviation << ";"
+	    << peakMemory << "\n";
+  }
+
+  G4cout << "\n Summary written to " << summaryFile << G4endl;
+
+  delete runManager;
+
+  return 0;
+}
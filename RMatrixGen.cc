@@ -22,6 +22,37 @@ Much of the geometry specification code is adapted from a code written by
 Zach Hartwig (ScintEval), which uses ASIM to model detector response, and 
 the efficiency calculations for neutron spectrum unfolding are intended to
 be generated by that code. 
+
+Usage:
+
+  RMatrixGen                      interactive session with visualization
+  RMatrixGen [options] macro.mac  execute a macro without visualization
+  RMatrixGen --batch [options]    run without any macro, UI or visualization
+  RMatrixGen -server [socket]     serve jobs over a socket (or stdin)
+
+Options:
+  -b, --batch          run the default plane source directly
+  -n, --events N       number of events for --batch runs
+  -t, --threads N      number of worker threads (1 runs sequentially)
+  -s, --seed S         seed for the RNG (default: current time)
+  -0                   keep the default CLHEP seed
+  --first-event N      global number of the first event, to run one shard
+                       of a larger job or re-run a single event
+  -o, --output FILE    write event data to FILE
+  --emin E, --emax E   neutron energy range in MeV (default: 1 to 5)
+  -m, --material NAME  scintillator material (EJ301, EJ309, LanthanumBromide)
+  -p, --physics NAME   physics list (QGSP_BIC_HP or lean)
+  --em-option N        standard EM option of the lean list (0, 1, 3 or 4)
+  --fast-response TABLE
+                       use the neutron response table TABLE instead of
+                       transport in the scintillator (fast mode, which
+                       has to be chosen before the physics is built)
+  --pin-threads        pin each worker thread to its own CPU
+  --numa               spread pinned workers over the NUMA nodes and
+                       allocate their memory locally (implies pinning)
+
+Options are applied before a macro is executed, so a macro can still
+override them.
 ############################################################################
 */
 
@@ -41,61 +72,174 @@ be generated by that code.
 #include <iostream>
 
 // User Header Files
-#include "geometryConstruction.hh"
-#include "PGA.hh"
-#include "runAction.hh"
-#include "eventAction.hh"
-#include "stackingAction.hh"
-#include "PhysicsList.hh"
+#include "runSetup.hh"
+#include "neutronResponseModel.hh"
+#include "RMatrixServer.hh"
+#include "workerInitialization.hh"
+
+namespace
+{
+  void PrintUsage()
+  {
+    G4cerr << "Usage: RMatrixGen [-b] [-n events] [-t threads] [-s seed | -0]\n"
+	   << "                  [--first-event N]\n"
+	   << "                  [-o output] [--emin MeV] [--emax MeV] [-m material]\n"
+	   << "                  [-p physicsList] [--em-option N] [--fast-response table]\n"
+	   << "                  [--pin-threads] [--numa]\n"
+	   << "                  [macro.mac]\n"
+	   << "       RMatrixGen -server [socketPath]" << G4endl;
+  }
+}
 
 int main(int argc, char *argv[])
 {
-  // Use the current time to seed the RNG unless overridden 
-  if(argc>1){
-    std::string arg1 = argv[1];
-    if(arg1 != "-0")
-      CLHEP::HepRandom::setTheSeed(time(0));
+  // Read the command line.  Anything that is not an option is taken
+  // to be the macro to execute
+  G4bool batchMode = false;
+  G4bool serverMode = false;
+  G4bool defaultSeed = false;
+  G4bool seedGiven = false;
+  G4bool pinThreads = false;
+  G4bool numaPlacement = false;
+  G4long seed = time(0);
+  G4long firstEvent = -1;
+  G4int nEvents = 0;
+  G4int nThreads = 1;
+  G4double eMin = -1.;
+  G4double eMax = -1.;
+  G4String serverPath = "-";
+  G4String macroFile = "";
+  G4String outputFile = "";
+  G4String material = "";
+  G4String physics = "";
+  G4int emOption = -1;
+  G4String fastResponseTable = "";
+
+  try{
+    for(G4int i=1; i<argc; i++){
+      G4String arg = argv[i];
+      G4bool hasValue = (i+1 < argc);
+
+      if(arg == "-0")
+	defaultSeed = true;
+      else if(arg == "-server"){
+	serverMode = true;
+	if(hasValue and (argv[i+1][0] != '-' or G4String(argv[i+1]) == "-"))
+	  serverPath = argv[++i];
+      }
+      else if(arg == "-b" or arg == "--batch")
+	batchMode = true;
+      else if((arg == "-n" or arg == "--events") and hasValue)
+	nEvents = std::stoi(argv[++i]);
+      else if((arg == "-t" or arg == "--threads") and hasValue)
+	nThreads = std::stoi(argv[++i]);
+      else if((arg == "-s" or arg == "--seed") and hasValue){
+	seed = std::stol(argv[++i]);
+	seedGiven = true;
+      }
+      else if(arg == "--first-event" and hasValue)
+	firstEvent = std::stol(argv[++i]);
+      else if((arg == "-o" or arg == "--output") and hasValue)
+	outputFile = argv[++i];
+      else if(arg == "--emin" and hasValue)
+	eMin = std::stod(argv[++i]);
+      else if(arg == "--emax" and hasValue)
+	eMax = std::stod(argv[++i]);
+      else if((arg == "-m" or arg == "--material") and hasValue)
+	material = argv[++i];
+      else if((arg == "-p" or arg == "--physics") and hasValue)
+	physics = argv[++i];
+      else if(arg == "--em-option" and hasValue)
+	emOption = std::stoi(argv[++i]);
+      else if(arg == "--fast-response" and hasValue)
+	fastResponseTable = argv[++i];
+      else if(arg == "--pin-threads")
+	pinThreads = true;
+      else if(arg == "--numa")
+	numaPlacement = true;
+      else if(arg == "-h" or arg == "--help"){
+	PrintUsage();
+	return 0;
+      }
+      else if(arg[0] != '-' and macroFile == "")
+	macroFile = arg;
+      else{
+	G4cerr << "RMatrixGen: unrecognised or incomplete option '" << arg << "'" << G4endl;
+	PrintUsage();
+	return 1;
+      }
+    }
+  }
+  catch(const std::exception &){
+    G4cerr << "RMatrixGen: invalid numeric option value" << G4endl;
+    PrintUsage();
+    return 1;
   }
-  // Create a runManager to handle the flow of operations in the program.  
-  G4RunManager* runManager = new G4RunManager;
 
-  // Create new "mandatory defined" class objects and tell the
-  // runManager to initialize them for use
-  runManager -> SetUserInitialization(new geometryConstruction);
-  // new physics list with individual lists registered for different processes
-  // QBBC* physicsList = new QBBC; //QBBC is the recommended list for thin target high precision modelling
-   PhysicsList *physicsList = new PhysicsList();
+  if(physics == "lean" and eMax > 20.){
+    G4cerr << "RMatrixGen: the lean physics list only covers neutrons up to 20 MeV" << G4endl;
+    return 1;
+  }
 
-  runManager -> SetUserInitialization(physicsList->GetPhysicsList());
-  
-  runManager -> SetUserAction(new PGA);
-  
-  runAction *rnAction = new runAction;
-  runManager -> SetUserAction(rnAction);
+  if(batchMode and macroFile == "" and nEvents <= 0){
+    G4cerr << "RMatrixGen: --batch without a macro needs --events N" << G4endl;
+    return 1;
+  }
 
-  // Create new "user defined" class objects and tell the runManager
-  // to initialize them for use
-  eventAction *evtAction = new eventAction();
-  runManager -> SetUserAction(evtAction);  
+  G4bool interactive = (!batchMode and !serverMode and macroFile == "");
 
-  stackingAction *stackAction = new stackingAction(evtAction);
-  runManager -> SetUserAction(stackAction);
+  // Use the current time to seed the RNG unless overridden 
+  if(seedGiven or (argc > 1 and !defaultSeed))
+    CLHEP::HepRandom::setTheSeed(seed);
+
+  // Fast simulation is only registered for a fast response run
+  if(fastResponseTable != ""){
+    neutronResponseModel::SetTableFile(fastResponseTable);
+    neutronResponseModel::SetMode("fast");
+  }
+
+  // Create a runManager to handle the flow of operations in the
+  // program, with the geometry, physics list and user actions
+  workerInitialization::SetPinThreads(pinThreads);
+  workerInitialization::SetNUMAPlacement(numaPlacement);
+  G4RunManager* runManager = runSetup::CreateRunManager(nThreads, physics, emOption);
+
+  // The geometry is cheapest to change before it is first built
+  G4UImanager* UI = G4UImanager::GetUIpointer();
+  if(material != "")
+    UI -> ApplyCommand("/RMatrix/geometry/setMaterial " + material);
   
   runManager -> Initialize();
-  
-  // If the shell variable for visualization use is set, then create a
-  // manager to handle the visualization processes  
-  G4VisManager* visManager = new G4VisExecutive("errors");
-  visManager -> Initialize();
-  G4TrajectoryDrawByParticleID* model = new G4TrajectoryDrawByParticleID;
-  visManager->RegisterModel(model);
-  visManager->SelectTrajectoryModel(model->Name());
-
-  // Get the U(ser)I(interface) pointer to allow...*suspense*
-  // ...user interface!
-  G4UImanager* UI = G4UImanager::GetUIpointer();
-  if (argc == 1)
+
+  // The workers have started by now
+  workerInitialization::ReportPlacement();
+
+  if(firstEvent >= 0)
+    UI -> ApplyCommand("/RMatrix/random/setEventOffset " + std::to_string(firstEvent));
+
+  // In server mode the initialized physics is kept alive and jobs are
+  // taken from a client (socket path, or stdin if none is given)
+  // rather than from a single macro
+  if(serverMode){
+    RMatrixServer server;
+    server.Start(serverPath);
+
+    delete runManager;
+    return 0;
+  }
+
+  if(interactive)
   {
+    // Visualization is only needed for the interactive session, so
+    // batch jobs never touch the display stack
+    G4VisManager* visManager = new G4VisExecutive("errors");
+    visManager -> Initialize();
+    G4TrajectoryDrawByParticleID* model = new G4TrajectoryDrawByParticleID;
+    visManager->RegisterModel(model);
+    visManager->SelectTrajectoryModel(model->Name());
+
+    // Get the U(ser)I(interface) pointer to allow...*suspense*
+    // ...user interface!
     // Create a modern UI interface with embedded OpenGL graphics
     G4UIExecutive *UIExecutive = new G4UIExecutive(argc, argv, "Qt");
     UI-> ApplyCommand("/control/execute RMatrixGen.vis"); 
@@ -111,24 +255,38 @@ int main(int argc, char *argv[])
     // "new".  This is good memory management
 
     delete UIExecutive;
-    delete UI;
+    delete visManager;
+    delete runManager;
+    return 0;
+  }
+
+  // Without a macro, set up the same plane source as ParticleGun.mac
+  if(macroFile == ""){
+    UI -> ApplyCommand("/gps/verbose 0");
+    for(const G4String &command : runSetup::PlaneSourceCommands())
+      UI -> ApplyCommand(command);
+    UI -> ApplyCommand("/gps/particle neutron");
+    if(eMin < 0.) eMin = 1.;
+    if(eMax < 0.) eMax = 5.;
   }
-  else{
+  if(eMin >= 0.)
+    UI -> ApplyCommand("/gps/ene/min " + std::to_string(eMin) + " MeV");
+  if(eMax >= 0.)
+    UI -> ApplyCommand("/gps/ene/max " + std::to_string(eMax) + " MeV");
+
+  if(outputFile != "")
+    UI -> ApplyCommand("/RMatrix/output/setFileName " + outputFile);
+  if(outputFile != "" or macroFile == "")
+    UI -> ApplyCommand("/RMatrix/output/setDataOutput on");
+
+  if(macroFile != ""){
     G4String command = "/control/execute ";
-    G4String fileName;
-    if (argc ==2){
-      fileName = argv[1];
-      }
-    else{
-       fileName = argv[2];
-      }
-    
-    UI->ApplyCommand(command+fileName);
+    UI->ApplyCommand(command+macroFile);
   }
+  else
+    UI -> ApplyCommand("/run/beamOn " + std::to_string(nEvents));
 
-  delete visManager;
   delete runManager;
   
   return 0;
 }
-
@@ -0,0 +1,263 @@
+/*
+#############################################################################
+
+RMatrixMPI
+
+Runs one RMatrixGen job over several MPI ranks (nodes), each of them
+multithreaded, and writes a single set of response matrices from rank 0.
+Built with -DWITH_MPI=ON, on top of Geant4's G4mpi library.
+
+The job's events are handed out in blocks: every rank takes the next
+block from a shared counter on rank 0 as soon as it is done with its
+previous one, so faster or less loaded nodes simply run more blocks.
+With per-event seeding (forced on) an event draws the same random
+stream whichever rank runs it, so the result does not depend on the
+number of ranks or on how the blocks fell.  Each rank adds its blocks
+up in memory; at the end the response matrices, the detector array
+tallies and the run counters of all ranks are summed onto rank 0,
+which prints and writes them as RMatrixGen would.  There are no
+per-rank files and nothing to merge afterwards.
+
+Usage:
+
+  mpirun -np R RMatrixMPI [options] -n N macro.mac
+
+The macro sets up the source, geometry and matrix binning on every rank
+and must not start runs itself.  Per-event data output, the response
+model, light collection map and step profile are not reduced across
+ranks; run those with RMatrixGen.
+
+Options:
+  -n, --events N       number of events of the whole job
+  -t, --threads N      worker threads per rank (1 runs sequentially)
+  -s, --seed S         run seed (default: current time on rank 0)
+  --block N            events per block (default: N/(16*R), at least 1)
+  -p, --physics NAME   physics list (QGSP_BIC_HP or lean)
+  --em-option N        standard EM option of the lean list (0, 1, 3 or 4)
+############################################################################
+*/
+
+// G4 Header Files
+#include "G4RunManager.hh"
+#include "G4UImanager.hh"
+#include "G4MPImanager.hh"
+#include "Randomize.hh"
+
+#include <mpi.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+// User Header Files
+#include "runSetup.hh"
+#include "runAction.hh"
+#include "eventAction.hh"
+#include "neutronResponseModel.hh"
+#include "lightCollectionMap.hh"
+#include "stepProfile.hh"
+
+namespace
+{
+  void PrintUsage()
+  {
+    G4cerr << "Usage: mpirun -np R RMatrixMPI [-t threads] [-s seed] [--block N]\n"
+	   << "                              [-p physicsList] [--em-option N] -n events macro.mac" << G4endl;
+  }
+
+  // First event of the next free block, from the counter on rank 0
+  long NextBlock(MPI_Win counter, long blockSize)
+  {
+    long first = 0;
+    MPI_Win_lock(MPI_LOCK_SHARED, 0, 0, counter);
+    MPI_Fetch_and_op(&blockSize, &first, MPI_LONG, 0, 0, MPI_SUM, counter);
+    MPI_Win_unlock(0, counter);
+    return first;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  // G4MPImanager starts MPI.  It reads its own options from the command
+  // line and stops at any other, so it is only given the program name
+  int mpiArgc = 1;
+  G4MPImanager *g4MPI = new G4MPImanager(mpiArgc, argv);
+  G4int rank = g4MPI -> GetRank();
+  G4int nRanks = g4MPI -> GetSize();
+
+  G4long seed = time(0);
+  G4long nEvents = 0;
+  G4long blockSize = 0;
+  G4int nThreads = 1;
+  G4String macroFile = "";
+  G4String physics = "";
+  G4int emOption = -1;
+
+  // Every rank reads the same command line and comes to the same
+  // conclusion, so only rank 0 complains
+  G4bool badOptions = false;
+  try{
+    for(G4int i=1; i<argc; i++){
+      G4String arg = argv[i];
+      G4bool hasValue = (i+1 < argc);
+
+      if((arg == "-n" or arg == "--events") and hasValue)
+	nEvents = std::stol(argv[++i]);
+      else if((arg == "-t" or arg == "--threads") and hasValue)
+	nThreads = std::stoi(argv[++i]);
+      else if((arg == "-s" or arg == "--seed") and hasValue)
+	seed = std::stol(argv[++i]);
+      else if(arg == "--block" and hasValue)
+	blockSize = std::stol(argv[++i]);
+      else if((arg == "-p" or arg == "--physics") and hasValue)
+	physics = argv[++i];
+      else if(arg == "--em-option" and hasValue)
+	emOption = std::stoi(argv[++i]);
+      else if(arg[0] != '-' and macroFile == "")
+	macroFile = arg;
+      else{
+	if(rank == 0)
+	  G4cerr << "RMatrixMPI: unrecognised or incomplete option '" << arg << "'" << G4endl;
+	badOptions = true;
+	break;
+      }
+    }
+  }
+  catch(const std::exception &){
+    if(rank == 0)
+      G4cerr << "RMatrixMPI: invalid numeric option value" << G4endl;
+    badOptions = true;
+  }
+
+  if(!badOptions and (nEvents <= 0 or macroFile == "")){
+    if(rank == 0)
+      G4cerr << "RMatrixMPI: needs --events N and a macro" << G4endl;
+    badOptions = true;
+  }
+
+  if(badOptions){
+    if(rank == 0)
+      PrintUsage();
+    delete g4MPI;
+    return 1;
+  }
+
+  if(blockSize <= 0)
+    blockSize = std::max<G4long>(nEvents/(16*nRanks), 1);
+
+  // All ranks share rank 0's run seed, so that event n is the same
+  // event wherever it runs
+  long runSeed = seed;
+  MPI_Bcast(&runSeed, 1, MPI_LONG, 0, MPI_COMM_WORLD);
+  CLHEP::HepRandom::setTheSeed(runSeed);
+
+  // The same set up as RMatrixGen, on every rank
+  G4RunManager* runManager = runSetup::CreateRunManager(nThreads, physics, emOption);
+  runManager -> Initialize();
+  G4UImanager* UI = G4UImanager::GetUIpointer();
+
+  if(rank != 0){
+    UI -> ApplyCommand("/control/verbose 0");
+    UI -> ApplyCommand("/run/verbose 0");
+  }
+  UI -> ApplyCommand("/control/execute " + macroFile);
+
+  // What the job reduces, whatever the macro asked for
+  UI -> ApplyCommand("/RMatrix/response/matrixOutput on");
+  UI -> ApplyCommand("/RMatrix/random/perEventSeeding on");
+  UI -> ApplyCommand("/RMatrix/random/setRunSeed " + std::to_string(runSeed));
+
+  if(eventAction::GetDataOutput()){
+    UI -> ApplyCommand("/RMatrix/output/setDataOutput off");
+    if(rank == 0)
+      G4cerr << "RMatrixMPI: per-event data output is turned off, only the matrices are written" << G4endl;
+  }
+  if(rank == 0 and (neutronResponseModel::GetMode() == neutronResponseModel::responseTrain
+		    or neutronResponseModel::GetMode() == neutronResponseModel::responseCompare
+		    or lightCollectionMap::GetMode() == lightCollectionMap::collectionCalibrate
+		    or stepProfile::IsEnabled()))
+    G4cerr << "RMatrixMPI: response tables, light collection maps and step profiles"
+	   << " are not reduced across ranks" << G4endl;
+
+  runAction *rnAction = const_cast<runAction *>
+    (static_cast<const runAction *>(runManager->GetUserRunAction()));
+
+  // The block counter lives on rank 0.  Rank 0 always runs the first
+  // block, so its tallies are binned even if the others are quicker
+  long nextEvent = blockSize;
+  MPI_Win counter;
+  MPI_Win_create((rank == 0) ? &nextEvent : nullptr, (rank == 0) ? sizeof(long) : 0,
+		 sizeof(long), MPI_INFO_NULL, MPI_COMM_WORLD, &counter);
+
+  G4double startTime = MPI_Wtime();
+  long eventsDone = 0;
+  long blocksDone = 0;
+
+  runAction::SetBlockMode(true);
+  long first = (rank == 0) ? 0 : NextBlock(counter, blockSize);
+  while(first < nEvents){
+    G4int count = G4int(std::min<G4long>(blockSize, nEvents - first));
+    UI -> ApplyCommand("/RMatrix/random/setEventOffset " + std::to_string(first));
+    runManager -> BeamOn(count);
+
+    eventsDone += count;
+    blocksDone++;
+    first = NextBlock(counter, blockSize);
+  }
+  runAction::SetBlockMode(false);
+
+  G4double rankTime = MPI_Wtime() - startTime;
+  MPI_Win_free(&counter);
+
+  // Reduce onto rank 0.  A rank that got no block sends zeros; the
+  // others must have binned their tallies as rank 0 did
+  std::vector<G4double> tallies;
+  if(blocksDone > 0)
+    tallies = rnAction -> PackTallies();
+
+  unsigned long talliesSize = tallies.size();
+  MPI_Bcast(&talliesSize, 1, MPI_UNSIGNED_LONG, 0, MPI_COMM_WORLD);
+
+  int mismatch = (blocksDone > 0 and tallies.size() != talliesSize);
+  MPI_Allreduce(MPI_IN_PLACE, &mismatch, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+  if(mismatch){
+    if(rank == 0)
+      G4cerr << "RMatrixMPI: the ranks did not bin their tallies alike;"
+	     << " the macro has to configure every rank the same way" << G4endl;
+    delete runManager;
+    delete g4MPI;
+    return 1;
+  }
+
+  tallies.resize(talliesSize, 0.);
+  MPI_Reduce((rank == 0) ? MPI_IN_PLACE : tallies.data(), tallies.data(), G4int(talliesSize),
+	     MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+
+  // Share of the work per rank, to show how the load was balanced
+  long rankCounts[2] = {eventsDone, blocksDone};
+  std::vector<long> counts((rank == 0) ? 2*nRanks : 0);
+  std::vector<G4double> times((rank == 0) ? nRanks : 0);
+  MPI_Gather(rankCounts, 2, MPI_LONG, counts.data(), 2, MPI_LONG, 0, MPI_COMM_WORLD);
+  MPI_Gather(&rankTime, 1, MPI_DOUBLE, times.data(), 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+  if(rank == 0){
+    G4double jobTime = std::max(MPI_Wtime() - startTime, 1e-9);
+    G4cout << "\n *********** RMatrixMPI *************"
+	   << "\n " << nEvents << " events on " << nRanks << " rank(s) x " << nThreads
+	   << " thread(s) in blocks of " << blockSize
+	   << "\n Job time: " << jobTime << " s, " << nEvents/jobTime << " events/s"
+	   << "\n   rank     events   blocks   time [s]" << G4endl;
+    for(G4int r=0; r<nRanks; r++)
+      G4cout << "   " << std::setw(4) << r << "  " << std::setw(9) << counts[2*r]
+	     << "  " << std::setw(7) << counts[2*r+1] << "  " << std::setw(9) << times[r] << G4endl;
+
+    rnAction -> UnpackTallies(tallies);
+    rnAction -> ReportTallies(G4int(nEvents));
+  }
+
+  delete runManager;
+  delete g4MPI;
+
+  return 0;
+}
@@ -3,12 +3,14 @@ import matplotlib.pyplot as plt
 import numpy as np
 from matplotlib import cm
 
-df = pandas.read_csv("RMatrixGen3.csv",delimiter=";",names=["Energy","Photons"])
+df = pandas.read_csv("RMatrixGen3.csv",delimiter=";",names=["Energy","Photons","Weight","Species"])
+df = df[df["Species"] == "neutron"]
 photons = df["Photons"]
-photons.hist(bins=100,range=[400,20000])
+weights = df["Weight"]
+photons.hist(bins=100,range=[400,20000],weights=weights)
 photon_energy = photons / 12.3
 n_energy = df["Energy"]
-Hist, x_edges, y_edges = np.histogram2d(n_energy,photon_energy,bins=100,range=[[0,5000],[100,2000]])
+Hist, x_edges, y_edges = np.histogram2d(n_energy,photon_energy,bins=100,range=[[0,5000],[100,2000]],weights=weights)
 Hist = Hist.transpose()
 X,Y = np.meshgrid(x_edges[:-1],y_edges[:-1])
 
@@ -0,0 +1,351 @@
+/*
+#############################################################################
+
+RMatrixRegression
+
+Checks that a change to the simulation, or a performance mode, leaves
+the response matrices statistically unchanged.  A set of short
+reference scenarios is run with fixed seeds and the neutron or gamma
+response matrix of each is written out.  With --record, these become
+the reference, together with the time each scenario took.  With
+--check, the scenarios are run again (after the optional --mode macro,
+which holds the settings under test) and every energy column of the
+new matrices is compared with the reference:
+
+  - chi-square per degree of freedom of the normalised light
+    distributions, which must not exceed --chi2-max
+  - Kolmogorov-Smirnov distance, which must not exceed the critical
+    distance at significance --ks-alpha for the effective number of
+    entries of the two columns
+
+The speedup against the recorded time is reported next to the result.
+Without a mode macro and on the same build, the runs repeat the
+reference events exactly and every column agrees perfectly.
+
+A reference only holds for the Geant4 version it was recorded with,
+which --record writes to geant4_version.txt; --check refuses a
+reference of another version.  The reference in regression/reference
+is checked by ctest (see CMakeLists.txt).
+
+Scenarios:
+  EJ301        1" x 1" EJ301, 1-5 MeV neutrons, neutron matrix
+  LaBr3_gamma  1" x 1" LaBr3, 0.1-3 MeV gammas, gamma matrix
+
+Usage:
+
+  RMatrixRegression --record DIR [options]
+  RMatrixRegression --check DIR [--mode settings.mac] [options]
+
+Options:
+  -t, --threads N    number of worker threads (1 runs sequentially)
+  -n, --events N     events per scenario (default: per scenario)
+  --work DIR         where the new matrices go (default: current directory)
+  --chi2-max X       largest chi-square per degree of freedom (default: 2)
+  --ks-alpha A       significance of the KS test (default: 0.01)
+  -p, --physics NAME physics list (QGSP_BIC_HP or lean)
+  --em-option N      standard EM option of the lean list (0, 1, 3 or 4)
+
+The exit status is 0 if every column of every scenario agrees, 1 if
+not, and 2 if the reference could not be read or is of another Geant4
+version.
+############################################################################
+*/
+
+// G4 Header Files
+#include "G4RunManager.hh"
+#include "G4UImanager.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Version.hh"
+#include "Randomize.hh"
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+// User Header Files
+#include "runSetup.hh"
+#include "responseMatrix.hh"
+
+namespace
+{
+  const G4long referenceSeed = 19700101;
+
+  struct regressionScenario
+  {
+    G4String name;
+    G4String species;
+    G4int events;
+    G4double eMin, eMax;
+    G4int nEnergyBins;
+    G4double lightMax;
+    std::vector<G4String> commands;
+  };
+
+  std::vector<regressionScenario> ReferenceScenarios()
+  {
+    std::vector<G4String> source = runSetup::PlaneSourceCommands();
+    source.push_back("/RMatrix/geometry/setRadius 1.27 cm");
+    source.push_back("/RMatrix/geometry/setHalfLength 1.27 cm");
+
+    regressionScenario neutrons = {"EJ301", "neutron", 20000, 1.*MeV, 5.*MeV, 8, 50000., source};
+    neutrons.commands.push_back("/RMatrix/geometry/setMaterial EJ301");
+    neutrons.commands.push_back("/gps/particle neutron");
+    neutrons.commands.push_back("/gps/ene/min 1. MeV");
+    neutrons.commands.push_back("/gps/ene/max 5. MeV");
+    neutrons.commands.push_back("/RMatrix/stack/trackGammas off");
+
+    regressionScenario gammas = {"LaBr3_gamma", "gamma", 5000, 0.1*MeV, 3.1*MeV, 6, 250000., source};
+    gammas.commands.push_back("/RMatrix/geometry/setMaterial LanthanumBromide");
+    gammas.commands.push_back("/gps/particle gamma");
+    gammas.commands.push_back("/gps/ene/min 0.1 MeV");
+    gammas.commands.push_back("/gps/ene/max 3.1 MeV");
+    gammas.commands.push_back("/RMatrix/stack/trackGammas on");
+
+    return {neutrons, gammas};
+  }
+
+  // Critical KS distance for two weighted samples, from the asymptotic
+  // Kolmogorov distribution
+  G4double KSCriticalDistance(G4double alpha, G4double n, G4double m)
+  {
+    if(n <= 0. or m <= 0.)
+      return 1.;
+    return std::sqrt(-0.5*std::log(alpha/2.))*std::sqrt((n + m)/(n*m));
+  }
+
+  // Kish effective number of entries of one column
+  G4double EffectiveEntries(const responseMatrix &matrix, G4int energyBin)
+  {
+    G4double sum = 0., sum2 = 0.;
+    for(G4int j=0; j<matrix.GetNumberOfLightBins(); j++){
+      sum += matrix.GetBinContent(energyBin, j);
+      sum2 += matrix.GetBinError2(energyBin, j);
+    }
+    return (sum2 > 0.) ? sum*sum/sum2 : 0.;
+  }
+
+  G4String MatrixFile(const G4String &directory, const regressionScenario &scenario)
+  {
+    return directory + "/" + scenario.name + "_" + scenario.species + ".csv";
+  }
+
+  void PrintUsage()
+  {
+    G4cerr << "Usage: RMatrixRegression --record DIR [-t threads] [-n events] [-p physicsList]\n"
+	   << "       RMatrixRegression --check DIR [--mode settings.mac] [--work DIR]\n"
+	   << "                         [--chi2-max X] [--ks-alpha A]\n"
+	   << "                         [-t threads] [-n events] [-p physicsList]\n"
+	   << "                         [--em-option N]" << G4endl;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  G4bool record = false;
+  G4String referenceDir = "";
+  G4String workDir = ".";
+  G4String modeMacro = "";
+  G4String physics = "";
+  G4int emOption = -1;
+  G4int nThreads = 1;
+  G4int nEvents = 0;
+  G4double chi2Max = 2.;
+  G4double ksAlpha = 0.01;
+
+  try{
+    for(G4int i=1; i<argc; i++){
+      G4String arg = argv[i];
+      G4bool hasValue = (i+1 < argc);
+
+      if(arg == "--record" and hasValue){
+	record = true;
+	referenceDir = argv[++i];
+      }
+      else if(arg == "--check" and hasValue)
+	referenceDir = argv[++i];
+      else if(arg == "--mode" and hasValue)
+	modeMacro = argv[++i];
+      else if(arg == "--work" and hasValue)
+	workDir = argv[++i];
+      else if(arg == "--chi2-max" and hasValue)
+	chi2Max = std::stod(argv[++i]);
+      else if(arg == "--ks-alpha" and hasValue)
+	ksAlpha = std::stod(argv[++i]);
+      else if((arg == "-t" or arg == "--threads") and hasValue)
+	nThreads = std::stoi(argv[++i]);
+      else if((arg == "-n" or arg == "--events") and hasValue)
+	nEvents = std::stoi(argv[++i]);
+      else if((arg == "-p" or arg == "--physics") and hasValue)
+	physics = argv[++i];
+      else if(arg == "--em-option" and hasValue)
+	emOption = std::stoi(argv[++i]);
+      else if(arg == "-h" or arg == "--help"){
+	PrintUsage();
+	return 0;
+      }
+      else{
+	G4cerr << "RMatrixRegression: unrecognised or incomplete option '" << arg << "'" << G4endl;
+	PrintUsage();
+	return 2;
+      }
+    }
+  }
+  catch(const std::exception &){
+    G4cerr << "RMatrixRegression: invalid numeric option value" << G4endl;
+    PrintUsage();
+    return 2;
+  }
+
+  if(referenceDir == ""){
+    PrintUsage();
+    return 2;
+  }
+
+  // The physics, and so the matrices, change between Geant4 versions
+  if(!record){
+    std::ifstream versionFile((referenceDir + "/geant4_version.txt").c_str());
+    G4int referenceVersion = 0;
+    if(!versionFile.is_open()){
+      G4cerr << "RMatrixRegression: no reference has been recorded in " << referenceDir
+	     << "; record one with --record " << referenceDir << G4endl;
+      return 2;
+    }
+    if(!(versionFile >> referenceVersion) or referenceVersion != G4VERSION_NUMBER){
+      G4cerr << "RMatrixRegression: the reference in " << referenceDir << " was recorded with Geant4 "
+	     << referenceVersion << ", this build uses " << G4VERSION_NUMBER << G4endl;
+      return 2;
+    }
+  }
+
+  // Reference time per event, recorded along with the matrices
+  std::map<G4String, G4double> referenceTimes;
+  if(!record){
+    std::ifstream timing((referenceDir + "/timing.csv").c_str());
+    std::string line;
+    std::getline(timing, line);
+    while(std::getline(timing, line)){
+      for(char &c : line)
+	if(c == ';') c = ' ';
+      std::istringstream is(line);
+      std::string name;
+      G4double seconds, events;
+      if(is >> name >> seconds >> events and events > 0.)
+	referenceTimes[name] = seconds/events;
+    }
+  }
+
+  CLHEP::HepRandom::setTheSeed(referenceSeed);
+
+  // The same set up as RMatrixGen
+  G4RunManager* runManager = runSetup::CreateRunManager(nThreads, physics, emOption);
+  runManager -> Initialize();
+  G4UImanager* UI = G4UImanager::GetUIpointer();
+
+  UI -> ApplyCommand("/control/verbose 0");
+  UI -> ApplyCommand("/run/verbose 0");
+  UI -> ApplyCommand("/gps/verbose 0");
+  UI -> ApplyCommand("/RMatrix/output/setDataOutput off");
+  UI -> ApplyCommand("/RMatrix/random/perEventSeeding on");
+  UI -> ApplyCommand("/RMatrix/random/setRunSeed " + std::to_string(referenceSeed));
+  UI -> ApplyCommand("/RMatrix/response/matrixOutput on");
+
+  G4String outputDir = record ? referenceDir : workDir;
+  std::ofstream timingOutput;
+  if(record){
+    timingOutput.open((referenceDir + "/timing.csv").c_str());
+    timingOutput << "Scenario;Seconds;Events\n";
+    std::ofstream versionFile((referenceDir + "/geant4_version.txt").c_str());
+    versionFile << G4VERSION_NUMBER << "\n";
+  }
+
+  G4bool allPassed = true;
+  G4bool referenceMissing = false;
+
+  for(const regressionScenario &scenario : ReferenceScenarios()){
+    for(const G4String &command : scenario.commands)
+      UI -> ApplyCommand(command);
+
+    std::ostringstream energyBinning;
+    energyBinning << "/RMatrix/response/setEnergyBinning " << scenario.nEnergyBins << " "
+		  << scenario.eMin/MeV << " " << scenario.eMax/MeV << " MeV";
+    UI -> ApplyCommand(energyBinning.str());
+    UI -> ApplyCommand("/RMatrix/response/setLightBinning 100 " + std::to_string(scenario.lightMax));
+    UI -> ApplyCommand("/RMatrix/response/setFileName " + outputDir + "/" + scenario.name);
+
+    // The settings under test apply to the new runs only
+    if(!record and modeMacro != "")
+      UI -> ApplyCommand("/control/execute " + modeMacro);
+
+    G4int events = (nEvents > 0) ? nEvents : scenario.events;
+    UI -> ApplyCommand("/RMatrix/random/setEventOffset 0");
+    std::chrono::steady_clock::time_point runStart = std::chrono::steady_clock::now();
+    runManager -> BeamOn(events);
+    G4double runTime = std::chrono::duration<G4double>(std::chrono::steady_clock::now() - runStart).count();
+
+    if(record){
+      timingOutput << scenario.name << ";" << runTime << ";" << events << "\n";
+      G4cout << "\n Reference " << scenario.name << " recorded in " << runTime << " s" << G4endl;
+      continue;
+    }
+
+    responseMatrix reference, current;
+    reference.SetBinning(scenario.nEnergyBins, scenario.eMin, scenario.eMax, 100, scenario.lightMax);
+    current.SetBinning(scenario.nEnergyBins, scenario.eMin, scenario.eMax, 100, scenario.lightMax);
+    if(!reference.Read(MatrixFile(referenceDir, scenario)) or !current.Read(MatrixFile(workDir, scenario))){
+      G4cerr << "RMatrixRegression: could not read the " << scenario.name << " matrices" << G4endl;
+      referenceMissing = true;
+      continue;
+    }
+
+    G4cout << "\n Scenario " << scenario.name << " (" << scenario.species << " response)"
+	   << "\n   E [MeV]   entries   chi2/ndf        KS   KS max  result" << G4endl;
+
+    G4int nFailed = 0, nCompared = 0;
+    G4double energyWidth = (scenario.eMax - scenario.eMin)/scenario.nEnergyBins;
+    for(G4int i=0; i<scenario.nEnergyBins; i++){
+      G4double chi2 = reference.ColumnChiSquare(current, i);
+      G4double distance = reference.ColumnKSDistance(current, i);
+      G4double nRef = EffectiveEntries(reference, i), nNew = EffectiveEntries(current, i);
+
+      if(reference.GetColumnSum(i) <= 0. and current.GetColumnSum(i) <= 0.)
+	continue;
+
+      // A column empty in only one of the matrices fails (chi2 < 0)
+      G4double ksMax = KSCriticalDistance(ksAlpha, nRef, nNew);
+      G4bool passed = (chi2 >= 0. and chi2 <= chi2Max and distance <= ksMax);
+
+      nCompared++;
+      if(!passed)
+	nFailed++;
+
+      G4cout << "   " << std::setw(7) << (scenario.eMin + (i+0.5)*energyWidth)/MeV
+	     << "  " << std::setw(8) << G4long(nNew)
+	     << "  " << std::setw(9) << chi2
+	     << "  " << std::setw(8) << distance
+	     << "  " << std::setw(7) << ksMax
+	     << "  " << (passed ? "ok" : "FAIL") << G4endl;
+    }
+
+    std::map<G4String, G4double>::const_iterator recorded = referenceTimes.find(scenario.name);
+    G4cout << "   " << nCompared - nFailed << "/" << nCompared << " columns agree, "
+	   << runTime << " s";
+    if(recorded != referenceTimes.end() and runTime > 0.)
+      G4cout << ", speedup " << recorded->second*events/runTime << "x per event against the reference";
+    G4cout << G4endl;
+
+    allPassed = allPassed and nFailed == 0;
+  }
+
+  delete runManager;
+
+  if(referenceMissing)
+    return 2;
+  if(!record)
+    G4cout << "\n Regression " << (allPassed ? "passed" : "FAILED") << G4endl;
+  return allPassed ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+/*
+#############################################################################
+
+RMatrixReweight
+
+Turns the event output of a run into the response matrix for another
+incident spectrum, without running again.  Every event whose primary
+is of the chosen species is given the weight w(E) = target(E)/source(E)
+of its primary energy on top of its own (biasing) weight, where the source density is the source tally
+RMatrixGen writes next to the event output (<output>_source.csv) and
+the target is a spectrum file of "energy[MeV] intensity" lines (see
+include/spectrumReweighter.hh).  The event files are read in a single
+streaming pass, so they can be of any size.
+
+The weighted matrix is written in the usual format, the sum of the
+squared weights of every bin giving its variance.  It holds as many
+incident particles as the source tally has primaries in range; events
+without light are not in the event output, so its zero-light bin is
+empty.
+
+Usage:
+
+  RMatrixReweight --source run_source.csv --target spectrum.txt
+                  [options] events.csv [events_t1.csv ...]
+
+Options:
+  --species NAME         neutron or gamma primaries (default: neutron)
+  --energy-bins N        energy bins of the matrix (default: the source tally's)
+  --light-bins N         light bins of the matrix (default: 250)
+  --light-max L          photons at the end of the last light bin (default: 50000)
+  -o, --output FILE      weighted matrix (default: reweighted.csv)
+############################################################################
+*/
+
+// G4 Header Files
+#include "globals.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// User Header Files
+#include "sourceTally.hh"
+#include "spectrumReweighter.hh"
+#include "responseMatrix.hh"
+
+namespace
+{
+  void PrintUsage()
+  {
+    G4cerr << "Usage: RMatrixReweight --source run_source.csv --target spectrum.txt\n"
+	   << "                       [--species neutron|gamma] [--energy-bins N]\n"
+	   << "                       [--light-bins N] [--light-max L] [-o matrix.csv]\n"
+	   << "                       events.csv [events_t1.csv ...]" << G4endl;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  G4String sourceFile = "";
+  G4String targetFile = "";
+  G4String species = "neutron";
+  G4String outputFile = "reweighted.csv";
+  G4int nEnergyBins = 0;
+  G4int nLightBins = 250;
+  G4double lightMax = 50000.;
+  std::vector<G4String> eventFiles;
+
+  try{
+    for(G4int i=1; i<argc; i++){
+      G4String arg = argv[i];
+      G4bool hasValue = (i+1 < argc);
+
+      if(arg == "--source" and hasValue)
+	sourceFile = argv[++i];
+      else if(arg == "--target" and hasValue)
+	targetFile = argv[++i];
+      else if(arg == "--species" and hasValue)
+	species = argv[++i];
+      else if(arg == "--energy-bins" and hasValue)
+	nEnergyBins = std::stoi(argv[++i]);
+      else if(arg == "--light-bins" and hasValue)
+	nLightBins = std::stoi(argv[++i]);
+      else if(arg == "--light-max" and hasValue)
+	lightMax = std::stod(argv[++i]);
+      else if((arg == "-o" or arg == "--output") and hasValue)
+	outputFile = argv[++i];
+      else if(arg == "-h" or arg == "--help"){
+	PrintUsage();
+	return 0;
+      }
+      else if(arg[0] != '-')
+	eventFiles.push_back(arg);
+      else{
+	G4cerr << "RMatrixReweight: unrecognised or incomplete option '" << arg << "'" << G4endl;
+	PrintUsage();
+	return 1;
+      }
+    }
+  }
+  catch(const std::exception &){
+    G4cerr << "RMatrixReweight: invalid numeric option value" << G4endl;
+    PrintUsage();
+    return 1;
+  }
+
+  if(sourceFile == "" or targetFile == "" or eventFiles.empty()
+     or (species != "neutron" and species != "gamma") or nLightBins <= 0 or lightMax <= 0.){
+    PrintUsage();
+    return 1;
+  }
+  G4bool gamma = (species == "gamma");
+
+  sourceTally source;
+  if(!source.Read(sourceFile)){
+    G4cerr << "RMatrixReweight: could not read the source tally " << sourceFile << G4endl;
+    return 1;
+  }
+
+  spectrumReweighter reweighter;
+  if(!reweighter.ReadTarget(targetFile)){
+    G4cerr << "RMatrixReweight: could not read the target spectrum " << targetFile << G4endl;
+    return 1;
+  }
+  if(!reweighter.SetSource(source, gamma)){
+    G4cerr << "RMatrixReweight: the source tally has no " << species
+	   << " primaries, or the target spectrum none of its range" << G4endl;
+    return 1;
+  }
+
+  responseMatrix matrix;
+  matrix.SetBinning((nEnergyBins > 0) ? nEnergyBins : source.GetNumberOfBins(),
+		    source.GetEnergyMin(), source.GetEnergyMax(), nLightBins, lightMax);
+
+  // One pass over the events: energy [keV];photons;weight;species[;...]
+  // of the primary.  Events of the other species are skipped
+  G4long nRead = 0, nWeighted = 0;
+  G4double sumW = 0., sumW2 = 0.;
+  for(const G4String &fileName : eventFiles){
+    std::ifstream input(fileName);
+    if(!input.is_open()){
+      G4cerr << "RMatrixReweight: could not read " << fileName << G4endl;
+      return 1;
+    }
+
+    std::string line;
+    while(std::getline(input, line)){
+      const char *text = line.c_str();
+      char *end;
+      G4double energy = std::strtod(text, &end)*keV;
+      if(end == text or *end != ';')
+	continue;
+      G4double photons = std::strtod(end + 1, &end);
+      if(*end != ';')
+	continue;
+      G4double eventWeight = std::strtod(end + 1, &end);
+      if(*end != ';')
+	continue;
+      const char *name = end + 1;
+      const char *nameEnd = name;
+      while(*nameEnd and *nameEnd != ';')
+	nameEnd++;
+      nRead++;
+      if(species.compare(0, std::string::npos, name, nameEnd - name) != 0)
+	continue;
+
+      G4double weight = eventWeight*reweighter.Weight(energy);
+      if(weight <= 0.)
+	continue;
+      matrix.Fill(energy, photons, weight);
+      nWeighted++;
+      sumW += weight;
+      sumW2 += weight*weight;
+    }
+  }
+
+  if(!matrix.Write(outputFile)){
+    G4cerr << "RMatrixReweight: could not write " << outputFile << G4endl;
+    return 1;
+  }
+
+  G4cout << " Events read: " << nRead << ", " << species << " events with a weight: " << nWeighted
+	 << "\n Sum of weights: " << sumW << ", effective entries: "
+	 << ((sumW2 > 0.) ? sumW*sumW/sumW2 : 0.)
+	 << "\n Primaries in the source tally: " << source.GetTotal(gamma)
+	 << " (" << source.GetNumberOfEvents() << " events)"
+	 << "\n Weighted matrix written to " << outputFile << G4endl;
+
+  return 0;
+}
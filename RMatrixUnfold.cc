@@ -0,0 +1,462 @@
+/*
+#############################################################################
+
+RMatrixUnfold
+
+Unfolds the incident spectrum from a measured light (pulse-height)
+spectrum with a response matrix written by RMatrixGen, by MLEM, GRAVEL
+or Tikhonov-regularised least squares (see include/responseUnfolder.hh),
+and gives its uncertainty by Monte Carlo resampling: the measured
+counts (and, if asked, the matrix within its own statistical
+uncertainty) are drawn again for every replica, which is unfolded the
+same way, and the spread of the replicas is the uncertainty.  Replicas
+run on as many threads as asked; each draws from its own random stream,
+given by the seed and its number, so the result does not depend on the
+number of threads.
+
+Every energy column of the matrix is divided by the number of primaries
+in it: those of the source tally (<name>_source.csv) if one is given,
+so that the spectrum is in incident particles, otherwise the column sum,
+which makes every energy bin fully efficient.  The measured spectrum is
+a file of "lightLow lightHigh counts [error]" lines, light in the units
+of the matrix (photons), separated by spaces, tabs, ',' or ';'; lines
+starting with '#' are skipped.  Its bins are added into the light bins
+of the matrix that hold their centres; without an error column the
+counts are taken as Poisson.  Only the light bins the measured spectrum
+covers, above the threshold, are fitted.
+
+The spectrum is written as "EnergyLow;EnergyHigh;Spectrum;Error;Mean"
+lines (energies in MeV), where Error and Mean are the standard
+deviation and mean of the replicas.
+
+Usage:
+
+  RMatrixUnfold [options] matrix.csv measured.txt
+
+Options:
+  --method NAME          mlem, gravel or tikhonov (default: mlem)
+  --iterations N         most iterations of MLEM and GRAVEL (default: 1000)
+  --tolerance T          relative change of chi2 to stop at (default: 1e-6)
+  --lambda L             Tikhonov strength, relative (default: 1e-3)
+  --order K              Tikhonov penalty: 0 size, 1 slope, 2 curvature (default: 2)
+  --source FILE          source tally of the run that made the matrix
+  --species NAME         neutron or gamma primaries of the source tally (default: neutron)
+  --light-bins N         light bins of the matrix (default: from the matrix file)
+  --light-max L          photons at the end of the last light bin (default: from the matrix file)
+  --threshold L          photons below which light bins are not fitted (default: 0)
+  --replicas N           resampled replicas for the uncertainty (default: 0)
+  --resample-matrix      resample the matrix as well as the counts
+  -t, --threads N        threads for the replicas (default: all cores)
+  -s, --seed S           seed of the replicas (default: current time)
+  --covariance FILE      write the covariance of the replicas too
+  -o, --output FILE      unfolded spectrum (default: unfolded.csv)
+############################################################################
+*/
+
+// G4 Header Files
+#include "globals.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// User Header Files
+#include "responseMatrix.hh"
+#include "responseUnfolder.hh"
+#include "sourceTally.hh"
+
+namespace
+{
+  void PrintUsage()
+  {
+    G4cerr << "Usage: RMatrixUnfold [--method mlem|gravel|tikhonov] [--iterations N] [--tolerance T]\n"
+	   << "                     [--lambda L] [--order K] [--source run_source.csv]\n"
+	   << "                     [--species neutron|gamma] [--light-bins N] [--light-max L]\n"
+	   << "                     [--threshold L] [--replicas N] [--resample-matrix]\n"
+	   << "                     [-t threads] [-s seed] [--covariance FILE] [-o spectrum.csv]\n"
+	   << "                     matrix.csv measured.txt" << G4endl;
+  }
+
+  // Binning of a matrix file, from the widths of its bins and the range
+  // its bins cover.  Energy and light limits that are already set (> 0)
+  // are kept
+  G4bool ReadMatrixBinning(const G4String &fileName, G4int &nEnergy, G4double &eMin, G4double &eMax,
+			   G4int &nLight, G4double &lightMax)
+  {
+    std::ifstream input(fileName);
+    if(!input.is_open())
+      return false;
+
+    G4double energyWidth = 0., lightWidth = 0., low = 0., high = 0., lightHigh = 0.;
+    std::string line;
+    std::getline(input, line);
+    while(std::getline(input, line)){
+      for(char &c : line)
+	if(c == ';') c = ' ';
+      std::istringstream is(line);
+      G4double eLow, eHigh, lLow, lHigh;
+      if(!(is >> eLow >> eHigh >> lLow >> lHigh))
+	continue;
+      if(energyWidth == 0.){
+	energyWidth = eHigh - eLow;
+	lightWidth = lHigh - lLow;
+	low = eLow;
+	high = eHigh;
+      }
+      low = std::min(low, eLow);
+      high = std::max(high, eHigh);
+      lightHigh = std::max(lightHigh, lHigh);
+    }
+    if(energyWidth <= 0. or lightWidth <= 0.)
+      return false;
+
+    if(nEnergy <= 0){
+      nEnergy = G4int(std::floor((high - low)/energyWidth + 0.5));
+      eMin = low*MeV;
+      eMax = high*MeV;
+    }
+    if(lightMax <= 0.)
+      lightMax = lightHigh;
+    if(nLight <= 0)
+      nLight = G4int(std::floor(lightMax/lightWidth + 0.5));
+    return nEnergy > 0 and nLight > 0;
+  }
+
+  // Counts of the measured spectrum in the light bins of the matrix.
+  // covered marks the bins it has, poisson those without an error
+  G4bool ReadMeasured(const G4String &fileName, G4int nLight, G4double lightMax,
+		      std::vector<G4double> &counts, std::vector<G4double> &variances,
+		      std::vector<G4bool> &covered, std::vector<G4bool> &poisson)
+  {
+    std::ifstream input(fileName);
+    if(!input.is_open())
+      return false;
+
+    counts.assign(nLight, 0.);
+    variances.assign(nLight, 0.);
+    covered.assign(nLight, false);
+    poisson.assign(nLight, true);
+
+    G4bool any = false;
+    std::string line;
+    while(std::getline(input, line)){
+      if(line.empty() or line[0] == '#')
+	continue;
+      for(char &c : line)
+	if(c == ';' or c == ',' or c == '\t') c = ' ';
+
+      std::istringstream is(line);
+      G4double low, high, value, error;
+      if(!(is >> low >> high >> value))
+	continue;
+      G4bool hasError = static_cast<G4bool>(is >> error);
+
+      G4int bin = std::min(G4int(std::max(0.5*(low + high), 0.)/lightMax*nLight), nLight - 1);
+      counts[bin] += value;
+      variances[bin] += hasError ? error*error : std::max(value, 0.);
+      covered[bin] = true;
+      poisson[bin] = poisson[bin] and !hasError;
+      any = true;
+    }
+    return any;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  G4String method = "mlem";
+  G4int iterations = 1000;
+  G4double tolerance = 1e-6;
+  G4double lambda = 1e-3;
+  G4int order = 2;
+  G4String sourceFile = "";
+  G4String species = "neutron";
+  G4int nLightBins = 0;
+  G4double lightMax = 0.;
+  G4double threshold = 0.;
+  G4int nReplicas = 0;
+  G4bool resampleMatrix = false;
+  G4int nThreads = std::max(G4int(std::thread::hardware_concurrency()), 1);
+  G4long seed = time(0);
+  G4String covarianceFile = "";
+  G4String outputFile = "unfolded.csv";
+  std::vector<G4String> inputFiles;
+
+  try{
+    for(G4int i=1; i<argc; i++){
+      G4String arg = argv[i];
+      G4bool hasValue = (i+1 < argc);
+
+      if(arg == "--method" and hasValue)
+	method = argv[++i];
+      else if(arg == "--iterations" and hasValue)
+	iterations = std::stoi(argv[++i]);
+      else if(arg == "--tolerance" and hasValue)
+	tolerance = std::stod(argv[++i]);
+      else if(arg == "--lambda" and hasValue)
+	lambda = std::stod(argv[++i]);
+      else if(arg == "--order" and hasValue)
+	order = std::stoi(argv[++i]);
+      else if(arg == "--source" and hasValue)
+	sourceFile = argv[++i];
+      else if(arg == "--species" and hasValue)
+	species = argv[++i];
+      else if(arg == "--light-bins" and hasValue)
+	nLightBins = std::stoi(argv[++i]);
+      else if(arg == "--light-max" and hasValue)
+	lightMax = std::stod(argv[++i]);
+      else if(arg == "--threshold" and hasValue)
+	threshold = std::stod(argv[++i]);
+      else if(arg == "--replicas" and hasValue)
+	nReplicas = std::stoi(argv[++i]);
+      else if(arg == "--resample-matrix")
+	resampleMatrix = true;
+      else if((arg == "-t" or arg == "--threads") and hasValue)
+	nThreads = std::stoi(argv[++i]);
+      else if((arg == "-s" or arg == "--seed") and hasValue)
+	seed = std::stol(argv[++i]);
+      else if(arg == "--covariance" and hasValue)
+	covarianceFile = argv[++i];
+      else if((arg == "-o" or arg == "--output") and hasValue)
+	outputFile = argv[++i];
+      else if(arg == "-h" or arg == "--help"){
+	PrintUsage();
+	return 0;
+      }
+      else if(arg[0] != '-')
+	inputFiles.push_back(arg);
+      else{
+	G4cerr << "RMatrixUnfold: unrecognised or incomplete option '" << arg << "'" << G4endl;
+	PrintUsage();
+	return 1;
+      }
+    }
+  }
+  catch(const std::exception &){
+    G4cerr << "RMatrixUnfold: invalid numeric option value" << G4endl;
+    PrintUsage();
+    return 1;
+  }
+
+  if(inputFiles.size() != 2 or (method != "mlem" and method != "gravel" and method != "tikhonov")
+     or (species != "neutron" and species != "gamma") or iterations <= 0 or lambda < 0.
+     or order < 0 or order > 2 or nReplicas < 0 or nThreads <= 0){
+    PrintUsage();
+    return 1;
+  }
+  G4bool gamma = (species == "gamma");
+  const G4String &matrixFile = inputFiles[0];
+  const G4String &measuredFile = inputFiles[1];
+
+  // The energy binning is that of the source tally where there is one
+  sourceTally source;
+  G4int nEnergyBins = 0;
+  G4double energyMin = 0., energyMax = 0.;
+  if(sourceFile != ""){
+    if(!source.Read(sourceFile)){
+      G4cerr << "RMatrixUnfold: could not read the source tally " << sourceFile << G4endl;
+      return 1;
+    }
+    nEnergyBins = source.GetNumberOfBins();
+    energyMin = source.GetEnergyMin();
+    energyMax = source.GetEnergyMax();
+  }
+
+  responseMatrix matrix;
+  if(!ReadMatrixBinning(matrixFile, nEnergyBins, energyMin, energyMax, nLightBins, lightMax)){
+    G4cerr << "RMatrixUnfold: could not read the binning of " << matrixFile << G4endl;
+    return 1;
+  }
+  matrix.SetBinning(nEnergyBins, energyMin, energyMax, nLightBins, lightMax);
+  if(!matrix.Read(matrixFile)){
+    G4cerr << "RMatrixUnfold: could not read " << matrixFile << " with " << nEnergyBins
+	   << " energy and " << nLightBins << " light bins" << G4endl;
+    return 1;
+  }
+
+  std::vector<G4double> allCounts, allVariances;
+  std::vector<G4bool> covered, poisson;
+  if(!ReadMeasured(measuredFile, nLightBins, lightMax, allCounts, allVariances, covered, poisson)){
+    G4cerr << "RMatrixUnfold: could not read the measured spectrum " << measuredFile << G4endl;
+    return 1;
+  }
+
+  // Light bins that are fitted, and the primaries of every energy bin
+  std::vector<G4int> fitted;
+  for(G4int j=0; j<nLightBins; j++)
+    if(covered[j] and j*lightMax/nLightBins >= threshold)
+      fitted.push_back(j);
+  G4int nFitted = G4int(fitted.size());
+  if(nFitted == 0){
+    G4cerr << "RMatrixUnfold: the measured spectrum has no light bins above the threshold" << G4endl;
+    return 1;
+  }
+
+  std::vector<G4double> primaries(nEnergyBins);
+  for(G4int i=0; i<nEnergyBins; i++)
+    primaries[i] = (sourceFile != "") ? source.GetBinCount(gamma, i) : matrix.GetColumnSum(i);
+
+  std::vector<G4double> counts(nFitted), variances(nFitted);
+  for(G4int f=0; f<nFitted; f++){
+    counts[f] = allCounts[fitted[f]];
+    variances[f] = allVariances[fitted[f]];
+  }
+
+  // Response of the fitted bins, with the matrix sums drawn again
+  // within their uncertainty when a generator is given
+  auto BuildResponse = [&](CLHEP::RandGauss *gauss){
+    std::vector<G4double> response(nFitted*nEnergyBins, 0.);
+    for(G4int f=0; f<nFitted; f++)
+      for(G4int i=0; i<nEnergyBins; i++){
+	if(primaries[i] <= 0.)
+	  continue;
+	G4double sum = matrix.GetBinContent(i, fitted[f]);
+	if(gauss and sum != 0.)
+	  sum = std::max(gauss->fire(sum, std::sqrt(matrix.GetBinError2(i, fitted[f]))), 0.);
+	response[f*nEnergyBins + i] = sum/primaries[i];
+      }
+    return response;
+  };
+
+  responseUnfolder unfolder;
+  unfolder.SetResponse(BuildResponse(nullptr), nFitted, nEnergyBins);
+  unfolder.SetMethod((method == "mlem") ? responseUnfolder::unfoldMLEM :
+		     (method == "gravel") ? responseUnfolder::unfoldGRAVEL : responseUnfolder::unfoldTikhonov);
+  unfolder.SetIterations(iterations);
+  unfolder.SetTolerance(tolerance);
+  unfolder.SetRegularisation(lambda, order);
+
+  std::vector<G4double> spectrum;
+  G4int nIterations = unfolder.Unfold(counts, variances, spectrum);
+  if(nIterations < 0){
+    G4cerr << "RMatrixUnfold: the measured spectrum could not be unfolded with this matrix" << G4endl;
+    return 1;
+  }
+  G4double chi2 = unfolder.ChiSquare(counts, variances, spectrum);
+
+  // Replicas, handed out to the threads one at a time.  Every replica
+  // has its own engine and Gaussian generator: the static RandGauss
+  // functions keep the spare value of each pair per thread, which
+  // would tie a replica's draws to the replicas its thread ran before
+  std::vector<std::vector<G4double>> replicas(nReplicas);
+  std::atomic<G4int> nextReplica(0);
+  auto RunReplicas = [&](){
+    for(G4int r = nextReplica++; r < nReplicas; r = nextReplica++){
+      CLHEP::MixMaxRng engine;
+      long seeds[3] = {long(seed), long(r), 0};
+      engine.setSeeds(seeds, 2);
+      CLHEP::RandGauss gauss(engine);
+
+      std::vector<G4double> replicaCounts(nFitted), replicaVariances(nFitted);
+      for(G4int f=0; f<nFitted; f++){
+	if(poisson[fitted[f]]){
+	  replicaCounts[f] = (counts[f] > 0.) ? G4double(CLHEP::RandPoisson::shoot(&engine, counts[f])) : 0.;
+	  replicaVariances[f] = replicaCounts[f];
+	}
+	else{
+	  replicaCounts[f] = gauss.fire(counts[f], std::sqrt(variances[f]));
+	  replicaVariances[f] = variances[f];
+	}
+      }
+
+      G4int status;
+      if(resampleMatrix){
+	responseUnfolder replicaUnfolder = unfolder;
+	replicaUnfolder.SetResponse(BuildResponse(&gauss), nFitted, nEnergyBins);
+	status = replicaUnfolder.Unfold(replicaCounts, replicaVariances, replicas[r]);
+      }
+      else
+	status = unfolder.Unfold(replicaCounts, replicaVariances, replicas[r]);
+      if(status < 0)
+	replicas[r].clear();
+    }
+  };
+
+  std::chrono::steady_clock::time_point replicaStart = std::chrono::steady_clock::now();
+  if(nReplicas > 0){
+    std::vector<std::thread> threads;
+    for(G4int t=0; t<std::min(nThreads, nReplicas); t++)
+      threads.emplace_back(RunReplicas);
+    for(std::thread &thread : threads)
+      thread.join();
+  }
+  G4double replicaTime = std::chrono::duration<G4double>(std::chrono::steady_clock::now() - replicaStart).count();
+
+  // Mean, standard deviation and covariance of the replicas
+  std::vector<G4double> mean(nEnergyBins, 0.), covariance(nEnergyBins*nEnergyBins, 0.);
+  G4int nGood = 0;
+  for(const std::vector<G4double> &replica : replicas)
+    if(!replica.empty()){
+      nGood++;
+      for(G4int i=0; i<nEnergyBins; i++)
+	mean[i] += replica[i];
+    }
+  for(G4int i=0; i<nEnergyBins; i++)
+    mean[i] = (nGood > 0) ? mean[i]/nGood : spectrum[i];
+  for(const std::vector<G4double> &replica : replicas)
+    if(!replica.empty())
+      for(G4int i=0; i<nEnergyBins; i++)
+	for(G4int k=0; k<=i; k++)
+	  covariance[i*nEnergyBins + k] += (replica[i] - mean[i])*(replica[k] - mean[k]);
+  for(G4int i=0; i<nEnergyBins; i++)
+    for(G4int k=0; k<=i; k++){
+      G4double value = (nGood > 1) ? covariance[i*nEnergyBins + k]/(nGood - 1) : 0.;
+      covariance[i*nEnergyBins + k] = value;
+      covariance[k*nEnergyBins + i] = value;
+    }
+
+  G4double energyWidth = (energyMax - energyMin)/nEnergyBins;
+  std::ofstream output(outputFile, std::ofstream::trunc);
+  if(!output.is_open()){
+    G4cerr << "RMatrixUnfold: could not write " << outputFile << G4endl;
+    return 1;
+  }
+  output << "EnergyLow;EnergyHigh;Spectrum;Error;Mean" << std::endl;
+  for(G4int i=0; i<nEnergyBins; i++)
+    output << (energyMin + i*energyWidth)/MeV << ";" << (energyMin + (i+1)*energyWidth)/MeV << ";"
+	   << spectrum[i] << ";" << std::sqrt(covariance[i*nEnergyBins + i]) << ";" << mean[i] << std::endl;
+  output.close();
+
+  if(covarianceFile != ""){
+    std::ofstream covarianceOutput(covarianceFile, std::ofstream::trunc);
+    if(!covarianceOutput.is_open()){
+      G4cerr << "RMatrixUnfold: could not write " << covarianceFile << G4endl;
+      return 1;
+    }
+    for(G4int i=0; i<nEnergyBins; i++)
+      for(G4int k=0; k<nEnergyBins; k++)
+	covarianceOutput << covariance[i*nEnergyBins + k] << ((k == nEnergyBins - 1) ? "\n" : ";");
+  }
+
+  G4double total = 0.;
+  for(G4double value : spectrum)
+    total += value;
+
+  G4cout << " Unfolded with " << method << ": " << nEnergyBins << " energy bins from "
+	 << nFitted << " light bins"
+	 << ((method == "tikhonov") ? "" : ", " + std::to_string(nIterations) + " iterations")
+	 << "\n Chi2 per light bin: " << chi2/nFitted
+	 << "\n Unfolded total: " << total
+	 << ((sourceFile != "") ? " incident " + species + "s" : " counts") << G4endl;
+  if(nReplicas > 0)
+    G4cout << " Replicas: " << nGood << " of " << nReplicas << " unfolded"
+	   << (resampleMatrix ? " (counts and matrix resampled)" : " (counts resampled)")
+	   << ", seed " << seed
+	   << " on " << std::min(nThreads, nReplicas) << " thread(s) in " << replicaTime << " s, "
+	   << nReplicas/std::max(replicaTime, 1e-9) << " replicas/s" << G4endl;
+  G4cout << " Unfolded spectrum written to " << outputFile << G4endl;
+  if(covarianceFile != "")
+    G4cout << " Covariance of the replicas written to " << covarianceFile << G4endl;
+
+  return 0;
+}
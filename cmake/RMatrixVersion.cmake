@@ -0,0 +1,53 @@
+#----------------------------------------------------------------------------
+# Writes OUTPUT, a header defining RMATRIX_VERSION as the version of the
+# source tree in SOURCE_DIR, for the configuration key of the results
+# cache (see include/resultsCache.hh).  Run at every build by the
+# RMatrixVersion target; the header is only rewritten when the version
+# changes, so that an unchanged tree rebuilds nothing.
+#
+# A tree with uncommitted changes to its sources gets a hash of those
+# changes as well, so that every edited state has a key of its own
+#
+execute_process(COMMAND git describe --always
+  WORKING_DIRECTORY ${SOURCE_DIR}
+  OUTPUT_VARIABLE version
+  OUTPUT_STRIP_TRAILING_WHITESPACE
+  ERROR_QUIET)
+
+if(NOT version)
+  set(version "unknown")
+else()
+  execute_process(COMMAND git diff HEAD
+    WORKING_DIRECTORY ${SOURCE_DIR}
+    OUTPUT_VARIABLE changes
+    ERROR_QUIET)
+  execute_process(COMMAND git ls-files --others --exclude-standard
+                          -- src include CMakeLists.txt cmake ":(glob)*.cc"
+    WORKING_DIRECTORY ${SOURCE_DIR}
+    OUTPUT_VARIABLE untracked
+    OUTPUT_STRIP_TRAILING_WHITESPACE
+    ERROR_QUIET)
+
+  if(untracked)
+    string(REPLACE "\n" ";" untracked "${untracked}")
+    foreach(file ${untracked})
+      file(SHA1 ${SOURCE_DIR}/${file} fileHash)
+      string(APPEND changes "${file} ${fileHash}\n")
+    endforeach()
+  endif()
+
+  if(changes)
+    string(SHA1 changesHash "${changes}")
+    string(SUBSTRING ${changesHash} 0 12 changesHash)
+    set(version "${version}-dirty-${changesHash}")
+  endif()
+endif()
+
+set(content "// Generated at build time by cmake/RMatrixVersion.cmake\n#define RMATRIX_VERSION \"${version}\"\n")
+set(current "")
+if(EXISTS ${OUTPUT})
+  file(READ ${OUTPUT} current)
+endif()
+if(NOT content STREQUAL current)
+  file(WRITE ${OUTPUT} "${content}")
+endif()
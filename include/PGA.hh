@@ -2,13 +2,29 @@
 #define PGA_hh 1
 
 #include "G4VUserPrimaryGeneratorAction.hh"
+#include "G4ThreeVector.hh"
+
+#include <vector>
 
 class G4GeneralParticleSource;
 class G4Event;
+class PGAMessenger;
+class G4Material;
 
 // PGA class creates the particle gun at a specified location and
 // in a specified direction with a specific particle. It is also 
 // responsible for generating each event. 
+//
+// With cone biasing on, the direction sampled by the GPS is replaced by
+// one drawn inside the cones the detectors' bounding spheres subtend
+// from the source point, and the primary is given the matching
+// geometric weight.  This assumes the source itself emits isotropically,
+// so any other GPS angular distribution is refused.
+//
+// In a light collection calibration run (see 'lightCollectionMap.hh')
+// the source is replaced by bursts of optical photons, emitted
+// isotropically from a random point of the scintillator with the
+// emission spectrum of its material.
 
 class PGA : public G4VUserPrimaryGeneratorAction
 {
@@ -17,9 +33,33 @@ public:
   ~PGA();
 
   void GeneratePrimaries(G4Event *);
+
+  // The following function is called from PGAMessenger at runtime
+  void SetConeBiasing(G4String onOff)
+  { if(onOff == "on") coneBiasing = true;
+    if(onOff == "off") coneBiasing = false; }
   
+private:
+  void BiasDirection(G4Event *);
+
+  void GenerateCalibrationPhotons(G4Event *);
+
 private:
   G4GeneralParticleSource* particleSource;
+
+  G4bool coneBiasing;
+
+  PGAMessenger *sourceMessenger;
+
+  // Per-event scratch space for the detector cones
+  std::vector<G4ThreeVector> coneAxes;
+  std::vector<G4double> coneCosMax;
+  std::vector<G4double> coneSolidAngles;
+
+  // Cumulative of the scintillator emission spectrum, per photon energy
+  const G4Material *spectrumMaterial;
+  std::vector<G4double> spectrumEnergies;
+  std::vector<G4double> spectrumCumulative;
 };
 
 #endif
@@ -0,0 +1,27 @@
+#ifndef PGAMessenger_hh
+#define PGAMessenger_hh 1
+
+#include "G4UImessenger.hh"
+
+class PGA;
+class G4UIdirectory;
+class G4UIcmdWithAString;
+
+// PGAMessenger class allows the user to interface with PGA class.
+// See 'PGA.hh' for more details
+class PGAMessenger: public G4UImessenger
+{
+
+public:
+  PGAMessenger(PGA *);
+  ~PGAMessenger();
+
+  void SetNewValue(G4UIcommand *, G4String);
+
+private:
+  PGA *thePGA;
+  G4UIdirectory *sourceDir;
+  G4UIcmdWithAString *coneCommand;
+};
+
+#endif
@@ -4,8 +4,23 @@
 #include "QGSP_BIC.hh"
 #include "QGSP_BIC_HP.hh"
 #include "G4OpticalPhysics.hh"
+#include "G4GenericBiasingPhysics.hh"
 #include "G4VModularPhysicsList.hh"
 
+class PhysicsListMessenger;
+
+// PhysicsList class builds the physics list chosen through
+// PhysicsListMessenger.  "QGSP_BIC_HP" (default) is the full reference
+// list plus optical physics.  "lean" only registers what a 1-20 MeV
+// neutron response needs: HP neutron physics, standard EM (option set
+// by /RMatrix/physics/emOption, which includes ion ionisation) and
+// scintillation, without Cerenkov or optical photon transport.  It has
+// no neutron models above the 20 MeV of the HP data, so runAction
+// refuses neutron sources reaching above that with it.  The list is built on the
+// first call to GetPhysicsList(), which runSetup makes before any macro
+// runs, so the list and EM option come from the command line (-p and
+// --em-option)
+
 class PhysicsList
 {
 public:
@@ -13,13 +28,28 @@ public:
   PhysicsList();
   ~PhysicsList();
   
-  G4VModularPhysicsList *GetPhysicsList(){return thePhysicsList;}
+  G4VModularPhysicsList *GetPhysicsList();
   G4OpticalPhysics *GetOpticalPhysits(){return theOpticalPhysics;}
+
+  void SetListName(G4String name){listName = name;}
+  void SetEmOption(G4int option){emOption = option;}
+
+  // Highest neutron energy the list built can transport
+  static G4double GetNeutronEnergyLimit(){return neutronEnergyLimit;}
   
 private:
+  G4VModularPhysicsList *BuildLeanList();
+
   G4VModularPhysicsList *thePhysicsList;
   G4OpticalPhysics *theOpticalPhysics;
-  
+  G4GenericBiasingPhysics *theBiasingPhysics;
+
+  G4String listName;
+  G4int emOption;
+
+  PhysicsListMessenger *physicsMessenger;
+
+  static G4double neutronEnergyLimit;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,29 @@
+#ifndef PhysicsListMessenger_hh
+#define PhysicsListMessenger_hh 1
+
+#include "G4UImessenger.hh"
+
+class PhysicsList;
+class G4UIdirectory;
+class G4UIcmdWithAString;
+class G4UIcmdWithAnInteger;
+
+// PhysicsListMessenger class allows the user to choose the physics
+// list before initialization.  See 'PhysicsList.hh' for more details
+class PhysicsListMessenger: public G4UImessenger
+{
+
+public:
+  PhysicsListMessenger(PhysicsList *);
+  ~PhysicsListMessenger();
+
+  void SetNewValue(G4UIcommand *, G4String);
+
+private:
+  PhysicsList *PL;
+  G4UIdirectory *physicsDir;
+  G4UIcmdWithAString *listCommand;
+  G4UIcmdWithAnInteger *emOptionCommand;
+};
+
+#endif
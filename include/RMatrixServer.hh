@@ -0,0 +1,45 @@
+#ifndef RMatrixServer_hh
+#define RMatrixServer_hh 1
+
+#include "globals.hh"
+
+#include <string>
+
+// RMatrixServer class keeps an initialized run manager alive and
+// accepts jobs from a client, so that the physics tables only have
+// to be built once for many short runs.  Jobs are read line by line
+// either from a Unix domain socket or from stdin:
+//
+//   /any/ui/command ...  applied through G4UImanager, replies "OK" or
+//                        "ERROR <status> <command>"
+//   /run/beamOn N        runs the job, replies
+//                        "DONE <events> <outputFile>"
+//   exit                 closes the current client connection
+//   shutdown             stops the server
+//
+// Every reply line starts with "RMATRIX> " so that a client reading
+// stdout can separate replies from the normal Geant4 output.
+
+class RMatrixServer
+{
+public:
+  RMatrixServer();
+  ~RMatrixServer();
+
+  // Serve jobs on the socket at socketPath, or on stdin/stdout if the
+  // path is "-".  Only returns once a client asks for a shutdown.
+  void Start(G4String socketPath);
+
+private:
+  // Handles one client until it disconnects.  Returns false if the
+  // client asked for the server to shut down
+  G4bool Session(int inFd, int outFd);
+
+  G4bool ReadLine(int fd, G4String &line);
+  void WriteLine(int fd, const G4String &line);
+
+private:
+  std::string readBuffer;
+};
+
+#endif
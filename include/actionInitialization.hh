@@ -0,0 +1,22 @@
+#ifndef actionInitialization_hh
+#define actionInitialization_hh 1
+
+#include "G4VUserActionInitialization.hh"
+
+// actionInitialization class creates the user action classes.  In
+// multithreaded runs Build() is called once per worker thread, so each
+// worker gets its own PGA, eventAction, stackingAction and
+// steppingAction, while the master only needs a runAction
+// (BuildForMaster)
+
+class actionInitialization : public G4VUserActionInitialization
+{
+public:
+  actionInitialization();
+  ~actionInitialization();
+
+  void BuildForMaster() const override;
+  void Build() const override;
+};
+
+#endif
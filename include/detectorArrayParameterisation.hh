@@ -0,0 +1,34 @@
+#ifndef detectorArrayParameterisation_hh
+#define detectorArrayParameterisation_hh 1
+
+#include "G4VPVParameterisation.hh"
+#include "G4ThreeVector.hh"
+
+#include <vector>
+
+class G4Material;
+
+// detectorArrayParameterisation class places the copies of the
+// scintillator cylinder that make up the detector array.  Copy number
+// i sits at position i (in the frame of the envelope) and is made of
+// material i, so one logical volume serves every detector and the copy
+// number of a touchable identifies the detector.
+
+class detectorArrayParameterisation : public G4VPVParameterisation
+{
+public:
+  detectorArrayParameterisation(const std::vector<G4ThreeVector> &positions,
+				const std::vector<G4Material *> &materials);
+  ~detectorArrayParameterisation();
+
+  void ComputeTransformation(const G4int copyNo, G4VPhysicalVolume *) const override;
+
+  G4Material *ComputeMaterial(const G4int copyNo, G4VPhysicalVolume *,
+			      const G4VTouchable *parentTouch = nullptr) override;
+
+private:
+  std::vector<G4ThreeVector> detectorPositions;
+  std::vector<G4Material *> detectorMaterials;
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef detectorArrayTally_hh
+#define detectorArrayTally_hh 1
+
+#include "G4VAccumulable.hh"
+#include "globals.hh"
+
+#include <vector>
+
+// detectorArrayTally class counts, over a run, how often each detector
+// of the array saw light, how many detectors saw light in the same
+// event (multiplicity) and how often each pair of detectors fired
+// together (cross-talk).  It is an accumulable, registered in runAction
+// and merged at the end of the run.
+
+class detectorArrayTally : public G4VAccumulable
+{
+public:
+  detectorArrayTally(const G4String &name = "detectorArrayTally");
+  ~detectorArrayTally();
+
+  // Changing the number of detectors clears the tallies
+  void SetNumberOfDetectors(G4int);
+  G4int GetNumberOfDetectors() const { return nDetectors; }
+
+  // Tallies one event, given the copy numbers of the detectors that fired
+  void Fill(const std::vector<G4int> &firedDetectors, G4double weight = 1.);
+
+  void Merge(const G4VAccumulable &other) override;
+  void Reset() override;
+
+  // Prints the tallies, as fractions of nEvents
+  void Print(G4int nEvents) const;
+
+  // Appends the tallies to buffer, and reads them back from position
+  // on, returning the position after them (see responseMatrix)
+  void Pack(std::vector<G4double> &buffer) const;
+  std::size_t Unpack(const std::vector<G4double> &buffer, std::size_t position);
+
+private:
+  G4int nDetectors;
+
+  std::vector<G4double> singles;
+  std::vector<G4double> multiplicity;
+  std::vector<G4double> pairs;
+};
+
+#endif
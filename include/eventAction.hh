@@ -3,13 +3,18 @@
 
 #include "G4UserEventAction.hh"
 #include "G4Event.hh"
+#include "G4ThreeVector.hh"
 
 #include "eventActionMessenger.hh"
+#include "lightCollectionMap.hh"
 
 #include <fstream>
 #include <list>
+#include <vector>
 
 class runAction;
+class geometryConstruction;
+class G4Track;
 
 // eventAction class handles information about entire events.  More
 // specifically, it will receive energy deposited per step from
@@ -22,7 +27,7 @@ class eventAction : public G4UserEventAction
 {
 
 public:
-  eventAction();
+  eventAction(runAction *);
   ~eventAction();
 
   // These are virtual functions of G4UserEventAction that the user
@@ -31,14 +36,48 @@ public:
   void BeginOfEventAction(const G4Event *);
   void EndOfEventAction(const G4Event *);
   
-  // This is a user-dfined function to add the energy deposited at
-  // each step to a variable that holds total energy deposited per
-  // event.  It is called by "steppingAction.cc" every time there is
-  // energy deposited on a step
-  void AddPhotonCreated(G4int Photons)  
+  // Origin of a track in a mixed neutron/gamma field: the species of
+  // the primary it descends from, plus originViaGamma if it is a gamma
+  // or descends from one
+  enum trackOrigin { originNone = 0, originNeutron = 1, originGamma = 2, originOther = 3,
+		     originViaGamma = 4, nOrigins = 8 };
+
+  // Adds the scintillation photons made on a step (called by
+  // steppingAction) to the event's count, in the branch of the Weight
+  // of the track that made them.  Unless the light collection map is
+  // applied, they are also the light of the detector they were made in
+  // (copy number Detector) and of their Origin (see TagTrack)
+  void AddPhotonCreated(G4int Photons, G4double Weight = 1., G4int Detector = 0, G4int Origin = 0)
   {PhotonsCreated += Photons;
+   lightBranch &branch = Branch(Weight);
+   branch.created += Photons;
+   if(lightCollectionMap::GetMode() != lightCollectionMap::collectionApply){
+     AddDetectorLight(branch, Photons, Detector);
+     branch.originLight[Origin] += Photons;
+   }
+  };
+
+  // Photons reaching the readout face, either counted one by one in a
+  // light collection calibration run or drawn from the light
+  // collection map (see 'lightCollectionMap.hh')
+  void AddPhotonCollected(G4int Photons, G4double Weight = 1., G4int Detector = 0, G4int Origin = 0)
+  {PhotonsCollected += Photons;
+   lightBranch &branch = Branch(Weight);
+   branch.collected += Photons;
+   if(lightCollectionMap::GetMode() == lightCollectionMap::collectionApply){
+     AddDetectorLight(branch, Photons, Detector);
+     branch.originLight[Origin] += Photons;
+   }
   };
 
+  // Called from stackingAction for every new track while gammas are
+  // tracked, parents always before their daughters.  Returns the
+  // track's origin
+  G4int TagTrack(const G4Track *);
+
+  G4int GetTrackOrigin(G4int trackID) const
+  { return (trackID < G4int(trackOrigins.size())) ? trackOrigins[trackID] : G4int(originNone); }
+
   void SetEnergy(G4double PartEnergy)
   {
     if (NeutronEnergy == 0)
@@ -50,27 +89,154 @@ public:
     return NeutronEnergy;
   }
 
-  // The following two functions are called from eventActionMessenger
+  // Called from steppingAction when the primary neutron first enters
+  // the scintillator, and from stackingAction for the first recoil it
+  // makes, while neutronResponseModel is training or comparing
+  void SetNeutronEntry(G4double energy,
+		       const G4ThreeVector &localPos, const G4ThreeVector &localDir,
+		       G4double radius, G4double halfLength, G4double weight)
+  {
+    if(entryRecorded)
+      return;
+    entryRecorded = true;
+    entryEnergy = energy;
+    entryPosition = localPos;
+    entryDirection = localDir;
+    entryRadius = radius;
+    entryHalfLength = halfLength;
+    entryWeight = weight;
+  }
+
+  G4bool HasNeutronEntry() const
+  { return entryRecorded; }
+
+  // Called from neutronResponseModel as the primary neutron enters the
+  // scintillator in fast mode.  True only for its first entry of the
+  // event, the only one the table was trained on
+  G4bool FirstPrimaryEntry()
+  {
+    if(primaryEntered)
+      return false;
+    primaryEntered = true;
+    return true;
+  }
+
+  void SetRecoilSpecies(G4int species)
+  {
+    if(recoilSpecies < 0)
+      recoilSpecies = species;
+  }
+
+  // The following functions are called from eventActionMessenger
   // at runtime when the user desires to change something....
-  void SetDataOutput(G4String onOff)
-  { if(onOff == "on") dataOutputSwitch = true;
-    if(onOff == "off") dataOutputSwitch = false;};
+  void SetDataOutput(G4String onOff);
+
+  // A detector of the array counts as fired when it sees more than
+  // this many photons
+  void SetHitThreshold(G4int threshold)
+  { hitThreshold = threshold; }
   
-  void SetOutputFileName(G4String fName)
-  {if(eventOutput.is_open()) eventOutput.close();
-    eventOutput.open(fName,std::ofstream::trunc);};
+  void SetOutputFileName(G4String fName);
+
+  // The output settings are shared by every worker thread, so they can
+  // be read back from the master (e.g. by RMatrixServer) after a run.
+  // In multithreaded runs each worker writes to its own copy of the
+  // file, named with a "_t<threadID>" suffix
+  static G4String GetOutputFileName();
+
+  static G4bool GetDataOutput();
   
 private:
+  G4String ThreadFileName(G4String);
+
+  // Light of the event by the weight of the tracks that made it.
+  // Without biasing it all has the weight of the primary.  Forced
+  // collisions split a neutron into copies that stand for different
+  // histories of the event, so light made with different weights is
+  // written and tallied as separate histories, each with its weight,
+  // rather than as one with the mean weight
+  struct lightBranch
+  {
+    G4double weight;
+    G4int created;
+    G4int collected;
+    G4int originLight[nOrigins];
+
+    // Light per detector of the array, in a hit array indexed by copy
+    // number, and the detectors that saw any
+    std::vector<G4int> detectorPhotons;
+    std::vector<G4int> litDetectors;
+  };
+
+  // The branch of this weight, started if there is none yet.  Branches
+  // keep their storage from one event to the next
+  lightBranch &Branch(G4double weight)
+  {
+    for(G4int i=0; i<nBranches; i++)
+      if(branches[i].weight == weight)
+	return branches[i];
+    return NewBranch(weight);
+  }
+
+  lightBranch &NewBranch(G4double weight);
+
+  void AddDetectorLight(lightBranch &branch, G4int Photons, G4int Detector)
+  {
+    if(Detector < 0 or Detector >= G4int(branch.detectorPhotons.size()))
+      return;
+    if(branch.detectorPhotons[Detector] == 0)
+      branch.litDetectors.push_back(Detector);
+    branch.detectorPhotons[Detector] += Photons;
+  }
+
+  const geometryConstruction *geometry;
+
+  std::vector<lightBranch> branches;
+  G4int nBranches;
+  std::vector<G4int> firedDetectors;
+
+  G4int hitThreshold;
+
+  // Origin of every track of the event, indexed by track ID, and the
+  // energy and weight of the first primary of each origin
+  std::vector<G4int> trackOrigins;
+  G4bool originsTracked;
+  G4double primaryEnergies[4];
+  G4double primaryWeights[4];
+
+  runAction *rnAction;
+
   G4int PhotonsCreated;
+
+  G4int PhotonsCollected;
   
   G4double NeutronEnergy;
 
   G4bool dataOutputSwitch;
+
+  G4bool entryRecorded;
+  G4bool primaryEntered;
+  G4double entryEnergy;
+  G4ThreeVector entryPosition;
+  G4ThreeVector entryDirection;
+  G4double entryRadius;
+  G4double entryHalfLength;
+  G4double entryWeight;
+  G4int recoilSpecies;
+
+#ifdef RMATRIX_TRACING
+  // Start of the event's tracking, for the trace
+  G4long traceEventStart;
+#endif
  
   eventActionMessenger *eventMessenger;
   
   std::ofstream eventOutput;
 
+  static G4String outputFileName;
+
+  static G4bool outputEnabled;
+
   std::ofstream processOutput;
 
   std::ofstream detectOutput;
@@ -6,6 +6,7 @@
 class eventAction;
 class G4UIdirectory;
 class G4UIcmdWithAString;
+class G4UIcmdWithAnInteger;
 
 // eventActionMessenger class allows the user to interface with
 // eventAction class.  See 'eventAction.hh' for more details
@@ -23,6 +24,7 @@ private:
   G4UIdirectory *outputDir;
   G4UIcmdWithAString *fileCommand;
   G4UIcmdWithAString *dataCommand;
+  G4UIcmdWithAnInteger *thresholdCommand;
 };
 
 #endif
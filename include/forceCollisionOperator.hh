@@ -0,0 +1,62 @@
+#ifndef forceCollisionOperator_hh
+#define forceCollisionOperator_hh 1
+
+#include "G4VBiasingOperator.hh"
+
+class G4BOptrForceCollision;
+
+// forceCollisionOperator class forces neutrons entering the volume it
+// is attached to (the scintillator) to interact there, following the
+// G4BOptrForceCollision scheme: the incoming neutron is split into an
+// uncollided copy that crosses the volume and a collided copy that is
+// made to interact inside it, each carrying the matching weight.  The
+// weights are passed on to all secondaries, down to the optical
+// photons counted in stackingAction.
+//
+// Biasing operators are thread local; the on/off switch is shared and
+// only read when a new track starts.
+
+class forceCollisionOperator : public G4VBiasingOperator
+{
+public:
+  forceCollisionOperator();
+  ~forceCollisionOperator();
+
+  void StartTracking(const G4Track *) override;
+
+  static void SetEnabled(G4bool on)
+  { enabled = on; }
+
+  static G4bool IsEnabled()
+  { return enabled; }
+
+private:
+  G4VBiasingOperation *ProposeNonPhysicsBiasingOperation(const G4Track *,
+							 const G4BiasingProcessInterface *) override;
+  G4VBiasingOperation *ProposeOccurenceBiasingOperation(const G4Track *,
+							const G4BiasingProcessInterface *) override;
+  G4VBiasingOperation *ProposeFinalStateBiasingOperation(const G4Track *,
+							 const G4BiasingProcessInterface *) override;
+
+  using G4VBiasingOperator::OperationApplied;
+  void OperationApplied(const G4BiasingProcessInterface *,
+			G4BiasingAppliedCase,
+			G4VBiasingOperation *,
+			const G4VParticleChange *) override;
+  void OperationApplied(const G4BiasingProcessInterface *,
+			G4BiasingAppliedCase,
+			G4VBiasingOperation *,
+			G4double,
+			G4VBiasingOperation *,
+			const G4VParticleChange *) override;
+
+private:
+  G4BOptrForceCollision *neutronOperator;
+
+  // Operator used for the track being followed, null if unbiased
+  G4BOptrForceCollision *currentOperator;
+
+  static G4bool enabled;
+};
+
+#endif
@@ -3,16 +3,102 @@
 
 #include "G4VUserDetectorConstruction.hh"
 #include "G4VPhysicalVolume.hh"
+#include "G4ThreeVector.hh"
 
+#include <vector>
+
+class geometryConstructionMessenger;
+class G4LogicalVolume;
+class G4ProductionCuts;
+class G4Material;
+class detectorArrayParameterisation;
 
 class geometryConstruction : public G4VUserDetectorConstruction
 {
 public:
   geometryConstruction();
   ~geometryConstruction();
-  
+
   // Main function
   G4VPhysicalVolume *Construct();
+
+  // Attaches the (thread local) biasing operators and fast simulation
+  // model to the scintillator
+  void ConstructSDandField();
+
+  // The following functions are called from geometryConstructionMessenger
+  // at runtime.  Each one flags the geometry for rebuilding before the
+  // next run if the run manager has already been initialized
+  void SetScintMaterial(G4String);
+  void SetScintRadius(G4double);
+  void SetScintHalfLength(G4double);
+  void SetScintPositionZ(G4double);
+  void SetEnvelopeMargin(G4double);
+
+  // Detector array.  Once a detector has been added, the array replaces
+  // the single detector set by SetScintMaterial/SetScintPositionZ; all
+  // detectors share the cylinder size.  An empty material name means
+  // the current scintillator material
+  void AddDetector(G4ThreeVector position, G4String material);
+  void ClearDetectors();
+
+  // Sets the production cut for "e-", "e+", "gamma", "proton" or "all"
+  // in the "scintillator" or "envelope" region.  Regions without user
+  // cuts fall back on the world defaults (/run/setCut)
+  void SetRegionCut(G4String region, G4String particle, G4double cut);
+
+  // Turns forced neutron collisions in the scintillator on or off
+  void SetForceCollision(G4String onOff);
+
+  // The envelope is an air box around the detectors, used to stop
+  // neutrons that have scattered out of them (steppingAction).  The
+  // scintillator volume is shared by all detectors, and the copy number
+  // of a touchable in it is the index of the detector
+  G4LogicalVolume *GetWorldVolume() const { return world_L; }
+  G4LogicalVolume *GetEnvelopeVolume() const { return envelope_L; }
+  G4LogicalVolume *GetScintVolume() const { return block_L; }
+
+  // Glass window on the readout (+z) face of every detector, with the
+  // copy number of its detector.  Only built in light collection
+  // calibration runs, null otherwise
+  G4LogicalVolume *GetReadoutVolume() const { return window_L; }
+
+  // Bounding spheres (centre and radius, in world coordinates) of the
+  // detectors, used by PGA to aim the source at them
+  const std::vector<G4ThreeVector> &GetDetectorCentres() const { return detectorCentres; }
+  const std::vector<G4double> &GetDetectorRadii() const { return detectorRadii; }
+
+  G4int GetNumberOfDetectors() const { return G4int(detectorCentres.size()); }
+  G4Material *GetDetectorMaterial(G4int copyNo) const { return detectorMaterials[copyNo]; }
+
+private:
+  void GeometryChanged();
+
+  G4String Scint_material;
+  G4double Scint_rMax;
+  G4double Scint_z;
+  G4double Scint_posZ;
+  G4double Envelope_margin;
+
+  std::vector<G4ThreeVector> arrayPositions;
+  std::vector<G4String> arrayMaterials;
+
+  G4LogicalVolume *world_L;
+  G4LogicalVolume *envelope_L;
+  G4LogicalVolume *block_L;
+  G4LogicalVolume *window_L;
+
+  G4ProductionCuts *scintCuts;
+  G4ProductionCuts *envelopeCuts;
+
+  std::vector<G4ThreeVector> detectorCentres;
+  std::vector<G4double> detectorRadii;
+  std::vector<G4Material *> detectorMaterials;
+
+  detectorArrayParameterisation *arrayParameterisation;
+  detectorArrayParameterisation *windowParameterisation;
+
+  geometryConstructionMessenger *geometryMessenger;
 };
 
 #endif
@@ -0,0 +1,39 @@
+#ifndef geometryConstructionMessenger_hh
+#define geometryConstructionMessenger_hh 1
+
+#include "G4UImessenger.hh"
+
+class geometryConstruction;
+class G4UIdirectory;
+class G4UIcommand;
+class G4UIcmdWithAString;
+class G4UIcmdWithADoubleAndUnit;
+
+// geometryConstructionMessenger class allows the user to change the
+// detector configuration at runtime.  See 'geometryConstruction.hh'
+// for more details
+class geometryConstructionMessenger: public G4UImessenger
+{
+
+public:
+  geometryConstructionMessenger(geometryConstruction *);
+  ~geometryConstructionMessenger();
+
+  void SetNewValue(G4UIcommand *, G4String);
+
+private:
+  geometryConstruction *GC;
+  G4UIdirectory *geometryDir;
+  G4UIcmdWithAString *materialCommand;
+  G4UIcmdWithADoubleAndUnit *radiusCommand;
+  G4UIcmdWithADoubleAndUnit *lengthCommand;
+  G4UIcmdWithADoubleAndUnit *positionCommand;
+  G4UIcmdWithADoubleAndUnit *marginCommand;
+  G4UIcommand *cutCommand;
+  G4UIcommand *addDetectorCommand;
+  G4UIcommand *clearDetectorsCommand;
+  G4UIdirectory *biasDir;
+  G4UIcmdWithAString *forceCollisionCommand;
+};
+
+#endif
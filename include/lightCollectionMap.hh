@@ -0,0 +1,116 @@
+#ifndef lightCollectionMap_hh
+#define lightCollectionMap_hh 1
+
+#include "G4VAccumulable.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+#include <vector>
+
+// lightCollectionMap class holds the probability that a scintillation
+// photon emitted at a given point of the scintillator is collected at
+// its readout face (the +z cap of the cylinder, where the photodetector
+// is coupled).  The cylinder is divided into (r, phi, z) voxels and
+// each voxel keeps the number of photons emitted in it and collected.
+//
+// The map is built once per scintillator material and size by a
+// calibration run with full optical transport: PGA emits photons with
+// the material's emission spectrum from random points in the
+// scintillator and steppingAction counts those that get through the
+// optical coupling into the readout window, geometryConstruction
+// wrapping the other faces in a reflector.  The map is an accumulable,
+// merged at the end of the run and written to disk.  Production runs
+// read it back and, instead of tracking optical photons, collect each
+// scintillation step's photons with a binomial draw from the map
+// (steppingAction).
+//
+// The mode and the map read from disk are shared by all threads and
+// set through lightCollectionMapMessenger:
+//   off       - only the photons created are counted (default)
+//   calibrate - build the map; the source is replaced by photons and
+//               the detectors get their readout windows and wrapping
+//   apply     - count collected photons as well, using the map; every
+//               detector has to be of the material and size the map
+//               was made for (checked at the start of every run)
+
+class lightCollectionMap : public G4VAccumulable
+{
+public:
+  lightCollectionMap(const G4String &name = "lightCollectionMap");
+  ~lightCollectionMap();
+
+  enum collectionMode { collectionOff, collectionCalibrate, collectionApply };
+
+  // Changing the binning or the cylinder clears the map
+  void SetBinning(G4int nR, G4int nPhi, G4int nZ);
+  void SetCylinder(G4String material, G4double radius, G4double halfLength);
+
+  // Position in the frame of the scintillator cylinder
+  void Fill(const G4ThreeVector &localPos, G4int nEmitted, G4int nCollected);
+  G4double GetProbability(const G4ThreeVector &localPos) const;
+
+  // Collected fraction over the whole volume, for photons whose point
+  // of emission is not known
+  G4double GetMeanProbability() const { return meanProbability; }
+
+  // The scintillator the map was made for, and whether a cylinder of
+  // this material and size is that scintillator
+  const G4String &GetMaterialName() const { return materialName; }
+  G4double GetRadius() const { return cylinderRadius; }
+  G4double GetHalfLength() const { return cylinderHalfLength; }
+  G4bool Matches(const G4String &material, G4double radius, G4double halfLength) const;
+
+  G4bool Write(const G4String &fileName) const;
+  G4bool Read(const G4String &fileName);
+
+  void Merge(const G4VAccumulable &other) override;
+  void Reset() override;
+
+  // The following functions are called from lightCollectionMapMessenger
+  // at runtime, on the master only
+  static void SetMode(G4String);
+  static void SetMapFile(G4String fileName);
+  static void SetMapBinning(G4int nR, G4int nPhi, G4int nZ);
+  static void SetPhotonsPerEvent(G4int nPhotons)
+  { photonsPerEvent = nPhotons; }
+
+  static collectionMode GetMode() { return mode; }
+  static G4String GetMapFile() { return mapFile; }
+  static G4int GetPhotonsPerEvent() { return photonsPerEvent; }
+
+  // Gives a calibration map the binning chosen by the user
+  static void ConfigureMap(lightCollectionMap &);
+
+  // The map read from the map file, null unless in apply mode
+  static const lightCollectionMap *GetMap() { return loadedMap; }
+
+private:
+  G4int FindVoxel(const G4ThreeVector &localPos) const;
+  void BuildProbabilities();
+
+  static void LoadMap();
+
+  G4String materialName;
+  G4double cylinderRadius;
+  G4double cylinderHalfLength;
+
+  G4int nRBins;
+  G4int nPhiBins;
+  G4int nZBins;
+
+  std::vector<G4double> emitted;
+  std::vector<G4double> collected;
+  std::vector<G4double> probability;
+  G4double meanProbability;
+
+  static collectionMode mode;
+  static G4String mapFile;
+  static lightCollectionMap *loadedMap;
+
+  static G4int mapRBins;
+  static G4int mapPhiBins;
+  static G4int mapZBins;
+  static G4int photonsPerEvent;
+};
+
+#endif
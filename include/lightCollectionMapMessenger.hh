@@ -0,0 +1,32 @@
+#ifndef lightCollectionMapMessenger_hh
+#define lightCollectionMapMessenger_hh 1
+
+#include "G4UImessenger.hh"
+
+class G4UIdirectory;
+class G4UIcommand;
+class G4UIcmdWithAString;
+class G4UIcmdWithAnInteger;
+
+// lightCollectionMapMessenger class allows the user to calibrate and
+// apply the light collection map.  Its settings are shared by all
+// threads, so it only exists on the master and its commands are not
+// broadcast.  See 'lightCollectionMap.hh' for more details
+class lightCollectionMapMessenger: public G4UImessenger
+{
+
+public:
+  lightCollectionMapMessenger();
+  ~lightCollectionMapMessenger();
+
+  void SetNewValue(G4UIcommand *, G4String);
+
+private:
+  G4UIdirectory *mapDir;
+  G4UIcmdWithAString *modeCommand;
+  G4UIcmdWithAString *fileCommand;
+  G4UIcommand *binningCommand;
+  G4UIcmdWithAnInteger *photonsCommand;
+};
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef neutronHPPhysics_hh
+#define neutronHPPhysics_hh 1
+
+#include "G4VPhysicsConstructor.hh"
+
+// neutronHPPhysics class registers only the data driven (G4ParticleHP)
+// inelastic and capture processes for neutrons.  Together with
+// G4HadronElasticPhysicsHP this covers neutrons up to 20 MeV, the upper
+// limit of the evaluated data, without any of the cascade or string
+// models of a full reference list.
+
+class neutronHPPhysics : public G4VPhysicsConstructor
+{
+public:
+  neutronHPPhysics(const G4String &name = "neutronHP");
+  ~neutronHPPhysics();
+
+  void ConstructParticle() override;
+  void ConstructProcess() override;
+};
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef neutronResponseModel_hh
+#define neutronResponseModel_hh 1
+
+#include "G4VFastSimulationModel.hh"
+
+class neutronResponseTable;
+class G4Region;
+
+// neutronResponseModel class is a fast simulation model for neutrons
+// entering the scintillator region.  Instead of transporting the
+// neutron through the detector with G4ParticleHP, it looks up the
+// neutron's incident energy, entry point and direction in a
+// neutronResponseTable, draws the light it makes from the table and
+// kills it.  The model runs in one of four modes, shared by all
+// threads and set through neutronResponseModelMessenger:
+//   off     - full transport (default)
+//   train   - full transport; runAction fills a table with the first
+//             entry of each primary neutron and the event's light, and
+//             writes it to the table file at the end of the run
+//   fast    - the table file is read and the model replaces transport
+//             for the first entry of each primary neutron, as trained,
+//             when it falls in a cell of the table that has training
+//             data.  The table must have been trained on the same
+//             scintillator as the detectors
+//   compare - full transport, while runAction also draws the fast
+//             model's light for every entering primary, so that the
+//             two response matrices can be compared at the end of run
+//
+// Models are thread local; geometryConstruction attaches one to the
+// scintillator region on each thread.  The model only runs if the
+// physics list registered fast simulation for neutrons, which it does
+// when fast mode is chosen before the list is built (RMatrixGen
+// --fast-response); the other modes keep the plain transport.
+
+class neutronResponseModel : public G4VFastSimulationModel
+{
+public:
+  neutronResponseModel(G4Region *);
+  ~neutronResponseModel();
+
+  G4bool IsApplicable(const G4ParticleDefinition &) override;
+  G4bool ModelTrigger(const G4FastTrack &) override;
+  void DoIt(const G4FastTrack &, G4FastStep &) override;
+
+  enum responseMode { responseOff, responseTrain, responseFast, responseCompare };
+
+  // The following functions are called from
+  // neutronResponseModelMessenger at runtime, on the master only
+  static void SetMode(G4String);
+  static void SetTableFile(G4String);
+  static void SetEnergyBinning(G4int nBins, G4double eMin, G4double eMax);
+  static void SetEntryBinning(G4int nPosition, G4int nDirection);
+  static void SetLightBinning(G4int nBins, G4double lightMax);
+
+  // Called by PhysicsList as it builds the list, with whether it
+  // registered fast simulation for neutrons
+  static void SetFastSimulationPhysics(G4bool registered)
+  { physicsBuilt = true;
+    fastSimulationPhysics = registered; }
+
+  static responseMode GetMode() { return mode; }
+  static G4String GetTableFile() { return tableFile; }
+
+  // True when the entry of primary neutrons into the scintillator has
+  // to be recorded for runAction (train and compare modes)
+  static G4bool IsRecordingEntries()
+  { return mode == responseTrain or mode == responseCompare; }
+
+  // Gives a training table the binning chosen by the user
+  static void ConfigureTable(neutronResponseTable &);
+
+  // The table read from the table file, null unless in fast or
+  // compare mode
+  static const neutronResponseTable *GetTable() { return table; }
+
+private:
+  static void LoadTable();
+
+  // Cell found by ModelTrigger() for DoIt()
+  G4int triggeredCell;
+
+  static responseMode mode;
+  static G4String tableFile;
+  static neutronResponseTable *table;
+  static G4bool physicsBuilt;
+  static G4bool fastSimulationPhysics;
+
+  static G4int nEnergyBins;
+  static G4double energyMin;
+  static G4double energyMax;
+  static G4int nPositionBins;
+  static G4int nDirectionBins;
+  static G4int nLightBins;
+  static G4double lightMax;
+};
+
+#endif
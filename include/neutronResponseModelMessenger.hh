@@ -0,0 +1,33 @@
+#ifndef neutronResponseModelMessenger_hh
+#define neutronResponseModelMessenger_hh 1
+
+#include "G4UImessenger.hh"
+
+class G4UIdirectory;
+class G4UIcommand;
+class G4UIcmdWithAString;
+
+// neutronResponseModelMessenger class allows the user to choose how
+// neutronResponseModel is used and to set up its tables.  Its settings
+// are shared by all threads, so it only exists on the master and its
+// commands are not broadcast.  See 'neutronResponseModel.hh' for more
+// details
+class neutronResponseModelMessenger: public G4UImessenger
+{
+
+public:
+  neutronResponseModelMessenger();
+  ~neutronResponseModelMessenger();
+
+  void SetNewValue(G4UIcommand *, G4String);
+
+private:
+  G4UIdirectory *responseDir;
+  G4UIcmdWithAString *modeCommand;
+  G4UIcmdWithAString *fileCommand;
+  G4UIcommand *energyCommand;
+  G4UIcommand *entryCommand;
+  G4UIcommand *lightCommand;
+};
+
+#endif
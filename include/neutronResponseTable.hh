@@ -0,0 +1,103 @@
+#ifndef neutronResponseTable_hh
+#define neutronResponseTable_hh 1
+
+#include "G4VAccumulable.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+#include <vector>
+
+// neutronResponseTable class holds the interaction kernels used by
+// neutronResponseModel: for a neutron entering the scintillator, the
+// joint distribution of the first recoil species and the light the
+// neutron eventually makes in the detector.  The table is indexed by
+//   - incident kinetic energy (linear bins),
+//   - entry face of the cylinder (front cap, side, back cap) and the
+//     position on it (r/R on the caps, (z+H)/2H on the side),
+//   - cosine of the angle between the direction and the inward normal.
+//
+// A full-transport training run fills the table (it is an accumulable,
+// merged at the end of the run) and writes it to disk; fast runs read
+// it back and sample from it.  The file records the scintillator the
+// table was trained on, which the detectors of a fast run must match.
+
+class neutronResponseTable : public G4VAccumulable
+{
+public:
+  neutronResponseTable(const G4String &name = "neutronResponseTable");
+  ~neutronResponseTable();
+
+  enum recoilSpecies { noRecoil, protonRecoil, alphaRecoil, ionRecoil, otherRecoil, nSpecies };
+
+  // Changing the binning clears the table
+  void SetBinning(G4int nEnergy, G4double eMin, G4double eMax,
+		  G4int nPosition, G4int nDirection,
+		  G4int nLight, G4double lightMax);
+
+  // The scintillator the table is trained on
+  void SetCylinder(G4String material, G4double radius, G4double halfLength);
+
+  // The scintillator the table was trained on, and whether a cylinder
+  // of this material and size is that scintillator
+  const G4String &GetMaterialName() const { return materialName; }
+  G4double GetRadius() const { return cylinderRadius; }
+  G4double GetHalfLength() const { return cylinderHalfLength; }
+  G4bool Matches(const G4String &material, G4double radius, G4double halfLength) const;
+
+  // Returns the cell of a neutron of the given energy entering a
+  // cylinder of the given radius and half length at localPos along
+  // localDir (both in the cylinder's frame), or -1 if out of range
+  G4int FindCell(G4double energy,
+		 const G4ThreeVector &localPos, const G4ThreeVector &localDir,
+		 G4double radius, G4double halfLength) const;
+
+  // Tallies one training neutron.  Neutrons that made no light are
+  // always stored as noRecoil
+  void Fill(G4int cell, G4int species, G4double light, G4double weight = 1.);
+
+  G4bool IsEmpty(G4int cell) const
+  { return cellSums.empty() or cellSums[cell] <= 0.; }
+
+  // Draws the species and light of a neutron entering in the given
+  // (non empty) cell.  Needs BuildSamplingTables() after filling
+  G4double Sample(G4int cell, G4int &species) const;
+
+  void BuildSamplingTables();
+
+  G4double GetEnergyMin() const { return energyMin; }
+  G4double GetEnergyMax() const { return energyMax; }
+  G4int GetNumberOfEnergyBins() const { return nEnergyBins; }
+  G4int GetNumberOfLightBins() const { return nLightBins; }
+  G4double GetLightMax() const { return lightMax; }
+
+  // Plain text, one line per non empty cell
+  G4bool Write(const G4String &fileName) const;
+  G4bool Read(const G4String &fileName);
+
+  void Merge(const G4VAccumulable &other) override;
+  void Reset() override;
+
+private:
+  G4int nEnergyBins;
+  G4double energyMin;
+  G4double energyMax;
+  G4int nPositionBins;
+  G4int nDirectionBins;
+  G4int nLightBins;
+  G4double lightMax;
+  G4int nCells;
+
+  G4String materialName;
+  G4double cylinderRadius;
+  G4double cylinderHalfLength;
+
+  // [cell][species][light bin], allocated on the first Fill() so that
+  // the table costs nothing when it is registered but not used
+  std::vector<G4double> counts;
+  std::vector<G4double> cellSums;
+
+  // Normalised cumulative of counts, per cell
+  std::vector<G4double> cumulative;
+};
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef progressMonitor_hh
+#define progressMonitor_hh 1
+
+#include "globals.hh"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+// progressMonitor class reports the progress of a run while it goes:
+// events done and to go, events/s, photons/s (the light of the event,
+// created or collected), the estimated time left, the throughput of
+// each thread, the resident memory and the fraction of events that
+// made light.  A report is printed every interval seconds and, if a
+// metrics file is set, written to it in the Prometheus text format,
+// for a node exporter textfile collector to pick up.
+//
+// Every thread counts its events in its own slot from eventAction;
+// whichever thread first finds the interval has passed prints the
+// report.  With the interval at zero (the default) nothing is counted.
+// All settings are changed on the master, between runs.
+
+class progressMonitor
+{
+public:
+  // Called from runAction on the master at the start and end of a run
+  static void StartRun(G4long nEventsToProcess, G4int nThreads);
+  static void EndRun();
+
+  // Called from eventAction at the end of every event, with the light
+  // of the event
+  static void EventDone(G4int photons)
+  {
+    if(interval <= 0.)
+      return;
+
+    threadSlot &slot = slots[SlotIndex()];
+    slot.events.fetch_add(1, std::memory_order_relaxed);
+    slot.photons.fetch_add(photons, std::memory_order_relaxed);
+    if(photons > 0)
+      slot.litEvents.fetch_add(1, std::memory_order_relaxed);
+
+    G4long now = Clock();
+    G4long due = nextReport.load(std::memory_order_relaxed);
+    if(now >= due and nextReport.compare_exchange_strong(due, now + G4long(interval*1e9)))
+      Report(false);
+  }
+
+  // Totals of the current (or last) run, for RMatrixBench.  Only
+  // counted while the interval is set
+  static G4long GetEventsDone();
+  static G4long GetPhotons();
+
+  // The following functions are called from progressMonitorMessenger
+  // at runtime, on the master only
+  static void SetInterval(G4double seconds)
+  { interval = seconds; }
+
+  static void SetMetricsFile(G4String fileName)
+  { metricsFile = (fileName == "none") ? G4String("") : fileName; }
+
+private:
+  struct alignas(64) threadSlot
+  {
+    std::atomic<G4long> events;
+    std::atomic<G4long> photons;
+    std::atomic<G4long> litEvents;
+
+    // Events at the previous report, for the rate since then
+    G4long reportedEvents;
+  };
+
+  static G4int SlotIndex();
+
+  // Nanoseconds since the start of the run
+  static G4long Clock()
+  { return std::chrono::duration_cast<std::chrono::nanoseconds>
+      (std::chrono::steady_clock::now() - startTime).count(); }
+
+  static void Report(G4bool endOfRun);
+  static void WriteMetrics(G4double elapsed, G4long events, G4double eventRate,
+			   G4double photonRate, G4double litFraction, G4double eta,
+			   G4double rss, const G4double *threadRates);
+
+  // Resident set size of the process in bytes
+  static G4double ResidentMemory();
+
+  static G4double interval;
+  static G4String metricsFile;
+
+  static std::unique_ptr<threadSlot[]> slots;
+  static G4int nSlots;
+  static G4long eventsToProcess;
+
+  static std::chrono::steady_clock::time_point startTime;
+  static std::atomic<G4long> nextReport;
+
+  // Guards the report, and the state kept from one report to the next
+  static std::mutex reportMutex;
+  static G4long lastReportClock;
+  static G4long lastReportPhotons;
+};
+
+#endif
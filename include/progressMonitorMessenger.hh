@@ -0,0 +1,29 @@
+#ifndef progressMonitorMessenger_hh
+#define progressMonitorMessenger_hh 1
+
+#include "G4UImessenger.hh"
+
+class G4UIdirectory;
+class G4UIcmdWithAString;
+class G4UIcmdWithADoubleAndUnit;
+
+// progressMonitorMessenger class allows the user to have the progress
+// of a run reported while it goes.  Its settings are shared by all
+// threads, so it only exists on the master and its commands are not
+// broadcast.  See 'progressMonitor.hh' for more details
+class progressMonitorMessenger: public G4UImessenger
+{
+
+public:
+  progressMonitorMessenger();
+  ~progressMonitorMessenger();
+
+  void SetNewValue(G4UIcommand *, G4String);
+
+private:
+  G4UIdirectory *progressDir;
+  G4UIcmdWithADoubleAndUnit *intervalCommand;
+  G4UIcmdWithAString *metricsCommand;
+};
+
+#endif
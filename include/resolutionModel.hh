@@ -0,0 +1,89 @@
+#ifndef resolutionModel_hh
+#define resolutionModel_hh 1
+
+#include "globals.hh"
+
+#include <map>
+#include <vector>
+
+class responseMatrix;
+
+// resolutionModel class folds the detector resolution into the light
+// axis of the response matrices, on top of the photon statistics that
+// RESOLUTIONSCALE already gives the scintillation.  The resolution is
+// the relative FWHM of a Gaussian,
+//
+//   R(L) = sqrt(alpha^2 + beta^2/L + gamma^2/L^2)
+//
+// with L the light in units of lightUnit photons (1 by default, so L is
+// in photons; e.g. the photons per MeVee gives L in MeVee), or a curve
+// of R against L tabulated for the scintillator material, which takes
+// over from the parameters for that material.
+//
+// The mode is shared by all threads and set through
+// resolutionModelMessenger:
+//   off    - no folding (default)
+//   event  - every event's light is smeared as it is tallied, into
+//            folded matrices kept next to the unfolded ones
+//   matrix - the unfolded matrices are folded with the resolution at
+//            the end of the run, one convolution for all energy columns
+// Both write the folded matrices as well as the unfolded ones.  In
+// matrix mode the resolution is not part of what a run tallies, so
+// trying other parameters on cached results (resultsCache) needs no
+// events at all.
+
+class resolutionModel
+{
+public:
+  enum foldMode { foldOff, foldEvent, foldMatrix };
+
+  // Relative FWHM, and Gaussian sigma in photons, of light photons in
+  // the scintillator made of material
+  static G4double Resolution(const G4String &material, G4double light);
+  static G4double Sigma(const G4String &material, G4double light);
+
+  // Light of one event after resolution, never below zero
+  static G4double Smear(const G4String &material, G4double light);
+
+  // Fills out with the matrix in, its light axis folded with the
+  // resolution.  Light below zero goes into the first bin, and the
+  // overflow bin is left as it is.  The sum of squared weights of a
+  // bin is what smearing every entry would give on average
+  static void Fold(const G4String &material, const responseMatrix &in, responseMatrix &out);
+
+  // The following functions are called from resolutionModelMessenger
+  // at runtime, on the master only
+  static void SetMode(G4String);
+  static void SetParameters(G4double a, G4double b, G4double c)
+  { alpha = a;
+    beta = b;
+    gamma = c; }
+
+  static void SetLightUnit(G4double photons)
+  { lightUnit = photons; }
+
+  // Reads a curve of "light resolution" lines, light in units of
+  // lightUnit photons and increasing, separated by spaces, tabs, ','
+  // or ';'.  Lines starting with '#' are skipped
+  static void SetTable(G4String material, G4String fileName);
+  static void ClearTables()
+  { tables.clear(); }
+
+  static foldMode GetMode() { return mode; }
+
+private:
+  struct resolutionTable
+  {
+    std::vector<G4double> light;
+    std::vector<G4double> resolution;
+  };
+
+  static foldMode mode;
+  static G4double alpha;
+  static G4double beta;
+  static G4double gamma;
+  static G4double lightUnit;
+  static std::map<G4String, resolutionTable> tables;
+};
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef resolutionModelMessenger_hh
+#define resolutionModelMessenger_hh 1
+
+#include "G4UImessenger.hh"
+
+class G4UIdirectory;
+class G4UIcommand;
+class G4UIcmdWithAString;
+class G4UIcmdWithADouble;
+
+// resolutionModelMessenger class allows the user to fold the detector
+// resolution into the response matrices.  Its settings are shared by
+// all threads, so it only exists on the master and its commands are
+// not broadcast.  See 'resolutionModel.hh' for more details
+class resolutionModelMessenger: public G4UImessenger
+{
+
+public:
+  resolutionModelMessenger();
+  ~resolutionModelMessenger();
+
+  void SetNewValue(G4UIcommand *, G4String);
+
+private:
+  G4UIdirectory *resolutionDir;
+  G4UIcmdWithAString *foldCommand;
+  G4UIcommand *parametersCommand;
+  G4UIcmdWithADouble *lightUnitCommand;
+  G4UIcommand *tableCommand;
+  G4UIcommand *clearTablesCommand;
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef responseMatrix_hh
+#define responseMatrix_hh 1
+
+#include "G4VAccumulable.hh"
+#include "globals.hh"
+
+#include <vector>
+
+// responseMatrix class tallies the detector response as a 2D histogram
+// of light (photons created) against incident neutron energy.  Each
+// bin keeps the sum of weights and the sum of squared weights, so the
+// statistical uncertainty of every bin is known.  It is an accumulable:
+// register it with G4AccumulableManager in runAction and the worker
+// matrices are merged into the master's at the end of the run.
+//
+// Entries outside the energy range are dropped; light beyond the last
+// bin is kept in the last (overflow) bin.
+
+class responseMatrix : public G4VAccumulable
+{
+public:
+  responseMatrix(const G4String &name = "responseMatrix");
+  ~responseMatrix();
+
+  // Changing the binning clears the matrix
+  void SetBinning(G4int nEnergy, G4double eMin, G4double eMax,
+		  G4int nLight, G4double lightMax);
+
+  void Fill(G4double energy, G4double light, G4double weight = 1.);
+
+  // Adds to the sums of one bin directly (used to fold the matrix)
+  void AddToBin(G4int energyBin, G4int lightBin, G4double sum, G4double sum2)
+  { sumW[energyBin*nLightBins + lightBin] += sum;
+    sumW2[energyBin*nLightBins + lightBin] += sum2; }
+
+  void Merge(const G4VAccumulable &other) override;
+  void Reset() override;
+
+  G4int GetNumberOfEnergyBins() const { return nEnergyBins; }
+  G4int GetNumberOfLightBins() const { return nLightBins; }
+  G4double GetEnergyMin() const { return energyMin; }
+  G4double GetEnergyMax() const { return energyMax; }
+  G4double GetLightMax() const { return lightMax; }
+
+  G4double GetBinContent(G4int energyBin, G4int lightBin) const
+  { return sumW[energyBin*nLightBins + lightBin]; }
+  G4double GetBinError2(G4int energyBin, G4int lightBin) const
+  { return sumW2[energyBin*nLightBins + lightBin]; }
+
+  // Scales one energy column as if every entry in it had had its
+  // weight multiplied by factor (used to reweight to another spectrum)
+  void ScaleColumn(G4int energyBin, G4double factor);
+
+  // Sum of weights in one energy column
+  G4double GetColumnSum(G4int energyBin) const;
+
+  // Chi-square per degree of freedom between the light distributions
+  // of one energy column in this matrix and in another with the same
+  // binning, after normalising both columns to unit area.  Returns -1
+  // if either column is empty
+  G4double ColumnChiSquare(const responseMatrix &other, G4int energyBin) const;
+
+  // Kolmogorov-Smirnov distance between the same two columns
+  G4double ColumnKSDistance(const responseMatrix &other, G4int energyBin) const;
+
+  // Writes the matrix as "EnergyLow;EnergyHigh;LightLow;LightHigh;Sum;SumW2"
+  // lines (energies in MeV), skipping empty bins
+  G4bool Write(const G4String &fileName) const;
+
+  // Reads back a matrix written by Write into the current binning,
+  // replacing its contents.  Returns false if the file cannot be read
+  // or its bins do not match
+  G4bool Read(const G4String &fileName);
+
+  // Appends the bin sums to buffer, and reads them back from position
+  // on, returning the position after them.  Used to reduce matrices
+  // across MPI ranks (RMatrixMPI), which must share the binning
+  void Pack(std::vector<G4double> &buffer) const;
+  std::size_t Unpack(const std::vector<G4double> &buffer, std::size_t position);
+
+private:
+  G4int nEnergyBins;
+  G4double energyMin;
+  G4double energyMax;
+
+  G4int nLightBins;
+  G4double lightMax;
+
+  std::vector<G4double> sumW;
+  std::vector<G4double> sumW2;
+};
+
+#endif
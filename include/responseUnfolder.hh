@@ -0,0 +1,103 @@
+#ifndef responseUnfolder_hh
+#define responseUnfolder_hh 1
+
+#include "globals.hh"
+
+#include <vector>
+
+// responseUnfolder class unfolds an incident spectrum from a measured
+// light (pulse-height) spectrum with a response matrix: it looks for
+// the spectrum phi whose folding R phi best matches the measured
+// counts m, where R[j][i] is the mean number of counts in light bin j
+// per incident particle in energy bin i.  Three methods are offered:
+//
+//   MLEM     - maximum likelihood expectation maximisation for Poisson
+//              counts, phi_i <- phi_i/s_i sum_j R_ji m_j/(R phi)_j with
+//              s_i the efficiency of energy bin i
+//   GRAVEL   - the SAND-II type log update, every light bin weighted by
+//              its counts over their variance, which keeps fitting the
+//              bins with the smallest relative uncertainty
+//   Tikhonov - least squares with a smoothness penalty,
+//              |(R phi - m)/sigma|^2 + lambda |L phi|^2, with L the
+//              identity or the first or second difference, solved in
+//              one step from the normal equations.  It is not bound to
+//              be positive
+//
+// The iterative methods start from a flat spectrum with the measured
+// number of counts and stop after a number of iterations or once the
+// chi-square per light bin changes by less than the tolerance between
+// two iterations.
+//
+// The response is kept in two layouts, by light bin and by energy bin,
+// so that both the folding and the back projection run over contiguous
+// memory as a sum of scaled rows (which the compiler vectorises).
+// Unfold only reads the unfolder, so one unfolder can serve several
+// threads at once (RMatrixUnfold runs its resampled replicas that way).
+
+class responseUnfolder
+{
+public:
+  responseUnfolder();
+  ~responseUnfolder();
+
+  enum unfoldMethod { unfoldMLEM, unfoldGRAVEL, unfoldTikhonov };
+
+  // response holds R row by row: nLight rows of nEnergy values
+  void SetResponse(const std::vector<G4double> &response, G4int nLight, G4int nEnergy);
+
+  void SetMethod(unfoldMethod newMethod)
+  { method = newMethod; }
+
+  void SetIterations(G4int n)
+  { maxIterations = n; }
+
+  void SetTolerance(G4double tolerance)
+  { chi2Tolerance = tolerance; }
+
+  // lambda is relative to the mean diagonal of the normal equations,
+  // so that it does not depend on the scale of the counts
+  void SetRegularisation(G4double lambda, G4int order)
+  { regularisation = lambda;
+    regularisationOrder = order; }
+
+  G4int GetNumberOfLightBins() const { return nLightBins; }
+  G4int GetNumberOfEnergyBins() const { return nEnergyBins; }
+
+  // Unfolds counts (one per light bin) whose variances are given;
+  // variances below 1 count are taken as 1.  Returns the number of
+  // iterations made (1 for Tikhonov), or -1 if the problem could not
+  // be solved
+  G4int Unfold(const std::vector<G4double> &counts, const std::vector<G4double> &variances,
+	       std::vector<G4double> &spectrum) const;
+
+  // Chi-square of the folded spectrum against counts
+  G4double ChiSquare(const std::vector<G4double> &counts, const std::vector<G4double> &variances,
+		     const std::vector<G4double> &spectrum) const;
+
+  // folded = R spectrum
+  void Fold(const std::vector<G4double> &spectrum, std::vector<G4double> &folded) const;
+
+private:
+  G4int Iterate(const std::vector<G4double> &counts, const std::vector<G4double> &variances,
+		std::vector<G4double> &spectrum) const;
+  G4int SolveTikhonov(const std::vector<G4double> &counts, const std::vector<G4double> &variances,
+		      std::vector<G4double> &spectrum) const;
+
+  G4int nLightBins;
+  G4int nEnergyBins;
+
+  // R by light bin (nLight x nEnergy) and by energy bin (nEnergy x nLight)
+  std::vector<G4double> byLight;
+  std::vector<G4double> byEnergy;
+
+  // Efficiency of every energy bin, sum_j R_ji
+  std::vector<G4double> efficiency;
+
+  unfoldMethod method;
+  G4int maxIterations;
+  G4double chi2Tolerance;
+  G4double regularisation;
+  G4int regularisationOrder;
+};
+
+#endif
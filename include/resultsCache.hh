@@ -0,0 +1,60 @@
+#ifndef resultsCache_hh
+#define resultsCache_hh 1
+
+#include "globals.hh"
+
+#include <vector>
+
+// resultsCache class keeps the response matrices and run counters of
+// every configuration simulated so far in a cache directory, so that
+// asking again for the same configuration costs nothing and asking
+// for more events only simulates the ones that are missing.
+//
+// An entry is named after a hash of the configuration: the code version
+// (taken at build time, with a hash of any uncommitted changes), the
+// Geant4 version and every command that set up the materials,
+// geometry, source, physics list, cuts, biasing, stacking and matrix
+// binning (the UI history, less the commands that only change output,
+// verbosity or seeding, and the resolution unless it is folded event
+// by event).  Only the last of the repeats of a setting counts.  The
+// files the configuration reads (response table, light collection map,
+// resolution curves, source histograms) count by their contents too.
+// With per-event seeding the random stream of a run is fully given by
+// its run seed and first event, so an entry keeps the run seed and the
+// number of events it holds; more events for it are the next events
+// of the same stream, and merging them in gives exactly what one
+// longer run would have.
+//
+// All of this happens on the master, from resultsCacheMessenger.
+
+class resultsCache
+{
+public:
+  // Returns the results of nEvents events of the current configuration,
+  // from the cache where it has them and simulating the rest, then
+  // writes the response matrices and updates the cache
+  static void BeamOn(G4int nEvents);
+
+  // The following functions are called from resultsCacheMessenger at
+  // runtime
+  static void SetDirectory(G4String dir)
+  { directory = dir; }
+
+private:
+  // The configuration as text, one line per command, and its hash
+  static G4String ConfigurationKey();
+  static G4String Hash(const G4String &key);
+
+  // Hash of the contents of a file, or "missing"
+  static G4String FileDigest(const G4String &fileName);
+
+  // Returns false if there is no entry for key in fileName
+  static G4bool Load(const G4String &fileName, const G4String &key,
+		     G4long &nEvents, G4long &runSeed, std::vector<G4double> &tallies);
+  static G4bool Save(const G4String &fileName, const G4String &key,
+		     G4long nEvents, G4long runSeed, const std::vector<G4double> &tallies);
+
+  static G4String directory;
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef resultsCacheMessenger_hh
+#define resultsCacheMessenger_hh 1
+
+#include "G4UImessenger.hh"
+
+class G4UIdirectory;
+class G4UIcmdWithAString;
+class G4UIcmdWithAnInteger;
+
+// resultsCacheMessenger class lets the user run through the results
+// cache.  The cache works on the master's tallies, so it only exists
+// on the master and its commands are not broadcast.  See
+// 'resultsCache.hh' for more details
+class resultsCacheMessenger: public G4UImessenger
+{
+
+public:
+  resultsCacheMessenger();
+  ~resultsCacheMessenger();
+
+  void SetNewValue(G4UIcommand *, G4String);
+
+private:
+  G4UIdirectory *cacheDir;
+  G4UIcmdWithAString *directoryCommand;
+  G4UIcmdWithAnInteger *beamOnCommand;
+};
+
+#endif
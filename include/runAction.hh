@@ -3,11 +3,29 @@
 
 #include "G4UserRunAction.hh"
 #include "G4Run.hh"
+#include "G4Accumulable.hh"
+#include "G4Timer.hh"
+#include "G4ThreeVector.hh"
+
+#include "neutronResponseTable.hh"
+#include "responseMatrix.hh"
+#include "lightCollectionMap.hh"
+#include "detectorArrayTally.hh"
+#include "stepProfile.hh"
+#include "sourceTally.hh"
 
 #include <string>
+#include <vector>
 using namespace std;
 
 class G4Run;
+class runActionMessenger;
+class neutronResponseModelMessenger;
+class lightCollectionMapMessenger;
+class stepProfileMessenger;
+class progressMonitorMessenger;
+class resultsCacheMessenger;
+class resolutionModelMessenger;
 
 class runAction : public G4UserRunAction
 {
@@ -19,6 +37,212 @@ public:
   void BeginOfRunAction(const G4Run*) override;
   void EndOfRunAction(const G4Run*) override;
 
+  // Per-event seeding.  Called at the start of every event, it reseeds
+  // the thread's engine from a hash of (run seed, global event number),
+  // where the global event number is the event ID plus the number of
+  // events already run (or skipped with SetEventOffset).  An event's
+  // random stream therefore does not depend on the thread count, the
+  // shard layout or the order in which events are scheduled, and any
+  // single event can be re-run on its own.
+  static void SeedEvent(G4int eventID);
+
+  // Called from steppingAction every time a neutron is killed below
+  // the low-energy threshold, with the kinetic energy it still had and
+  // its weight, so that biased runs tally what an analog run would
+  void AddKilledNeutron(G4double energy, G4double weight)
+  { nKilledNeutrons += weight;
+    killedNeutronEnergy += weight*energy; }
+
+  // Step profile of this thread, or nullptr while profiling is off.
+  // Called from steppingAction at every step
+  stepProfile *GetStepProfile()
+  { return stepProfile::IsEnabled() ? &profile : nullptr; }
+
+  // Called from stackingAction for every new track that its policy
+  // counts and kills without tracking (optical photons aside, which go
+  // into the event light instead)
+  void AddCountedTrack()
+  { nCountedTracks += 1; }
+
+  // Called from eventAction at the end of every event in which a
+  // primary neutron entered the scintillator, while neutronResponseModel
+  // is training or comparing.  Position and direction are in the frame
+  // of the scintillator cylinder
+  void AddNeutronEntry(G4double energy,
+		       const G4ThreeVector &localPos, const G4ThreeVector &localDir,
+		       G4double radius, G4double halfLength,
+		       G4int species, G4double light, G4double weight);
+
+  // Called from eventAction at the end of every light collection
+  // calibration event, with the emission point in the frame of the
+  // scintillator cylinder
+  void AddLightCalibration(const G4ThreeVector &localPos, G4int nEmitted, G4int nCollected)
+  { calibrationMap.Fill(localPos, nEmitted, nCollected); }
+
+  // Called from eventAction at the end of every event when there is
+  // more than one detector, with the copy numbers of those that fired
+  void AddDetectorHits(const std::vector<G4int> &firedDetectors, G4double weight)
+  { arrayTally.Fill(firedDetectors, weight); }
+
+  // Called from eventAction at the end of every event while response
+  // matrices are written, once for each primary species that took part.
+  // lightViaGamma is the part of the light that came through gammas.
+  // Matrices are refused for detector arrays, so light is that of the
+  // single detector
+  void AddResponse(G4bool gamma, G4double energy, G4double light,
+		   G4double lightViaGamma, G4double weight);
+
+  // Called from eventAction at the end of every event while response
+  // matrices or event data are written, once per event and once per
+  // neutron or gamma primary, to record how the source was sampled
+  void AddSourceEvent()
+  { source.AddEvent(); }
+
+  void AddSourcePrimary(G4bool gamma, G4double energy)
+  { source.Fill(gamma, energy); }
+
+  // The following functions are called from runActionMessenger at
+  // runtime, on the master only
+  static void SetRunSeed(G4long seed)
+  { runSeed = seed; }
+
+  static void SetEventOffset(G4long offset)
+  { eventOffset = offset; }
+
+  static void SetPerEventSeeding(G4String onOff)
+  { if(onOff == "on") perEventSeeding = true;
+    if(onOff == "off") perEventSeeding = false; }
+
+  static void SetMatrixOutput(G4String onOff)
+  { if(onOff == "on") matrixOutput = true;
+    if(onOff == "off") matrixOutput = false; }
+
+  static void SetMatrixFileName(G4String fileName)
+  { matrixFileName = fileName; }
+
+  static void SetMatrixEnergyBinning(G4int nBins, G4double eMin, G4double eMax)
+  { matrixEnergyBins = nBins;
+    matrixEnergyMin = eMin;
+    matrixEnergyMax = eMax; }
+
+  static void SetMatrixLightBinning(G4int nBins, G4double lightMax)
+  { matrixLightBins = nBins;
+    matrixLightMax = lightMax; }
+
+  // Spectra the matrices are reweighted to at the end of every run
+  // (see 'spectrumReweighter.hh')
+  static void AddTargetSpectrum(G4String fileName)
+  { targetSpectra.push_back(fileName); }
+
+  static void ClearTargetSpectra()
+  { targetSpectra.clear(); }
+
+  static G4bool GetMatrixOutput()
+  { return matrixOutput; }
+
+  static G4long GetRunSeed()
+  { return runSeed; }
+
+  static G4long GetEventOffset()
+  { return eventOffset; }
+
+  static G4bool GetPerEventSeeding()
+  { return perEventSeeding; }
+
+  // Block mode, for RMatrixMPI.  Every run is then one block of events
+  // of a larger job: the master adds each block to its tallies instead
+  // of clearing them, and reports nothing at the end of a block.  The
+  // job reduces the tallies of all ranks and reports them once
+  static void SetBlockMode(G4bool blocks)
+  { blockMode = blocks;
+    blockRuns = 0; }
+
+  // The run tallies that are reduced across ranks (response matrices,
+  // detector array and counters) as one flat buffer, and back
+  std::vector<G4double> PackTallies() const;
+  void UnpackTallies(const std::vector<G4double> &buffer);
+
+  // Prints the run counters and writes the response matrices, for
+  // nEvents events.  Called at the end of every run outside block mode
+  void ReportTallies(G4int nEvents);
+
+  // Sizes the response matrices and detector array tallies for the
+  // current settings and geometry, clearing them.  Called at the start
+  // of every run, and by resultsCache before it reads tallies back
+  void BinTallies();
+
+private:
+  // Prints the fast model against full transport and writes both
+  // response matrices next to the table file
+  void ReportResponseComparison();
+
+  // Writes the neutron and gamma response matrices of the run, the
+  // source tally and the matrices reweighted to every target spectrum,
+  // and the matrices folded with the resolution if it is on
+  void WriteResponseMatrices();
+
+  runActionMessenger *runMessenger;
+  neutronResponseModelMessenger *responseMessenger;
+  lightCollectionMapMessenger *mapMessenger;
+  stepProfileMessenger *profileMessenger;
+  progressMonitorMessenger *progressMessenger;
+  resultsCacheMessenger *cacheMessenger;
+  resolutionModelMessenger *resolutionMessenger;
+
+  G4Accumulable<G4double> nKilledNeutrons;
+  G4Accumulable<G4double> killedNeutronEnergy;
+  G4Accumulable<G4int> nCountedTracks;
+
+  // Steps, tracks and time per particle, process and volume
+  stepProfile profile;
+
+  // Training table of neutronResponseModel, and the light of entering
+  // neutrons with full transport and as drawn from the table
+  neutronResponseTable trainingTable;
+  responseMatrix fullResponse;
+  responseMatrix fastResponse;
+
+  // Light collection map being calibrated
+  lightCollectionMap calibrationMap;
+
+  // Response matrices of the run: light against primary energy for
+  // neutron and gamma primaries, and how much of the neutron light
+  // came through gammas
+  responseMatrix neutronMatrix;
+  responseMatrix gammaMatrix;
+  G4Accumulable<G4double> neutronLight;
+  G4Accumulable<G4double> neutronLightViaGamma;
+
+  // The same with every event's light smeared by the resolution, while
+  // resolutionModel folds event by event, and the scintillator material
+  // whose resolution that is (the first detector's, for an array)
+  responseMatrix neutronFolded;
+  responseMatrix gammaFolded;
+  G4String scintMaterial;
+
+  // Primary energies sampled by the source, binned like the matrices
+  sourceTally source;
+
+  // Per-detector and cross-talk tallies of the detector array
+  detectorArrayTally arrayTally;
+
+  G4Timer runTimer;
+
+  static G4long runSeed;
+  static G4long eventOffset;
+  static G4bool perEventSeeding;
+
+  static G4bool matrixOutput;
+  static G4String matrixFileName;
+  static G4int matrixEnergyBins;
+  static G4double matrixEnergyMin;
+  static G4double matrixEnergyMax;
+  static G4int matrixLightBins;
+  static G4double matrixLightMax;
+  static std::vector<G4String> targetSpectra;
+
+  static G4bool blockMode;
+  static G4int blockRuns;
 };
 
-#endif
\ No newline at end of file
+#endif
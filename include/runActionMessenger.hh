@@ -0,0 +1,39 @@
+#ifndef runActionMessenger_hh
+#define runActionMessenger_hh 1
+
+#include "G4UImessenger.hh"
+
+class runAction;
+class G4UIdirectory;
+class G4UIcmdWithAString;
+class G4UIcmdWithALongInt;
+class G4UIcommand;
+
+// runActionMessenger class allows the user to interface with the
+// run-level settings held by runAction.  It only exists on the master
+// thread, so its commands are not broadcast to the workers
+class runActionMessenger: public G4UImessenger
+{
+
+public:
+  runActionMessenger(runAction *);
+  ~runActionMessenger();
+
+  void SetNewValue(G4UIcommand *, G4String);
+
+private:
+  runAction *RA;
+  G4UIdirectory *randomDir;
+  G4UIcmdWithALongInt *seedCommand;
+  G4UIcmdWithALongInt *offsetCommand;
+  G4UIcmdWithAString *seedingCommand;
+  G4UIdirectory *responseDir;
+  G4UIcmdWithAString *matrixCommand;
+  G4UIcmdWithAString *matrixFileCommand;
+  G4UIcommand *energyBinningCommand;
+  G4UIcommand *lightBinningCommand;
+  G4UIcmdWithAString *addTargetCommand;
+  G4UIcommand *clearTargetsCommand;
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef runSetup_hh
+#define runSetup_hh 1
+
+#include "globals.hh"
+
+#include <vector>
+
+class G4RunManager;
+
+// runSetup class holds the set up that RMatrixGen and the tools built
+// around it (RMatrixBench, RMatrixRegression, RMatrixMPI) share, so
+// that they all simulate the same thing:
+//   - the run manager, multithreaded for more than one thread with the
+//     workers placed by workerInitialization, given the geometry, the
+//     physics list and the user actions
+//   - the plane source of ParticleGun.mac, a 2 mm square beam 49 cm
+//     upstream of the detector, along +z and flat in energy
+//
+// Settings that have to be made before the physics list is built
+// (thread pinning, fast response mode) are made before
+// CreateRunManager; the caller initializes the run manager, so that it
+// can change the geometry before it is first built.
+
+class runSetup
+{
+public:
+  // physics names the physics list, or is empty for the default, and
+  // emOption is the EM option of the lean list, or -1 for its default
+  static G4RunManager *CreateRunManager(G4int nThreads, const G4String &physics, G4int emOption);
+
+  // The source commands, without the particle and the energy range
+  static std::vector<G4String> PlaneSourceCommands();
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef sourceTally_hh
+#define sourceTally_hh 1
+
+#include "G4VAccumulable.hh"
+#include "globals.hh"
+
+#include <vector>
+
+// sourceTally class records how the source was sampled over a run: the
+// number of events, and a histogram of the kinetic energy of the
+// neutron and gamma primaries, binned like the response matrices.  It
+// is the source density that spectrumReweighter divides by to give the
+// events of a run the weights of another incident spectrum.  It is an
+// accumulable, registered in runAction and merged at the end of the
+// run, and is written next to the response matrices and event output.
+//
+// Every event is counted, with or without light; primaries outside
+// the energy range are counted as events but not binned.  They are
+// tallied apart, so that the run can warn that the reweighting will
+// not cover them.
+
+class sourceTally : public G4VAccumulable
+{
+public:
+  sourceTally(const G4String &name = "sourceTally");
+  ~sourceTally();
+
+  // Changing the binning clears the tally
+  void SetBinning(G4int nBins, G4double eMin, G4double eMax);
+
+  void AddEvent()
+  { nEvents += 1.; }
+
+  void Fill(G4bool gamma, G4double energy);
+
+  void Merge(const G4VAccumulable &other) override;
+  void Reset() override;
+
+  G4int GetNumberOfBins() const { return nBins; }
+  G4double GetEnergyMin() const { return energyMin; }
+  G4double GetEnergyMax() const { return energyMax; }
+  G4double GetNumberOfEvents() const { return nEvents; }
+
+  // Primaries of either species outside the energy range
+  G4double GetNumberOutside() const { return nOutside; }
+
+  G4double GetBinCount(G4bool gamma, G4int bin) const
+  { return counts[gamma ? nBins + bin : bin]; }
+
+  // Primaries of one species in range
+  G4double GetTotal(G4bool gamma) const;
+
+  // Writes the tally as "Species;EnergyLow;EnergyHigh;Primaries" lines
+  // (energies in MeV) after an "Events;<n>" line
+  G4bool Write(const G4String &fileName) const;
+
+  // Reads back a tally written by Write, taking its binning
+  G4bool Read(const G4String &fileName);
+
+  // Appends the tally to buffer, and reads it back from position on,
+  // returning the position after it (see responseMatrix)
+  void Pack(std::vector<G4double> &buffer) const;
+  std::size_t Unpack(const std::vector<G4double> &buffer, std::size_t position);
+
+private:
+  G4int nBins;
+  G4double energyMin;
+  G4double energyMax;
+
+  G4double nEvents;
+  G4double nOutside;
+  std::vector<G4double> counts;
+};
+
+#endif
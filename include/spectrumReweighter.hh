@@ -0,0 +1,71 @@
+#ifndef spectrumReweighter_hh
+#define spectrumReweighter_hh 1
+
+#include "globals.hh"
+
+#include <vector>
+
+class sourceTally;
+class responseMatrix;
+
+// spectrumReweighter class gives the events of a run the weights they
+// would have had if the primaries had been drawn from another incident
+// spectrum, w(E) = target(E)/source(E), so that one run with a broad
+// (e.g. flat) source serves any target spectrum inside its range.
+//
+// The source density is the histogram of the primary energies sampled
+// in the run (sourceTally) and the target is a user spectrum file,
+// linearly interpolated; both are normalised to unit area over the
+// energy range of the source tally.  A weighted matrix then holds as
+// many incident particles as the run had primaries in range.  Weights
+// are zero where the run sampled nothing, and should only be trusted
+// where the source covers the target.
+//
+// It is used at the end of a run by runAction, on the response matrices
+// (every energy column takes the weight of its bin), and event by event
+// by the RMatrixReweight tool on the event output.
+
+class spectrumReweighter
+{
+public:
+  spectrumReweighter();
+  ~spectrumReweighter();
+
+  // Reads the target spectrum: lines of "energy intensity", energies
+  // in MeV and increasing, separated by spaces, tabs, ',' or ';'.
+  // Lines starting with '#' are skipped.  Returns false if the file
+  // cannot be read or has fewer than two points
+  G4bool ReadTarget(const G4String &fileName);
+
+  // Takes the source density of the neutron or gamma primaries from a
+  // tally.  Returns false if the tally has none in range, or the
+  // target has no area over the tally's range
+  G4bool SetSource(const sourceTally &, G4bool gamma);
+
+  // Weight of an event whose primary had this energy
+  G4double Weight(G4double energy) const;
+
+  // Weight of the energy bin of the source tally, target probability
+  // of the bin over the fraction of the primaries sampled in it
+  G4double BinWeight(G4int bin) const;
+
+  // Fills out with the matrix in, every energy column scaled by the
+  // weight of its bin (the sum of squared weights by its square).  The
+  // energy binning of the matrix must be that of the source tally
+  G4bool Reweight(const responseMatrix &in, responseMatrix &out) const;
+
+private:
+  G4double Target(G4double energy) const;
+  G4double TargetIntegral(G4double eLow, G4double eHigh) const;
+
+  std::vector<G4double> targetEnergies;
+  std::vector<G4double> targetValues;
+  G4double targetNorm;
+
+  G4int nSourceBins;
+  G4double sourceMin;
+  G4double sourceMax;
+  std::vector<G4double> sourceFractions;
+};
+
+#endif
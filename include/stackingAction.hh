@@ -2,19 +2,137 @@
 #define stackingAction_hh 1
 
 #include "G4UserStackingAction.hh"
+#include "G4EmCalculator.hh"
+#include "G4ParticleDefinition.hh"
 
+#include <map>
+#include <vector>
+
+class runAction;
 class eventAction;
+class stackingActionMessenger;
+class geometryConstruction;
+
+// stackingAction class counts the optical photons of each event and
+// decides which new tracks are followed.
+//
+// What happens to a new track is set by a policy table with one entry
+// per particle definition, looked up by the definition's index: a
+// classification (urgent, waiting or kill), a count-only flag and an
+// energy threshold below which the track is killed.  Count-only tracks
+// are counted and killed without being tracked; for optical photons
+// the count is the light of the event.  By default optical photons are
+// count-only, gammas are killed unless trackGammas is on, and anything
+// else is urgent.  All of it can be changed through /RMatrix/stack/.
+//
+// With local deposition on, recoil ions and alphas created in a
+// scintillator are not tracked at all when their range is well below
+// the distance to the nearest volume boundary: their full light yield
+// (from the material's ALPHA/IONSCINTILLATIONYIELD curve) is sampled
+// at the creation point instead, the way G4Scintillation would.  The
+// distance to the boundary is that to the surface of the detector's
+// cylinder, in the frame of the touchable the track was born in.
+//
+// Gammas are killed unless trackGammas is on (mixed neutron/gamma
+// fields); eventAction then tags every new track with the primary it
+// descends from, so that the light of neutrons and gammas can be told
+// apart.
 
 class stackingAction : public G4UserStackingAction
 {
 public:
-  stackingAction(eventAction*);
+  stackingAction(runAction*, eventAction*);
   ~stackingAction();
   
   G4ClassificationOfNewTrack ClassifyNewTrack(const G4Track*);
-  
+
+  // The following functions are called from stackingActionMessenger
+  // at runtime when the user desires to change something....
+  void SetLocalDeposition(G4String onOff)
+  { if(onOff == "on") localDeposition = true;
+    if(onOff == "off") localDeposition = false; }
+
+  void SetRangeSafetyFactor(G4double factor)
+  { rangeSafetyFactor = factor; }
+
+  void SetTrackGammas(G4String onOff);
+
+  // Policy of a particle by name; "GenericIon" stands for all ions
+  // made on the fly.  Classification is "urgent", "waiting" or "kill"
+  void SetClassification(G4String particle, G4String classification);
+  void SetCountOnly(G4String particle, G4String onOff);
+  void SetEnergyThreshold(G4String particle, G4double threshold);
+  void PrintPolicies();
+
+private:
+  struct stackPolicy;
+
+  // Each table entry points at the version of Classify compiled for
+  // its own flags, so the hot path has no tests on flags that are off
+  typedef G4ClassificationOfNewTrack (stackingAction::*classifier)(const G4Track*,
+								    const stackPolicy&,
+								    G4int origin);
+
+  struct stackPolicy
+  {
+    G4ClassificationOfNewTrack classification;
+    G4bool countOnly;
+    G4double energyThreshold;
+
+    // Particles that have more to do than be classified: neutrons,
+    // recoil nuclei and ions
+    G4bool special;
+
+    classifier classify;
+  };
+
+  template<G4bool OpticalPhoton, G4bool CountOnly, G4bool Threshold>
+  G4ClassificationOfNewTrack Classify(const G4Track*, const stackPolicy&, G4int origin);
+
+  // Table lookup, building the entry on first use
+  const stackPolicy &GetPolicy(const G4ParticleDefinition *PDef)
+  {
+    G4int index = PDef->GetParticleDefinitionID();
+    if(index >= 0 and index < G4int(policyTable.size()) and policyTable[index].classify)
+      return policyTable[index];
+    return BuildPolicy(PDef);
+  }
+
+  const stackPolicy &BuildPolicy(const G4ParticleDefinition*);
+  stackPolicy DefaultPolicy(const G4ParticleDefinition*) const;
+  void SelectClassifier(stackPolicy &, const G4ParticleDefinition*) const;
+
+  // User settings are kept by name and the table rebuilt from them
+  stackPolicy &UserPolicy(G4String particle);
+  const G4ParticleDefinition *FindParticle(G4String particle) const;
+
+  // Tagging, local deposition and energy bookkeeping of the special
+  // particles.  Returns true if the track has been dealt with and is
+  // to be killed
+  G4bool HandleSpecial(const G4Track*);
+
+  // Returns true if the track's light was deposited on the spot and
+  // the track can be killed
+  G4bool DepositLocally(const G4Track*);
+
 private:
+    runAction *rnAction;
     eventAction *evtAction;
+
+    G4bool localDeposition;
+    G4double rangeSafetyFactor;
+
+    G4bool trackGammas;
+
+    std::vector<stackPolicy> policyTable;
+    stackPolicy ionPolicy;
+    std::map<G4String, stackPolicy> userPolicies;
+
+    G4EmCalculator emCalculator;
+
+    const geometryConstruction *geometry;
+
+    stackingActionMessenger *stackMessenger;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,36 @@
+#ifndef stackingActionMessenger_hh
+#define stackingActionMessenger_hh 1
+
+#include "G4UImessenger.hh"
+
+class stackingAction;
+class G4UIdirectory;
+class G4UIcmdWithAString;
+class G4UIcmdWithADouble;
+class G4UIcmdWithoutParameter;
+class G4UIcommand;
+
+// stackingActionMessenger class allows the user to interface with
+// stackingAction class.  See 'stackingAction.hh' for more details
+class stackingActionMessenger: public G4UImessenger
+{
+
+public:
+  stackingActionMessenger(stackingAction *);
+  ~stackingActionMessenger();
+
+  void SetNewValue(G4UIcommand *, G4String);
+
+private:
+  stackingAction *SA;
+  G4UIdirectory *stackDir;
+  G4UIcmdWithAString *localCommand;
+  G4UIcmdWithADouble *safetyCommand;
+  G4UIcmdWithAString *gammaCommand;
+  G4UIcommand *classificationCommand;
+  G4UIcommand *countOnlyCommand;
+  G4UIcommand *thresholdCommand;
+  G4UIcmdWithoutParameter *printCommand;
+};
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef stepProfile_hh
+#define stepProfile_hh 1
+
+#include "G4VAccumulable.hh"
+#include "globals.hh"
+
+#include <chrono>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+class G4Step;
+class G4ParticleDefinition;
+class G4VProcess;
+class G4VPhysicalVolume;
+
+// stepProfile class attributes the CPU time of a run to (particle,
+// process, volume) cells: the process is the one that limited the
+// step and the volume the one the step was taken in.  Each cell counts
+// steps, tracks started in it and the wall time of a sample of its
+// steps, one in every samplingInterval, measured between consecutive
+// steps of the same track.  The time of a cell is estimated as its
+// mean sampled step time times its number of steps.
+//
+// It is an accumulable, registered in runAction: each thread fills its
+// own, with cells found by pointer, and the master merges them by name
+// at the end of the run, then prints the most expensive cells and
+// writes all of them to a file.  While it is off, steppingAction never
+// calls it.
+
+class stepProfile : public G4VAccumulable
+{
+public:
+  stepProfile(const G4String &name = "stepProfile");
+  ~stepProfile();
+
+  // Called from steppingAction for every step while profiling is on
+  void Fill(const G4Step *);
+
+  void Merge(const G4VAccumulable &other) override;
+  void Reset() override;
+
+  // Prints the nCells most expensive cells, sorted by time
+  void Print(G4int nCells) const;
+
+  // Writes every cell as ';' separated text.  Returns false if the
+  // file could not be written
+  G4bool Write(G4String fileName) const;
+
+  // The following functions are called from stepProfileMessenger at
+  // runtime, on the master only.  The settings are shared by all threads
+  static void SetEnabled(G4String onOff)
+  { if(onOff == "on") enabled = true;
+    if(onOff == "off") enabled = false; }
+
+  static void SetFileName(G4String name)
+  { fileName = name; }
+
+  static void SetSamplingInterval(G4int interval)
+  { samplingInterval = interval; }
+
+  static void SetReportLength(G4int nCells)
+  { reportLength = nCells; }
+
+  static G4bool IsEnabled() { return enabled; }
+  static G4String GetFileName() { return fileName; }
+  static G4int GetReportLength() { return reportLength; }
+
+private:
+  struct profileCell
+  {
+    G4String particle;
+    G4String process;
+    G4String volume;
+    G4long steps;
+    G4long tracks;
+    G4long timedSteps;
+    G4double sampledTime;
+
+    G4double EstimatedTime() const
+    { return timedSteps > 0 ? sampledTime/timedSteps*steps : 0.; }
+  };
+
+  struct cellKey
+  {
+    const G4ParticleDefinition *particle;
+    const G4VProcess *process;
+    const G4VPhysicalVolume *volume;
+
+    bool operator==(const cellKey &other) const
+    { return particle == other.particle and process == other.process and volume == other.volume; }
+  };
+
+  struct cellKeyHash
+  {
+    std::size_t operator()(const cellKey &key) const
+    { return std::hash<const void *>()(key.particle)
+	^ (std::hash<const void *>()(key.process) << 1)
+	^ (std::hash<const void *>()(key.volume) << 2); }
+  };
+
+  profileCell &FindCell(const cellKey &);
+  profileCell &FindCell(const G4String &particle, const G4String &process, const G4String &volume);
+
+  std::vector<profileCell> cells;
+  std::unordered_map<cellKey, std::size_t, cellKeyHash> cellIndex;
+  std::map<G4String, std::size_t> nameIndex;
+
+  // Steps seen since the start of the run, and the clock and track at
+  // the step before the next sampled one
+  G4long stepCounter;
+  G4int interval;
+  std::chrono::steady_clock::time_point lastClock;
+  const void *lastTrack;
+  G4int lastStepNumber;
+
+  static G4bool enabled;
+  static G4String fileName;
+  static G4int samplingInterval;
+  static G4int reportLength;
+};
+
+#endif
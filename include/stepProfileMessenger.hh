@@ -0,0 +1,31 @@
+#ifndef stepProfileMessenger_hh
+#define stepProfileMessenger_hh 1
+
+#include "G4UImessenger.hh"
+
+class G4UIdirectory;
+class G4UIcmdWithAString;
+class G4UIcmdWithAnInteger;
+
+// stepProfileMessenger class allows the user to turn the step profile
+// on and off.  Its settings are shared by all threads, so it only
+// exists on the master and its commands are not broadcast.  See
+// 'stepProfile.hh' for more details
+class stepProfileMessenger: public G4UImessenger
+{
+
+public:
+  stepProfileMessenger();
+  ~stepProfileMessenger();
+
+  void SetNewValue(G4UIcommand *, G4String);
+
+private:
+  G4UIdirectory *profileDir;
+  G4UIcmdWithAString *enableCommand;
+  G4UIcmdWithAString *fileCommand;
+  G4UIcmdWithAnInteger *intervalCommand;
+  G4UIcmdWithAnInteger *lengthCommand;
+};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef steppingAction_hh
+#define steppingAction_hh 1
+
+#include "G4UserSteppingAction.hh"
+
+class G4Step;
+class G4ParticleDefinition;
+class geometryConstruction;
+class runAction;
+class eventAction;
+class steppingActionMessenger;
+class G4OpBoundaryProcess;
+
+// steppingAction class applies per-step tracking policies to neutrons:
+//  - an optional "kill on exit" of neutrons that leave the envelope
+//    built around the detectors by geometryConstruction, since they can
+//    no longer contribute to the detector response
+//  - an optional kinetic energy threshold below which neutrons are
+//    killed rather than followed through thermalisation and capture.
+//    The energy they still carried is tallied in runAction as an upper
+//    bound on the deposited energy this removes
+//  - recording where the primary neutron enters the scintillator,
+//    when neutronResponseModel is training or comparing
+//  - light collection (see 'lightCollectionMap.hh'): counting optical
+//    photons that get into the readout window in a calibration run,
+//    or drawing the collected photons of each scintillation step from
+//    the map in production
+//  - filling the step profile of the run, when it is on (see
+//    'stepProfile.hh')
+
+class steppingAction : public G4UserSteppingAction
+{
+public:
+  steppingAction(runAction *, eventAction *);
+  ~steppingAction();
+
+  void UserSteppingAction(const G4Step *);
+
+  // The following function is called from steppingActionMessenger at
+  // runtime when the user desires to change something....
+  void SetKillOnExit(G4String onOff)
+  { if(onOff == "on") killNeutronsOnExit = true;
+    if(onOff == "off") killNeutronsOnExit = false; }
+
+  void SetNeutronThreshold(G4double threshold)
+  { neutronThreshold = threshold; }
+
+private:
+  void CollectLight(const G4Step *);
+
+  runAction *rnAction;
+
+  eventAction *evtAction;
+
+  const geometryConstruction *geometry;
+
+  const G4ParticleDefinition *neutronDef;
+
+  const G4ParticleDefinition *opticalPhotonDef;
+
+  // Boundary process of optical photons, looked up on the first
+  // calibration photon; its status tells a photon that went through a
+  // surface from one reflected by it
+  G4OpBoundaryProcess *boundaryProcess;
+
+  G4bool killNeutronsOnExit;
+
+  G4double neutronThreshold;
+
+  steppingActionMessenger *stepMessenger;
+};
+
+#endif
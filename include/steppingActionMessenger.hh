@@ -0,0 +1,29 @@
+#ifndef steppingActionMessenger_hh
+#define steppingActionMessenger_hh 1
+
+#include "G4UImessenger.hh"
+
+class steppingAction;
+class G4UIdirectory;
+class G4UIcmdWithAString;
+class G4UIcmdWithADoubleAndUnit;
+
+// steppingActionMessenger class allows the user to interface with
+// steppingAction class.  See 'steppingAction.hh' for more details
+class steppingActionMessenger: public G4UImessenger
+{
+
+public:
+  steppingActionMessenger(steppingAction *);
+  ~steppingActionMessenger();
+
+  void SetNewValue(G4UIcommand *, G4String);
+
+private:
+  steppingAction *SA;
+  G4UIdirectory *trackingDir;
+  G4UIcmdWithAString *killOnExitCommand;
+  G4UIcmdWithADoubleAndUnit *thresholdCommand;
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef traceRecorder_hh
+#define traceRecorder_hh 1
+
+// traceRecorder class records how long the user hooks take, for a look
+// at startup phases, per-event latency and stalls in Chrome's
+// about://tracing or Perfetto.  Each thread writes spans (name, start,
+// duration) into a ring buffer of its own, keeping the latest
+// bufferSize of them; at the end of every run the master writes all
+// buffers to RMatrixTrace.json in the Chrome trace event format.
+//
+// Tracing only exists in builds configured with -DWITH_TRACING=ON,
+// which defines RMATRIX_TRACING.  Otherwise the macros below expand to
+// nothing and the class is not compiled at all.
+//
+//   RMATRIX_TRACE_SCOPE("name")       span from here to the end of scope
+//   RMATRIX_TRACE_SPAN("name", start) span from start (a Now()) to here
+//   RMATRIX_TRACE_DUMP()              write the trace file (master)
+
+#ifdef RMATRIX_TRACING
+
+#include "globals.hh"
+
+#include <chrono>
+#include <vector>
+
+class traceRecorder
+{
+public:
+  // Nanoseconds since the first call in the process
+  static G4long Now()
+  {
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>
+      (std::chrono::steady_clock::now() - epoch).count();
+  }
+
+  // Names must be string literals, or outlive the process
+  static void Record(const char *name, G4long start, G4long end)
+  { ThreadBuffer().Add(name, start, end - start); }
+
+  static void Write(const G4String &fileName);
+
+  static const G4int bufferSize = 1 << 18;
+
+  struct traceSpan
+  {
+    const char *name;
+    G4long start;
+    G4long duration;
+  };
+
+  struct traceBuffer
+  {
+    G4int threadID;
+    std::vector<traceSpan> spans;
+    std::size_t nRecorded;
+
+    void Add(const char *name, G4long start, G4long duration)
+    {
+      traceSpan &span = spans[nRecorded++ % spans.size()];
+      span.name = name;
+      span.start = start;
+      span.duration = duration;
+    }
+  };
+
+private:
+  // The calling thread's buffer, created and registered on first use.
+  // Buffers are owned by the registry, so they outlive their thread
+  static traceBuffer &ThreadBuffer();
+};
+
+class traceScope
+{
+public:
+  traceScope(const char *scopeName)
+    : name(scopeName), start(traceRecorder::Now())
+  {;}
+
+  ~traceScope()
+  { traceRecorder::Record(name, start, traceRecorder::Now()); }
+
+private:
+  const char *name;
+  G4long start;
+};
+
+#define RMATRIX_TRACE_CONCAT_(a, b) a##b
+#define RMATRIX_TRACE_CONCAT(a, b) RMATRIX_TRACE_CONCAT_(a, b)
+#define RMATRIX_TRACE_SCOPE(name) traceScope RMATRIX_TRACE_CONCAT(traceScope_, __LINE__)(name)
+#define RMATRIX_TRACE_SPAN(name, start) traceRecorder::Record(name, start, traceRecorder::Now())
+#define RMATRIX_TRACE_DUMP() traceRecorder::Write("RMatrixTrace.json")
+
+#else
+
+#define RMATRIX_TRACE_SCOPE(name) ((void)0)
+#define RMATRIX_TRACE_SPAN(name, start) ((void)0)
+#define RMATRIX_TRACE_DUMP() ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef workerInitialization_hh
+#define workerInitialization_hh 1
+
+#include "G4UserWorkerInitialization.hh"
+#include "globals.hh"
+
+#include <vector>
+
+// workerInitialization class places the worker threads of a
+// multithreaded run.  With pinning on, every worker is bound to one CPU
+// of those the process may use, as the very first thing it does, so
+// that everything it allocates afterwards (physics vectors, track
+// stacks, user actions, tallies, output buffers) is first touched, and
+// therefore placed, on the memory of the CPU it will keep running on.
+//
+// With NUMA placement on, workers are also spread over the NUMA nodes
+// in turn, so that a dual-socket node fills both sockets evenly, and
+// each worker asks the kernel for local allocation, overriding any
+// interleave policy inherited from the launcher.
+//
+// Where each worker landed is printed by ReportPlacement once the
+// workers have started (after the run manager is initialized).  Only
+// Linux is supported; elsewhere the options are ignored with a warning.
+
+class workerInitialization : public G4UserWorkerInitialization
+{
+public:
+  workerInitialization();
+  ~workerInitialization();
+
+  // Called on every worker thread, before anything else is set up
+  void WorkerInitialize() const override;
+
+  // Called from main before the run manager is initialized
+  static void SetPinThreads(G4bool pin)
+  { pinThreads = pin; }
+
+  static void SetNUMAPlacement(G4bool numa)
+  { numaPlacement = numa; }
+
+  static G4bool IsPinning() { return pinThreads or numaPlacement; }
+
+  // Pins the calling thread as worker number workerID
+  static void PlaceThread(G4int workerID);
+
+  // Pins the main thread of a sequential run, which has no workers
+  static void PlaceMainThread()
+  { FindCPUs();
+    PlaceThread(-1); }
+
+  static void ReportPlacement();
+
+private:
+  // CPUs the process may run on, in the order workers take them, and
+  // the NUMA node of each
+  static void FindCPUs();
+
+  static G4bool pinThreads;
+  static G4bool numaPlacement;
+
+  static std::vector<G4int> cpuOrder;
+  static std::vector<G4int> cpuNode;
+
+  struct placement
+  {
+    G4int workerID;
+    G4int cpu;
+    G4int node;
+  };
+  static std::vector<placement> placements;
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include "G4MaterialsBuilder.hh"
 #include "G4StaticMaterialsData.hh"
+#include "traceRecorder.hh"
 #include <string>
 
 #include "G4NistManager.hh"
@@ -46,7 +47,11 @@ G4Material *G4MaterialsBuilder::FindOrBuildPNNLMaterial(G4String name)
 
 G4Material *G4MaterialsBuilder::FindOrBuildOpticalMaterial(G4String name)
 {
-  G4Material *mat = BuildMaterial(name);
+  // Reuse the material if the geometry is being rebuilt, rather than
+  // registering a second copy under the same name
+  G4Material *mat = G4Material::GetMaterial(name, false);
+  if(mat == nullptr)
+    mat = BuildMaterial(name);
   return mat;
 }
 
@@ -221,6 +226,7 @@ void G4MaterialsBuilder::AddElementByIsotopes(const G4String &name,
 
 void G4MaterialsBuilder::Initialize()
 {
+  RMATRIX_TRACE_SCOPE("G4MaterialsBuilder::Initialize");
   StandardMaterials();
   PNNLMaterials();
   OpticalMaterials();
@@ -325,6 +331,7 @@ void G4MaterialsBuilder::OpticalMaterials()
 
 G4Material* G4MaterialsBuilder::BuildMaterial(const G4String &name)
 {
+  RMATRIX_TRACE_SCOPE("G4MaterialsBuilder::BuildMaterial");
   newMaterial = nullptr;
   
   G4int matID = -1;
@@ -411,6 +418,7 @@ G4Material* G4MaterialsBuilder::BuildMaterial(const G4String &name)
 
 void G4MaterialsBuilder::AddOpticalProperties(const G4String &name, G4Material *material)
 {
+  RMATRIX_TRACE_SCOPE("G4MaterialsBuilder::AddOpticalProperties");
   G4MaterialPropertiesTable *Mat_MPT = new G4MaterialPropertiesTable();
   const G4double nm2eV = 1239.583*eV*nm;
   // Find material, and index in storage vectors
@@ -1,12 +1,32 @@
 #include "G4Event.hh"
 #include "G4ParticleGun.hh"
 #include "G4GeneralParticleSource.hh"
+#include "G4GeneralParticleSourceData.hh"
+#include "G4SingleParticleSource.hh"
+#include "G4SPSAngDistribution.hh"
 #include "G4ParticleTable.hh"
 #include "G4ParticleDefinition.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4PhysicalConstants.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4RunManager.hh"
+#include "G4OpticalPhoton.hh"
+#include "G4LogicalVolume.hh"
+#include "G4Material.hh"
+#include "G4MaterialPropertiesTable.hh"
+#include "G4Tubs.hh"
+#include "Randomize.hh"
 
 #include "PGA.hh"
+#include "PGAMessenger.hh"
+#include "runAction.hh"
+#include "geometryConstruction.hh"
+#include "lightCollectionMap.hh"
+#include "traceRecorder.hh"
+
+#include <algorithm>
+#include <cmath>
 
 // PGA stands for Primary Generator Action.  This is the "source" of
 // particles.  PGA creates point sources of particles.  A far more
@@ -14,7 +34,12 @@
 // module that is included with Geant4.  See online documentation.
 
 PGA::PGA() 
+  : coneBiasing(false),
+    spectrumMaterial(nullptr)
 {
+  // Create a messenger to allow user commands
+  sourceMessenger = new PGAMessenger(this);
+
   // One 1 particle per event
   G4int n_particle = 1;
 
@@ -43,9 +68,183 @@ PGA::PGA()
 
 
 PGA::~PGA()
-{ delete particleSource; }
+{
+  delete sourceMessenger;
+  delete particleSource;
+}
 
 
 void PGA::GeneratePrimaries(G4Event* anEvent)
-{ particleSource -> GeneratePrimaryVertex(anEvent); } 
+{
+  RMATRIX_TRACE_SCOPE("PGA::GeneratePrimaries");
+
+  // This is the first user hook of every event, so the event's own
+  // random stream has to be set up here, before the source is sampled
+  runAction::SeedEvent(anEvent->GetEventID());
+
+  if(lightCollectionMap::GetMode() == lightCollectionMap::collectionCalibrate){
+    GenerateCalibrationPhotons(anEvent);
+    return;
+  }
+
+  particleSource -> GeneratePrimaryVertex(anEvent);
+
+  if(coneBiasing)
+    BiasDirection(anEvent);
+}
+
+
+void PGA::BiasDirection(G4Event *anEvent)
+{
+  // The weight is the isotropic density over the cone density, so any
+  // other angular distribution would be replaced with a wrong weight
+  G4GeneralParticleSourceData *sources = G4GeneralParticleSourceData::Instance();
+  for(G4int i=0; i<sources->GetSourceVectorSize(); i++)
+    if(sources->GetCurrentSource(i)->GetAngDist()->GetDistType() != "iso"){
+      G4ExceptionDescription description;
+      description << "Cone biasing needs an isotropic source, but source " << i << " has /gps/ang/type "
+		  << sources->GetCurrentSource(i)->GetAngDist()->GetDistType()
+		  << "; set /gps/ang/type iso or /RMatrix/source/coneBiasing off";
+      G4Exception("PGA::BiasDirection()",
+		  "PGA-002",
+		  FatalException,
+		  description);
+      return;
+    }
+
+  const geometryConstruction *geometry = static_cast<const geometryConstruction *>
+    (G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+  const std::vector<G4ThreeVector> &centres = geometry->GetDetectorCentres();
+  const std::vector<G4double> &radii = geometry->GetDetectorRadii();
+
+  G4PrimaryVertex *vertex = anEvent->GetPrimaryVertex(0);
+  G4ThreeVector origin = vertex->GetPosition();
+
+  // Work out the cone each detector subtends from the source point
+  coneAxes.clear();
+  coneCosMax.clear();
+  coneSolidAngles.clear();
+  G4double totalSolidAngle = 0.;
+  for(std::size_t k=0; k<centres.size(); k++){
+    G4ThreeVector toDetector = centres[k] - origin;
+    G4double distance = toDetector.mag();
+
+    // A source inside a bounding sphere sees it over all directions,
+    // so there is nothing to gain and the event is left unbiased
+    if(distance <= radii[k])
+      return;
+
+    G4double sinMax = radii[k] / distance;
+    G4double cosMax = std::sqrt(1. - sinMax*sinMax);
+    coneAxes.push_back(toDetector / distance);
+    coneCosMax.push_back(cosMax);
+    coneSolidAngles.push_back(twopi*(1. - cosMax));
+    totalSolidAngle += coneSolidAngles.back();
+  }
+  if(coneAxes.empty())
+    return;
 
+  // Pick a cone in proportion to its solid angle, then a direction
+  // uniformly inside it
+  G4double pick = G4UniformRand()*totalSolidAngle;
+  std::size_t chosen = 0;
+  while(chosen+1 < coneAxes.size() and pick > coneSolidAngles[chosen]){
+    pick -= coneSolidAngles[chosen];
+    chosen++;
+  }
+
+  G4double cosTheta = 1. - G4UniformRand()*(1. - coneCosMax[chosen]);
+  G4double sinTheta = std::sqrt(std::max(0., 1. - cosTheta*cosTheta));
+  G4double phi = twopi*G4UniformRand();
+  G4ThreeVector direction(sinTheta*std::cos(phi), sinTheta*std::sin(phi), cosTheta);
+  direction.rotateUz(coneAxes[chosen]);
+
+  // The sampling density is (number of cones covering the direction)
+  // / totalSolidAngle, against 1/(4 pi) for the isotropic source
+  G4int nCovering = 0;
+  for(std::size_t k=0; k<coneAxes.size(); k++)
+    if(direction.dot(coneAxes[k]) >= coneCosMax[k])
+      nCovering++;
+  G4double weight = totalSolidAngle / (4.*pi*std::max(nCovering, 1));
+
+  for(G4int i=0; i<vertex->GetNumberOfParticle(); i++){
+    G4PrimaryParticle *primary = vertex->GetPrimary(i);
+    primary->SetMomentumDirection(direction);
+    primary->SetWeight(primary->GetWeight()*weight);
+  }
+}
+
+
+void PGA::GenerateCalibrationPhotons(G4Event *anEvent)
+{
+  const geometryConstruction *geometry = static_cast<const geometryConstruction *>
+    (G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+  const G4LogicalVolume *scint = geometry->GetScintVolume();
+  const G4Tubs *cylinder = static_cast<const G4Tubs *>(scint->GetSolid());
+
+  // Tabulate the emission spectrum whenever the material changes
+  if(geometry->GetDetectorMaterial(0) != spectrumMaterial){
+    spectrumMaterial = geometry->GetDetectorMaterial(0);
+    spectrumEnergies.clear();
+    spectrumCumulative.clear();
+
+    G4MaterialPropertiesTable *MPT = spectrumMaterial->GetMaterialPropertiesTable();
+    G4MaterialPropertyVector *spectrum = MPT ? MPT->GetProperty("SCINTILLATIONCOMPONENT1") : nullptr;
+    if(spectrum == nullptr or spectrum->GetVectorLength() < 2){
+      G4Exception("PGA::GenerateCalibrationPhotons()",
+		  "PGA-001",
+		  FatalException,
+		  "The scintillator material has no emission spectrum");
+      return;
+    }
+
+    // Trapezoidal integral of the tabulated spectrum
+    G4double sum = 0.;
+    for(std::size_t i=0; i<spectrum->GetVectorLength(); i++){
+      if(i > 0)
+	sum += 0.5*((*spectrum)[i] + (*spectrum)[i-1])
+	  *(spectrum->Energy(i) - spectrum->Energy(i-1));
+      spectrumEnergies.push_back(spectrum->Energy(i));
+      spectrumCumulative.push_back(sum);
+    }
+    for(G4double &value : spectrumCumulative)
+      value /= sum;
+  }
+
+  // Uniform point in the cylinder
+  G4double r = cylinder->GetOuterRadius()*std::sqrt(G4UniformRand());
+  G4double phi = twopi*G4UniformRand();
+  G4double z = cylinder->GetZHalfLength()*(2.*G4UniformRand() - 1.);
+  G4ThreeVector position = geometry->GetDetectorCentres()[0]
+    + G4ThreeVector(r*std::cos(phi), r*std::sin(phi), z);
+
+  G4PrimaryVertex *vertex = new G4PrimaryVertex(position, 0.);
+
+  for(G4int i=0; i<lightCollectionMap::GetPhotonsPerEvent(); i++){
+    G4double cosTheta = 2.*G4UniformRand() - 1.;
+    G4double sinTheta = std::sqrt(1. - cosTheta*cosTheta);
+    G4double photonPhi = twopi*G4UniformRand();
+    G4ThreeVector direction(sinTheta*std::cos(photonPhi), sinTheta*std::sin(photonPhi), cosTheta);
+
+    // Random linear polarisation, perpendicular to the direction
+    G4ThreeVector polarisation = direction.orthogonal().unit();
+    polarisation.rotate(twopi*G4UniformRand(), direction);
+
+    // Photon energy drawn from the (linearly interpolated) spectrum
+    G4double pick = G4UniformRand();
+    std::size_t k = std::upper_bound(spectrumCumulative.begin(), spectrumCumulative.end(), pick)
+      - spectrumCumulative.begin();
+    k = std::min(std::max(k, std::size_t(1)), spectrumCumulative.size() - 1);
+    G4double fraction = (spectrumCumulative[k] > spectrumCumulative[k-1]) ?
+      (pick - spectrumCumulative[k-1])/(spectrumCumulative[k] - spectrumCumulative[k-1]) : 0.;
+    G4double energy = spectrumEnergies[k-1] + fraction*(spectrumEnergies[k] - spectrumEnergies[k-1]);
+
+    G4PrimaryParticle *photon = new G4PrimaryParticle(G4OpticalPhoton::OpticalPhotonDefinition());
+    photon->SetKineticEnergy(energy);
+    photon->SetMomentumDirection(direction);
+    photon->SetPolarization(polarisation);
+    vertex->SetPrimary(photon);
+  }
+
+  anEvent->AddPrimaryVertex(vertex);
+}
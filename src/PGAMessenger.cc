@@ -0,0 +1,40 @@
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+
+#include "PGA.hh"
+#include "PGAMessenger.hh"
+
+// PGAMessenger is how the user can change the source sampling on top
+// of the usual /gps/ commands.
+
+PGAMessenger::PGAMessenger(PGA *generator)
+  : thePGA(generator)
+{
+  // Creates a new directory where the commands will live
+  sourceDir = new G4UIdirectory("/RMatrix/source/");
+  sourceDir -> SetGuidance("Source sampling control");
+
+  // Command will let the user aim the source at the detectors only
+  coneCommand = new G4UIcmdWithAString("/RMatrix/source/coneBiasing",this);
+  coneCommand -> SetGuidance("Only emit primaries towards the detectors, with a geometric weight");
+  coneCommand -> SetGuidance("Needs an isotropic source (/gps/ang/type iso); other angular");
+  coneCommand -> SetGuidance("distributions stop the run");
+  coneCommand -> SetParameterName("choice",true);
+  coneCommand -> SetDefaultValue("on");
+  coneCommand -> SetCandidates("on off");
+  coneCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+}
+
+PGAMessenger::~PGAMessenger()
+{
+  delete coneCommand;
+  delete sourceDir;
+}
+
+
+void PGAMessenger::SetNewValue(G4UIcommand *command,
+			       G4String newValue)
+{
+  if(command == coneCommand)
+    thePGA -> SetConeBiasing(newValue);
+}
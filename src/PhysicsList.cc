@@ -1,18 +1,110 @@
 #include "PhysicsList.hh"
+#include "PhysicsListMessenger.hh"
+#include "neutronHPPhysics.hh"
+#include "neutronResponseModel.hh"
+
+#include "G4EmStandardPhysics.hh"
+#include "G4EmStandardPhysics_option1.hh"
+#include "G4EmStandardPhysics_option3.hh"
+#include "G4EmStandardPhysics_option4.hh"
+#include "G4HadronElasticPhysicsHP.hh"
+#include "G4DecayPhysics.hh"
+#include "G4FastSimulationPhysics.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <limits>
+
+G4double PhysicsList::neutronEnergyLimit = std::numeric_limits<G4double>::max();
 
 PhysicsList::PhysicsList() 
+  : thePhysicsList(nullptr),
+    theOpticalPhysics(nullptr),
+    theBiasingPhysics(nullptr),
+    listName("QGSP_BIC_HP"),
+    emOption(0)
 {
-  thePhysicsList = new QGSP_BIC_HP(0);
+  // Create a messenger to allow user commands
+  physicsMessenger = new PhysicsListMessenger(this);
+}
+
+
+PhysicsList::~PhysicsList()
+{
+  delete physicsMessenger;
+  delete thePhysicsList;
+  delete theOpticalPhysics;
+}
+
+
+G4VModularPhysicsList *PhysicsList::GetPhysicsList()
+{
+  if(thePhysicsList)
+    return thePhysicsList;
+
+  if(listName == "lean"){
+    thePhysicsList = BuildLeanList();
+    neutronEnergyLimit = 20.*MeV;
+  }
+  else
+    thePhysicsList = new QGSP_BIC_HP(0);
 
   theOpticalPhysics = new G4OpticalPhysics(0);
   auto theOpticalParameters = G4OpticalParameters::Instance();
   theOpticalParameters->SetScintByParticleType(true);
+  if(listName == "lean"){
+    // Photons are killed as soon as they are counted, so only their
+    // creation by scintillation is needed
+    theOpticalParameters->SetProcessActivation("Cerenkov", false);
+    theOpticalParameters->SetProcessActivation("OpAbsorption", false);
+    theOpticalParameters->SetProcessActivation("OpRayleigh", false);
+    theOpticalParameters->SetProcessActivation("OpMieHG", false);
+    theOpticalParameters->SetProcessActivation("OpBoundary", false);
+    theOpticalParameters->SetProcessActivation("OpWLS", false);
+    theOpticalParameters->SetProcessActivation("OpWLS2", false);
+  }
   thePhysicsList->RegisterPhysics(theOpticalPhysics);
+
+  // Wrap the neutron processes so that forceCollisionOperator can bias
+  // them in the scintillator.  Without an active operator the wrapped
+  // processes behave exactly as the originals
+  theBiasingPhysics = new G4GenericBiasingPhysics();
+  theBiasingPhysics->Bias("neutron");
+  thePhysicsList->RegisterPhysics(theBiasingPhysics);
+
+  // Lets neutronResponseModel take over neutrons in the scintillator
+  // region.  Only registered for fast mode, so that every other run
+  // keeps the plain neutron transport
+  G4bool fastResponse = (neutronResponseModel::GetMode() == neutronResponseModel::responseFast);
+  if(fastResponse){
+    G4FastSimulationPhysics *fastSimulationPhysics = new G4FastSimulationPhysics();
+    fastSimulationPhysics->ActivateFastSimulation("neutron");
+    thePhysicsList->RegisterPhysics(fastSimulationPhysics);
+  }
+  neutronResponseModel::SetFastSimulationPhysics(fastResponse);
+
+  return thePhysicsList;
 }
 
 
-PhysicsList::~PhysicsList()
+G4VModularPhysicsList *PhysicsList::BuildLeanList()
 {
-  delete thePhysicsList;
-  delete theOpticalPhysics;
+  G4VModularPhysicsList *leanList = new G4VModularPhysicsList();
+  leanList->SetVerboseLevel(0);
+
+  // Particle definitions (ions for the recoils) and decays
+  leanList->RegisterPhysics(new G4DecayPhysics(0));
+
+  if(emOption == 1)
+    leanList->RegisterPhysics(new G4EmStandardPhysics_option1(0));
+  else if(emOption == 3)
+    leanList->RegisterPhysics(new G4EmStandardPhysics_option3(0));
+  else if(emOption == 4)
+    leanList->RegisterPhysics(new G4EmStandardPhysics_option4(0));
+  else
+    leanList->RegisterPhysics(new G4EmStandardPhysics(0));
+
+  leanList->RegisterPhysics(new G4HadronElasticPhysicsHP(0));
+  leanList->RegisterPhysics(new neutronHPPhysics());
+
+  return leanList;
 }
@@ -0,0 +1,57 @@
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithAnInteger.hh"
+
+#include "PhysicsList.hh"
+#include "PhysicsListMessenger.hh"
+
+// PhysicsListMessenger lets the user pick the physics configuration.
+// Physics cannot be changed once the run manager is initialized, so
+// these commands are only available in the PreInit state (e.g. through
+// the --physics command line option of RMatrixGen).
+
+PhysicsListMessenger::PhysicsListMessenger(PhysicsList *physicsList)
+  : PL(physicsList)
+{
+  physicsDir = new G4UIdirectory("/RMatrix/physics/", false);
+  physicsDir -> SetGuidance("Physics list selection");
+
+  // Command will let the user choose the physics list
+  listCommand = new G4UIcmdWithAString("/RMatrix/physics/list",this);
+  listCommand -> SetGuidance("Choose the physics list");
+  listCommand -> SetGuidance("  QGSP_BIC_HP: full reference list (default)");
+  listCommand -> SetGuidance("  lean: HP neutrons below 20 MeV, standard EM and scintillation only;");
+  listCommand -> SetGuidance("        source neutrons above 20 MeV are refused");
+  listCommand -> SetParameterName("list",false);
+  listCommand -> SetCandidates("QGSP_BIC_HP lean");
+  listCommand -> AvailableForStates(G4State_PreInit);
+  listCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user choose the EM option of the lean list
+  emOptionCommand = new G4UIcmdWithAnInteger("/RMatrix/physics/emOption",this);
+  emOptionCommand -> SetGuidance("Choose the standard EM option used by the lean list");
+  emOptionCommand -> SetGuidance("The list is built before any macro runs, so this is set");
+  emOptionCommand -> SetGuidance("through the --em-option command line option");
+  emOptionCommand -> SetParameterName("option",false);
+  emOptionCommand -> SetCandidates("0 1 3 4");
+  emOptionCommand -> AvailableForStates(G4State_PreInit);
+  emOptionCommand -> SetToBeBroadcasted(false);
+}
+
+PhysicsListMessenger::~PhysicsListMessenger()
+{
+  delete emOptionCommand;
+  delete listCommand;
+  delete physicsDir;
+}
+
+
+void PhysicsListMessenger::SetNewValue(G4UIcommand *command,
+				       G4String newValue)
+{
+  if(command == listCommand)
+    PL -> SetListName(newValue);
+
+  if(command == emOptionCommand)
+    PL -> SetEmOption(emOptionCommand->GetNewIntValue(newValue));
+}
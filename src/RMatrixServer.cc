@@ -0,0 +1,168 @@
+#include "G4UImanager.hh"
+#include "G4RunManager.hh"
+#include "G4Run.hh"
+#include "G4ios.hh"
+
+#include "RMatrixServer.hh"
+#include "eventAction.hh"
+
+#include <csignal>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+RMatrixServer::RMatrixServer()
+{;}
+
+
+RMatrixServer::~RMatrixServer()
+{;}
+
+
+void RMatrixServer::Start(G4String socketPath)
+{
+  // A client that disappears mid-reply should not take the server down
+  signal(SIGPIPE, SIG_IGN);
+
+  if(socketPath == "-"){
+    G4cout << "\n *********** Server Listening on stdin *************"
+	   << G4endl;
+    Session(STDIN_FILENO, STDOUT_FILENO);
+    return;
+  }
+
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if(socketPath.size() >= sizeof(address.sun_path)){
+    G4Exception("RMatrixServer::Start()",
+		"RMatrixServer-001",
+		FatalException,
+		"Socket path is too long for a Unix domain socket");
+    return;
+  }
+  std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+  int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(socketPath.c_str());
+  if(listenFd < 0
+     or bind(listenFd, (sockaddr *)&address, sizeof(address)) < 0
+     or listen(listenFd, 1) < 0){
+    G4Exception("RMatrixServer::Start()",
+		"RMatrixServer-002",
+		FatalException,
+		"Could not open the server socket");
+    return;
+  }
+
+  G4cout << "\n *********** Server Listening on " << socketPath
+	 << " *************" << G4endl;
+
+  // Clients are served one at a time, since there is only one run
+  // manager to hand out
+  G4bool keepServing = true;
+  while(keepServing){
+    int clientFd = accept(listenFd, nullptr, nullptr);
+    if(clientFd < 0)
+      continue;
+
+    readBuffer.clear();
+    keepServing = Session(clientFd, clientFd);
+    close(clientFd);
+  }
+
+  close(listenFd);
+  unlink(socketPath.c_str());
+}
+
+
+G4bool RMatrixServer::Session(int inFd, int outFd)
+{
+  G4UImanager *UI = G4UImanager::GetUIpointer();
+
+  WriteLine(outFd, "READY");
+
+  G4String line;
+  while(ReadLine(inFd, line)){
+    // Strip surrounding whitespace and skip blank lines and comments
+    std::size_t first = line.find_first_not_of(" \t\r");
+    if(first == std::string::npos or line[first] == '#')
+      continue;
+    std::size_t last = line.find_last_not_of(" \t\r");
+    G4String command = line.substr(first, last - first + 1);
+
+    if(command == "exit")
+      return true;
+
+    if(command == "shutdown"){
+      WriteLine(outFd, "BYE");
+      return false;
+    }
+
+    if(command[0] != '/'){
+      WriteLine(outFd, "ERROR unknown " + command);
+      continue;
+    }
+
+    G4int status = UI -> ApplyCommand(command);
+    if(status != fCommandSucceeded){
+      WriteLine(outFd, "ERROR " + std::to_string(status) + " " + command);
+      continue;
+    }
+
+    // Once a job has run, hand back where its results were written
+    if(command.compare(0, 11, "/run/beamOn") == 0){
+      const G4Run *run = G4RunManager::GetRunManager() -> GetCurrentRun();
+      G4int nEvents = run ? run -> GetNumberOfEvent() : 0;
+      G4String outputFile = eventAction::GetDataOutput() ?
+	eventAction::GetOutputFileName() : G4String("none");
+      WriteLine(outFd, "DONE " + std::to_string(nEvents) + " " + outputFile);
+    }
+    else
+      WriteLine(outFd, "OK");
+  }
+
+  // The client hung up; stdin mode has nobody else to serve
+  return inFd != STDIN_FILENO;
+}
+
+
+G4bool RMatrixServer::ReadLine(int fd, G4String &line)
+{
+  std::size_t newline;
+  while((newline = readBuffer.find('\n')) == std::string::npos){
+    char chunk[4096];
+    ssize_t nRead = read(fd, chunk, sizeof(chunk));
+    if(nRead <= 0){
+      // Hand back a final unterminated command before reporting EOF
+      if(readBuffer.empty())
+	return false;
+      line = readBuffer;
+      readBuffer.clear();
+      return true;
+    }
+    readBuffer.append(chunk, nRead);
+  }
+
+  line = readBuffer.substr(0, newline);
+  readBuffer.erase(0, newline + 1);
+  return true;
+}
+
+
+void RMatrixServer::WriteLine(int fd, const G4String &line)
+{
+  // Make sure replies are not overtaken by buffered Geant4 output
+  // when both go to stdout
+  G4cout << std::flush;
+
+  std::string reply = "RMATRIX> " + line + "\n";
+  std::size_t written = 0;
+  while(written < reply.size()){
+    ssize_t n = write(fd, reply.c_str() + written, reply.size() - written);
+    if(n <= 0)
+      return;
+    written += n;
+  }
+}
@@ -0,0 +1,35 @@
+#include "actionInitialization.hh"
+#include "PGA.hh"
+#include "runAction.hh"
+#include "eventAction.hh"
+#include "stackingAction.hh"
+#include "steppingAction.hh"
+
+actionInitialization::actionInitialization()
+{;}
+
+
+actionInitialization::~actionInitialization()
+{;}
+
+
+void actionInitialization::BuildForMaster() const
+{
+  SetUserAction(new runAction);
+}
+
+
+void actionInitialization::Build() const
+{
+  SetUserAction(new PGA);
+
+  runAction *rnAction = new runAction;
+  SetUserAction(rnAction);
+
+  eventAction *evtAction = new eventAction(rnAction);
+  SetUserAction(evtAction);
+
+  SetUserAction(new stackingAction(rnAction, evtAction));
+
+  SetUserAction(new steppingAction(rnAction, evtAction));
+}
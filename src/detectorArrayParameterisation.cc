@@ -0,0 +1,30 @@
+#include "G4VPhysicalVolume.hh"
+#include "G4Material.hh"
+
+#include "detectorArrayParameterisation.hh"
+
+detectorArrayParameterisation::detectorArrayParameterisation(const std::vector<G4ThreeVector> &positions,
+							     const std::vector<G4Material *> &materials)
+  : detectorPositions(positions),
+    detectorMaterials(materials)
+{;}
+
+
+detectorArrayParameterisation::~detectorArrayParameterisation()
+{;}
+
+
+void detectorArrayParameterisation::ComputeTransformation(const G4int copyNo,
+							  G4VPhysicalVolume *physVol) const
+{
+  physVol->SetTranslation(detectorPositions[copyNo]);
+  physVol->SetRotation(nullptr);
+}
+
+
+G4Material *detectorArrayParameterisation::ComputeMaterial(const G4int copyNo,
+							   G4VPhysicalVolume *,
+							   const G4VTouchable *)
+{
+  return detectorMaterials[copyNo];
+}
@@ -0,0 +1,104 @@
+#include "detectorArrayTally.hh"
+
+#include <algorithm>
+#include <iomanip>
+
+detectorArrayTally::detectorArrayTally(const G4String &name)
+  : G4VAccumulable(name)
+{
+  SetNumberOfDetectors(1);
+}
+
+
+detectorArrayTally::~detectorArrayTally()
+{;}
+
+
+void detectorArrayTally::SetNumberOfDetectors(G4int n)
+{
+  nDetectors = n;
+  singles.assign(nDetectors, 0.);
+  multiplicity.assign(nDetectors + 1, 0.);
+  pairs.assign(nDetectors*nDetectors, 0.);
+}
+
+
+void detectorArrayTally::Fill(const std::vector<G4int> &firedDetectors, G4double weight)
+{
+  std::size_t nFired = firedDetectors.size();
+  multiplicity[std::min(nFired, multiplicity.size() - 1)] += weight;
+
+  for(std::size_t i=0; i<nFired; i++){
+    singles[firedDetectors[i]] += weight;
+    for(std::size_t j=i+1; j<nFired; j++){
+      G4int first = std::min(firedDetectors[i], firedDetectors[j]);
+      G4int second = std::max(firedDetectors[i], firedDetectors[j]);
+      pairs[first*nDetectors + second] += weight;
+    }
+  }
+}
+
+
+void detectorArrayTally::Merge(const G4VAccumulable &other)
+{
+  const detectorArrayTally &otherTally = static_cast<const detectorArrayTally &>(other);
+  if(otherTally.nDetectors != nDetectors)
+    return;
+
+  for(G4int i=0; i<nDetectors; i++)
+    singles[i] += otherTally.singles[i];
+  for(std::size_t i=0; i<multiplicity.size(); i++)
+    multiplicity[i] += otherTally.multiplicity[i];
+  for(std::size_t i=0; i<pairs.size(); i++)
+    pairs[i] += otherTally.pairs[i];
+}
+
+
+void detectorArrayTally::Reset()
+{
+  std::fill(singles.begin(), singles.end(), 0.);
+  std::fill(multiplicity.begin(), multiplicity.end(), 0.);
+  std::fill(pairs.begin(), pairs.end(), 0.);
+}
+
+
+void detectorArrayTally::Pack(std::vector<G4double> &buffer) const
+{
+  buffer.insert(buffer.end(), singles.begin(), singles.end());
+  buffer.insert(buffer.end(), multiplicity.begin(), multiplicity.end());
+  buffer.insert(buffer.end(), pairs.begin(), pairs.end());
+}
+
+
+std::size_t detectorArrayTally::Unpack(const std::vector<G4double> &buffer, std::size_t position)
+{
+  for(std::vector<G4double> *tally : {&singles, &multiplicity, &pairs}){
+    std::copy(buffer.begin() + position, buffer.begin() + position + tally->size(), tally->begin());
+    position += tally->size();
+  }
+  return position;
+}
+
+
+void detectorArrayTally::Print(G4int nEvents) const
+{
+  G4double norm = 1./std::max(nEvents, 1);
+
+  G4cout << "\n Detector array (" << nDetectors << " detectors), fraction of events:"
+	 << "\n   detector   with light" << G4endl;
+  for(G4int i=0; i<nDetectors; i++)
+    G4cout << "   " << std::setw(8) << i << "   " << singles[i]*norm << G4endl;
+
+  G4cout << "   detectors firing together:";
+  for(std::size_t m=1; m<multiplicity.size(); m++)
+    if(multiplicity[m] > 0.)
+      G4cout << "  " << m << ": " << multiplicity[m]*norm;
+  G4cout << G4endl;
+
+  G4cout << "   cross-talk pairs:" << G4endl;
+  for(G4int i=0; i<nDetectors; i++)
+    for(G4int j=i+1; j<nDetectors; j++)
+      if(pairs[i*nDetectors + j] > 0.)
+	G4cout << "   " << std::setw(4) << i << " + " << std::setw(4) << j
+	       << "   " << pairs[i*nDetectors + j]*norm << G4endl;
+}
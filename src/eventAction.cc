@@ -1,24 +1,51 @@
 #include "G4Event.hh"
 #include "G4UnitsTable.hh"
 #include "G4Track.hh"
+#include "G4Gamma.hh"
+#include "G4Neutron.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4PrimaryParticle.hh"
 #include "G4RunManagerKernel.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4PhysicalConstants.hh"
 
 #include "eventAction.hh"
 #include "eventActionMessenger.hh"
+#include "runAction.hh"
+#include "progressMonitor.hh"
+#include "traceRecorder.hh"
+#include "neutronResponseTable.hh"
+#include "lightCollectionMap.hh"
+#include "geometryConstruction.hh"
 #include "G4RunManager.hh"
+#include "G4Threading.hh"
+#include "G4AutoLock.hh"
 
-eventAction::eventAction()
+#include <algorithm>
+
+namespace { G4Mutex outputMutex = G4MUTEX_INITIALIZER; }
+
+G4String eventAction::outputFileName = "defaultOutput.csv";
+G4bool eventAction::outputEnabled = false;
+
+eventAction::eventAction(runAction *currentRun)
+  : nBranches(0),
+    hitThreshold(0),
+    rnAction(currentRun)
 {
+  // The detector construction is shared by all threads and keeps
+  // track of the detectors of the current geometry
+  geometry = static_cast<const geometryConstruction *>
+    (G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+
   // Create a messenger to allow user commands 
   eventMessenger = new eventActionMessenger(this);
   
   // This sets the name of the default MuSE output data file
-  eventOutput.open("defaultOutput.csv",std::ofstream::trunc);
+  eventOutput.open(ThreadFileName(GetOutputFileName()),std::ofstream::trunc);
 
   // This is a boolean 'on' or 'off' switch to control data ouput
-  dataOutputSwitch = false;
+  dataOutputSwitch = GetDataOutput();
 }
 
 
@@ -33,20 +60,265 @@ eventAction::~eventAction()
 // is tracked through the geometry
 void eventAction::BeginOfEventAction(const G4Event *)
 {
+  RMATRIX_TRACE_SCOPE("eventAction::BeginOfEventAction");
+#ifdef RMATRIX_TRACING
+  traceEventStart = traceRecorder::Now();
+#endif
+
   // Initialization per event.  We need to reset to the total photons
   // generated at the beginning of each event
   PhotonsCreated = 0.;
+  PhotonsCollected = 0;
+  nBranches = 0;
   NeutronEnergy = 0.;
+  entryRecorded = false;
+  primaryEntered = false;
+  recoilSpecies = -1;
+
+  trackOrigins.clear();
+  originsTracked = false;
+  std::fill(primaryEnergies, primaryEnergies + 4, -1.);
+  std::fill(primaryWeights, primaryWeights + 4, 1.);
+}
+
+
+eventAction::lightBranch &eventAction::NewBranch(G4double weight)
+{
+  if(nBranches == G4int(branches.size()))
+    branches.emplace_back();
+  lightBranch &branch = branches[nBranches++];
+
+  branch.weight = weight;
+  branch.created = 0;
+  branch.collected = 0;
+  std::fill(branch.originLight, branch.originLight + nOrigins, 0);
+
+  // Only the detectors that saw light need clearing; the hit array is
+  // only resized when the array itself has changed
+  for(G4int detector : branch.litDetectors)
+    branch.detectorPhotons[detector] = 0;
+  branch.litDetectors.clear();
+  if(G4int(branch.detectorPhotons.size()) != geometry->GetNumberOfDetectors())
+    branch.detectorPhotons.assign(geometry->GetNumberOfDetectors(), 0);
+
+  return branch;
 }
 
 // Anything included in this function is performed at the very end of
 // each event's lifetime.
-void eventAction::EndOfEventAction(const G4Event *)
+void eventAction::EndOfEventAction(const G4Event *anEvent)
 {
-  // If the user has turned data output 'on', and photons were created then do this!
-  if(dataOutputSwitch and (PhotonsCreated > 0))
-    {
-      eventOutput << NeutronEnergy << ";" << PhotonsCreated << std::endl;
+  RMATRIX_TRACE_SCOPE("eventAction::EndOfEventAction");
+  RMATRIX_TRACE_SPAN("event", traceEventStart);
+
+  // A calibration event is a burst of optical photons from one point
+  if(lightCollectionMap::GetMode() == lightCollectionMap::collectionCalibrate){
+    progressMonitor::EventDone(PhotonsCollected);
+    const G4PrimaryVertex *vertex = anEvent->GetPrimaryVertex(0);
+    if(vertex)
+      rnAction->AddLightCalibration(vertex->GetPosition() - geometry->GetDetectorCentres()[0],
+				    vertex->GetNumberOfParticle(), PhotonsCollected);
+    return;
+  }
+
+  // With the light collection map applied, the light of an event is
+  // the number of photons collected rather than created
+  G4bool collecting = (lightCollectionMap::GetMode() == lightCollectionMap::collectionApply);
+  G4int Photons = collecting ? PhotonsCollected : PhotonsCreated;
+
+  progressMonitor::EventDone(Photons);
+
+  // How the source was sampled, so that the matrices and the event
+  // output can be reweighted to other spectra (spectrumReweighter).
+  // The event output gives the energy and species of the first primary
+  const G4PrimaryParticle *firstPrimary = nullptr;
+  if(runAction::GetMatrixOutput() or dataOutputSwitch){
+    rnAction->AddSourceEvent();
+    for(G4int i=0; i<anEvent->GetNumberOfPrimaryVertex(); i++)
+      for(const G4PrimaryParticle *primary = anEvent->GetPrimaryVertex(i)->GetPrimary();
+	  primary; primary = primary->GetNext()){
+	if(!firstPrimary)
+	  firstPrimary = primary;
+	const G4ParticleDefinition *definition = primary->GetParticleDefinition();
+	if(definition == G4Neutron::NeutronDefinition())
+	  rnAction->AddSourcePrimary(false, primary->GetKineticEnergy());
+	else if(definition == G4Gamma::GammaDefinition())
+	  rnAction->AddSourcePrimary(true, primary->GetKineticEnergy());
+      }
+  }
+
+  // Every branch of the event (see lightBranch) is a history of its
+  // own, with its weight.  Whatever weight of the primary no branch
+  // took is the history in which it made no light
+  G4double sourceWeight = firstPrimary ? firstPrimary->GetWeight() : 1.;
+  G4double unlitWeight = sourceWeight;
+  G4double unlitSpeciesWeight[4];
+  std::copy(primaryWeights, primaryWeights + 4, unlitSpeciesWeight);
+  G4bool array = (geometry->GetNumberOfDetectors() > 1);
+
+  for(G4int i=0; i<nBranches; i++){
+    const lightBranch &branch = branches[i];
+    G4int light = collecting ? branch.collected : branch.created;
+    if(light <= 0)
+      continue;
+    unlitWeight -= branch.weight;
+
+    // If the user has turned data output 'on', and photons were created then do this!
+    // Each line is "energy [keV];photons;weight;species" of the primary,
+    // one per branch.  With an array, the light of each detector
+    // follows in copy number order
+    if(dataOutputSwitch){
+      RMATRIX_TRACE_SCOPE("eventAction::WriteEvent");
+      if(firstPrimary)
+	eventOutput << firstPrimary->GetKineticEnergy()/keV << ";" << light << ";" << branch.weight
+		    << ";" << firstPrimary->GetParticleDefinition()->GetParticleName();
+      else
+	eventOutput << NeutronEnergy << ";" << light << ";" << branch.weight << ";none";
+      if(array)
+	for(G4int detectorLight : branch.detectorPhotons)
+	  eventOutput << ";" << detectorLight;
+      eventOutput << std::endl;
+    }
+
+    // Response matrices.  With the origins of the light known, neutron
+    // and gamma primaries each get the light that descends from them;
+    // otherwise all light is put down to the neutron
+    if(runAction::GetMatrixOutput()){
+      if(originsTracked){
+	for(G4int species : {G4int(originNeutron), G4int(originGamma)}){
+	  G4int speciesLight = branch.originLight[species] + branch.originLight[species | originViaGamma];
+	  if(primaryEnergies[species] < 0. or speciesLight <= 0)
+	    continue;
+	  unlitSpeciesWeight[species] -= branch.weight;
+	  rnAction->AddResponse(species == originGamma, primaryEnergies[species],
+				speciesLight, branch.originLight[species | originViaGamma], branch.weight);
+	}
+      }
+      else if(NeutronEnergy > 0.)
+	rnAction->AddResponse(false, NeutronEnergy*keV, light, 0, branch.weight);
+    }
+
+    if(array){
+      firedDetectors.clear();
+      for(G4int detector : branch.litDetectors)
+	if(branch.detectorPhotons[detector] > hitThreshold)
+	  firedDetectors.push_back(detector);
+      rnAction->AddDetectorHits(firedDetectors, branch.weight);
     }
+  }
+
+  // The histories without light.  Rounding of the weights can leave a
+  // remainder of a few ulp, which is not worth an entry
+  G4double smallest = 1e-12*sourceWeight;
+  if(runAction::GetMatrixOutput()){
+    if(originsTracked){
+      for(G4int species : {G4int(originNeutron), G4int(originGamma)})
+	if(primaryEnergies[species] >= 0. and unlitSpeciesWeight[species] > smallest)
+	  rnAction->AddResponse(species == originGamma, primaryEnergies[species], 0, 0,
+				unlitSpeciesWeight[species]);
+    }
+    else if(NeutronEnergy > 0. and unlitWeight > smallest)
+      rnAction->AddResponse(false, NeutronEnergy*keV, 0, 0, unlitWeight);
+  }
+
+  if(array and unlitWeight > smallest){
+    firedDetectors.clear();
+    rnAction->AddDetectorHits(firedDetectors, unlitWeight);
+  }
+
+  // Hand the history of the entering neutron to the response model
+  // tallies.  Light from before the entry (there is none from a neutron
+  // crossing air) is counted with it
+  if(entryRecorded)
+    rnAction->AddNeutronEntry(entryEnergy, entryPosition, entryDirection,
+			      entryRadius, entryHalfLength,
+			      (recoilSpecies < 0) ? G4int(neutronResponseTable::otherRecoil) : recoilSpecies,
+			      PhotonsCreated, entryWeight);
     
 }
+
+
+void eventAction::SetDataOutput(G4String onOff)
+{
+  if(onOff == "on") dataOutputSwitch = true;
+  if(onOff == "off") dataOutputSwitch = false;
+
+  G4AutoLock lock(&outputMutex);
+  outputEnabled = dataOutputSwitch;
+}
+
+
+void eventAction::SetOutputFileName(G4String fName)
+{
+  if(eventOutput.is_open()) eventOutput.close();
+  eventOutput.open(ThreadFileName(fName),std::ofstream::trunc);
+
+  G4AutoLock lock(&outputMutex);
+  outputFileName = fName;
+}
+
+
+G4String eventAction::GetOutputFileName()
+{
+  G4AutoLock lock(&outputMutex);
+  return outputFileName;
+}
+
+
+G4bool eventAction::GetDataOutput()
+{
+  G4AutoLock lock(&outputMutex);
+  return outputEnabled;
+}
+
+
+G4int eventAction::TagTrack(const G4Track *track)
+{
+  G4bool isGamma = (track->GetDefinition() == G4Gamma::GammaDefinition());
+
+  G4int origin;
+  if(track->GetParentID() == 0){
+    if(track->GetDefinition() == G4Neutron::NeutronDefinition())
+      origin = originNeutron;
+    else if(isGamma)
+      origin = originGamma;
+    else
+      origin = originOther;
+
+    // The first primary of each species sets the energy of its column
+    if(primaryEnergies[origin] < 0.){
+      primaryEnergies[origin] = track->GetKineticEnergy();
+      primaryWeights[origin] = track->GetWeight();
+    }
+  }
+  else
+    origin = GetTrackOrigin(track->GetParentID()) & ~G4int(originViaGamma);
+
+  if(isGamma or (GetTrackOrigin(track->GetParentID()) & originViaGamma))
+    origin |= originViaGamma;
+
+  // Track IDs are handed out in order, so this only grows; the vector
+  // keeps its capacity from one event to the next
+  G4int trackID = track->GetTrackID();
+  if(trackID >= G4int(trackOrigins.size()))
+    trackOrigins.resize(trackID + 1, originNone);
+  trackOrigins[trackID] = origin;
+  originsTracked = true;
+
+  return origin;
+}
+
+
+// Worker threads each get their own output file so that no locking is
+// needed per event: "name.csv" becomes "name_t<threadID>.csv"
+G4String eventAction::ThreadFileName(G4String fName)
+{
+  if(!G4Threading::IsMultithreadedApplication() or !G4Threading::IsWorkerThread())
+    return fName;
+
+  G4String suffix = "_t" + std::to_string(G4Threading::G4GetThreadId());
+  std::size_t dot = fName.find_last_of('.');
+  if(dot == std::string::npos or dot < fName.find_last_of('/') + 1)
+    return fName + suffix;
+  return fName.substr(0, dot) + suffix + fName.substr(dot);
+}
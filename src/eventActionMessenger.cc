@@ -1,5 +1,6 @@
 #include "G4UIdirectory.hh"
 #include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithAnInteger.hh"
 
 #include "eventAction.hh"
 #include "eventActionMessenger.hh"
@@ -29,10 +30,19 @@ eventActionMessenger::eventActionMessenger(eventAction *eventAction)
   dataCommand -> SetDefaultValue("on");
   dataCommand -> SetCandidates("on off");
   dataCommand -> AvailableForStates(G4State_Idle);
+
+  // Command will let the user set the light a detector of the array
+  // needs to count as fired in the cross-talk tallies
+  thresholdCommand = new G4UIcmdWithAnInteger("/RMatrix/output/setHitThreshold",this);
+  thresholdCommand -> SetGuidance("Set the number of photons a detector has to exceed to count as fired");
+  thresholdCommand -> SetParameterName("photons",false);
+  thresholdCommand -> SetRange("photons>=0");
+  thresholdCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
 }
 
 eventActionMessenger::~eventActionMessenger()
 {
+  delete thresholdCommand;
   delete dataCommand;
   delete fileCommand;
   delete outputDir;
@@ -51,4 +61,7 @@ void eventActionMessenger::SetNewValue(G4UIcommand *command,
   
   if(command == dataCommand)
     EA -> SetDataOutput(newCommand);
+
+  if(command == thresholdCommand)
+    EA -> SetHitThreshold(thresholdCommand->GetNewIntValue(newCommand));
 }
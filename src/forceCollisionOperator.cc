@@ -0,0 +1,81 @@
+#include "G4BOptrForceCollision.hh"
+#include "G4BiasingProcessInterface.hh"
+#include "G4Track.hh"
+#include "G4Neutron.hh"
+
+#include "forceCollisionOperator.hh"
+
+G4bool forceCollisionOperator::enabled = false;
+
+forceCollisionOperator::forceCollisionOperator()
+  : G4VBiasingOperator("forceCollisionOperator"),
+    currentOperator(nullptr)
+{
+  neutronOperator = new G4BOptrForceCollision("neutron", "forceCollisionNeutron");
+}
+
+
+forceCollisionOperator::~forceCollisionOperator()
+{ delete neutronOperator; }
+
+
+void forceCollisionOperator::StartTracking(const G4Track *track)
+{
+  // Decide once per track whether it is biased, so the per-step
+  // proposals below are a single pointer test
+  currentOperator = nullptr;
+  if(enabled and track->GetDefinition() == G4Neutron::NeutronDefinition())
+    currentOperator = neutronOperator;
+}
+
+
+G4VBiasingOperation *forceCollisionOperator::ProposeNonPhysicsBiasingOperation(const G4Track *track,
+									       const G4BiasingProcessInterface *callingProcess)
+{
+  if(currentOperator)
+    return currentOperator->GetProposedNonPhysicsBiasingOperation(track, callingProcess);
+  return nullptr;
+}
+
+
+G4VBiasingOperation *forceCollisionOperator::ProposeOccurenceBiasingOperation(const G4Track *track,
+									      const G4BiasingProcessInterface *callingProcess)
+{
+  if(currentOperator)
+    return currentOperator->GetProposedOccurenceBiasingOperation(track, callingProcess);
+  return nullptr;
+}
+
+
+G4VBiasingOperation *forceCollisionOperator::ProposeFinalStateBiasingOperation(const G4Track *track,
+									       const G4BiasingProcessInterface *callingProcess)
+{
+  if(currentOperator)
+    return currentOperator->GetProposedFinalStateBiasingOperation(track, callingProcess);
+  return nullptr;
+}
+
+
+void forceCollisionOperator::OperationApplied(const G4BiasingProcessInterface *callingProcess,
+					      G4BiasingAppliedCase biasingCase,
+					      G4VBiasingOperation *operationApplied,
+					      const G4VParticleChange *particleChangeProduced)
+{
+  if(currentOperator)
+    currentOperator->ReportOperationApplied(callingProcess, biasingCase,
+					    operationApplied, particleChangeProduced);
+}
+
+
+void forceCollisionOperator::OperationApplied(const G4BiasingProcessInterface *callingProcess,
+					      G4BiasingAppliedCase biasingCase,
+					      G4VBiasingOperation *occurenceOperationApplied,
+					      G4double weightForOccurenceInteraction,
+					      G4VBiasingOperation *finalStateOperationApplied,
+					      const G4VParticleChange *particleChangeProduced)
+{
+  if(currentOperator)
+    currentOperator->ReportOperationApplied(callingProcess, biasingCase,
+					    occurenceOperationApplied, weightForOccurenceInteraction,
+					    finalStateOperationApplied, particleChangeProduced);
+}
@@ -3,43 +3,196 @@
 #include "G4Box.hh"
 #include "G4LogicalVolume.hh"
 #include "G4PVPlacement.hh"
+#include "G4PVParameterised.hh"
 #include "G4RotationMatrix.hh"
 #include "G4ThreeVector.hh"
 #include "G4VisAttributes.hh"
 #include "G4Colour.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4UnitsTable.hh"
 #include "G4PhysicalConstants.hh"
 #include "G4NistManager.hh"
+#include "G4GeometryManager.hh"
+#include "G4PhysicalVolumeStore.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4SolidStore.hh"
+#include "G4RunManager.hh"
+#include "G4StateManager.hh"
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
+#include "G4ProductionCuts.hh"
+#include "G4ProductionCutsTable.hh"
+#include "G4MaterialPropertiesTable.hh"
+#include "G4OpticalSurface.hh"
+#include "G4LogicalSkinSurface.hh"
+#include "G4LogicalBorderSurface.hh"
 
 #include "geometryConstruction.hh"
+#include "geometryConstructionMessenger.hh"
+#include "forceCollisionOperator.hh"
+#include "neutronResponseModel.hh"
 #include "G4MaterialsManager.hh"
+#include "detectorArrayParameterisation.hh"
+#include "lightCollectionMap.hh"
+#include "traceRecorder.hh"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  // Readout window coupled to the +z face of every scintillator, and
+  // reflectivity of the wrapping on the other faces, in light
+  // collection calibration runs
+  const G4double windowHalfThickness = 0.5*mm;
+  const G4double wrapReflectivity = 0.95;
+
+  // Photon energies the constant optical properties below span
+  const std::vector<G4double> opticalEnergies = {1.5*eV, 6.2*eV};
+
+  // Copy of a NIST material with a constant refractive index, made
+  // once, so that optical photons can be transported into it
+  G4Material *OpticalCopy(const G4String &name, const G4String &nistName, G4double rIndex)
+  {
+    G4Material *material = G4Material::GetMaterial(name, false);
+    if(material)
+      return material;
+
+    G4Material *base = G4MaterialsManager::GetInstance()->GetNISTMaterial(nistName);
+    material = new G4Material(name, base->GetDensity(), base,
+			      base->GetState(), base->GetTemperature(), base->GetPressure());
+    G4MaterialPropertiesTable *MPT = new G4MaterialPropertiesTable();
+    MPT->AddProperty("RINDEX", opticalEnergies, std::vector<G4double>(2, rIndex));
+    material->SetMaterialPropertiesTable(MPT);
+    return material;
+  }
+}
 
 geometryConstruction::geometryConstruction()
-{;}
+  : Scint_material("EJ301"),
+    Scint_rMax(0.5*2.54*cm),
+    Scint_z(0.5*2.54*cm),
+    Scint_posZ(-10.*cm),
+    Envelope_margin(2.*cm),
+    world_L(nullptr), envelope_L(nullptr), block_L(nullptr), window_L(nullptr),
+    scintCuts(nullptr), envelopeCuts(nullptr),
+    arrayParameterisation(nullptr), windowParameterisation(nullptr)
+{
+  // Create a messenger to allow user commands
+  geometryMessenger = new geometryConstructionMessenger(this);
+}
 
 geometryConstruction::~geometryConstruction()
-{;}
+{
+  delete geometryMessenger;
+  delete windowParameterisation;
+  delete arrayParameterisation;
+}
 
 
 G4VPhysicalVolume *geometryConstruction::Construct()
 {
+  RMATRIX_TRACE_SCOPE("geometryConstruction::Construct");
+
+  // Regions outlive the geometry, so detach the old volumes from them
+  // before they are deleted below
+  G4Region *scintRegion = G4RegionStore::GetInstance()->FindOrCreateRegion("ScintillatorRegion");
+  G4Region *envelopeRegion = G4RegionStore::GetInstance()->FindOrCreateRegion("EnvelopeRegion");
+  if(block_L)
+    scintRegion->RemoveRootLogicalVolume(block_L);
+  if(envelope_L)
+    envelopeRegion->RemoveRootLogicalVolume(envelope_L);
+
+  // Clean out any geometry left over from a previous construction so
+  // that the detector can be rebuilt between runs
+  G4GeometryManager::GetInstance()->OpenGeometry();
+  G4PhysicalVolumeStore::GetInstance()->Clean();
+  G4LogicalVolumeStore::GetInstance()->Clean();
+  G4SolidStore::GetInstance()->Clean();
+  G4LogicalBorderSurface::CleanSurfaceTable();
+  G4LogicalSkinSurface::CleanSurfaceTable();
+  G4SurfaceProperty::CleanSurfacePropertyTable();
+
   ////////////////////////
   // G4MaterialsManager //
   ////////////////////////
 
-  G4MaterialsManager *theMaterialsManager = new G4MaterialsManager;
+  if(!G4MaterialsManager::GetInstance())
+    new G4MaterialsManager;
   
+  //////////////////
+  // The Detectors //
+  //////////////////
+
+  // Without an array set up by the user there is the single detector
+  // given by the material and position commands
+  std::vector<G4ThreeVector> positions = arrayPositions;
+  std::vector<G4String> materialNames = arrayMaterials;
+  if(positions.empty()){
+    positions.push_back(G4ThreeVector(0., 0., Scint_posZ));
+    materialNames.push_back(Scint_material);
+  }
+
+  // The readout windows and optical surfaces are only there to build
+  // the light collection map.  Other runs leave them out, so that no
+  // particle crosses glass the real detector light never sees
+  G4bool opticalReadout = (lightCollectionMap::GetMode() == lightCollectionMap::collectionCalibrate);
+  G4double windowThickness = opticalReadout ? 2.*windowHalfThickness : 0.;
+
+  // The detectors of an array are parallel cylinders, each with its
+  // window on the +z face, so two of them overlap when their axes are
+  // closer than a diameter and their z extents cross.  The envelope
+  // and the world are sized from the detectors and always hold them
+  G4double detectorLength = 2.*Scint_z + windowThickness;
+  for(std::size_t i=0; i<positions.size(); i++)
+    for(std::size_t j=i+1; j<positions.size(); j++){
+      G4ThreeVector offset = positions[j] - positions[i];
+      if(offset.perp() >= 2.*Scint_rMax or std::abs(offset.z()) >= detectorLength)
+	continue;
+      G4ExceptionDescription description;
+      description << "Detectors " << i << " at " << G4BestUnit(positions[i], "Length")
+		  << " and " << j << " at " << G4BestUnit(positions[j], "Length")
+		  << " overlap: their centres have to be at least " << G4BestUnit(2.*Scint_rMax, "Length")
+		  << " apart across the axis or " << G4BestUnit(detectorLength, "Length") << " along it";
+      G4Exception("geometryConstruction::Construct()",
+		  "geometryConstruction-001",
+		  FatalException,
+		  description);
+    }
+
+  detectorMaterials.clear();
+  for(const G4String &name : materialNames)
+    detectorMaterials.push_back(G4MaterialsManager::GetInstance()->GetOpticalMaterial(name));
+
+  // The envelope encloses every detector with the margin all round
+  G4ThreeVector lowCorner = positions[0], highCorner = positions[0];
+  for(const G4ThreeVector &position : positions){
+    lowCorner.set(std::min(lowCorner.x(), position.x()),
+		  std::min(lowCorner.y(), position.y()),
+		  std::min(lowCorner.z(), position.z()));
+    highCorner.set(std::max(highCorner.x(), position.x()),
+		   std::max(highCorner.y(), position.y()),
+		   std::max(highCorner.z(), position.z()));
+  }
+  G4ThreeVector halfSize(Scint_rMax, Scint_rMax, Scint_z);
+  G4ThreeVector margin(Envelope_margin, Envelope_margin, Envelope_margin);
+  lowCorner -= halfSize + margin;
+  highCorner += halfSize + margin + G4ThreeVector(0., 0., windowThickness);
+  G4ThreeVector envelopeCentre = 0.5*(lowCorner + highCorner);
+  G4ThreeVector envelopeHalf = 0.5*(highCorner - lowCorner);
+
   ///////////////
   // The World //
   ///////////////
 
-  G4double worldX = 10*cm;
-  G4double worldY = 10*cm;
-  G4double worldZ = 20*cm;
+  // Grown if need be so that the whole array fits
+  G4double worldX = std::max(10*cm, std::abs(envelopeCentre.x()) + envelopeHalf.x());
+  G4double worldY = std::max(10*cm, std::abs(envelopeCentre.y()) + envelopeHalf.y());
+  G4double worldZ = std::max(20*cm, std::abs(envelopeCentre.z()) + envelopeHalf.z());
   
   G4Box *world_S = new G4Box("world_S",worldX,worldY,worldZ);
 
-  G4LogicalVolume *world_L = new G4LogicalVolume(world_S,
+  world_L = new G4LogicalVolume(world_S,
 						 G4MaterialsManager::GetInstance()->GetNISTMaterial("G4_AIR"),
 						 "world_L");
   
@@ -56,18 +209,38 @@ G4VPhysicalVolume *geometryConstruction::Construct()
   world_L->SetVisAttributes(worldVisAtt);
 
   
+  //////////////////
+  // The Envelope //
+  //////////////////
+
+  // An air box around the detectors.  It gives their surroundings
+  // their own region (production cuts) and marks where escaping
+  // neutrons can be killed; neutrons scattered from one detector to
+  // another never leave it, so cross-talk is kept.  In calibration
+  // runs its air has a refractive index, so that the optical surfaces
+  // of the detectors can be modelled
+  G4Box *envelope_S = new G4Box("envelope_S",envelopeHalf.x(),envelopeHalf.y(),envelopeHalf.z());
+
+  G4Material *envelopeMaterial = opticalReadout ? OpticalCopy("RMatrix_OpticalAir", "G4_AIR", 1.0003)
+    : G4MaterialsManager::GetInstance()->GetNISTMaterial("G4_AIR");
+  envelope_L = new G4LogicalVolume(envelope_S, envelopeMaterial, "envelope_L");
+
+  new G4PVPlacement(0,
+		    envelopeCentre,
+		    envelope_L,
+		    "envelope_P",
+		    world_L,
+		    false,
+		    0);
+
+  envelope_L->SetVisAttributes(G4VisAttributes::GetInvisible());
+
   ///////////////
   // The Block //
   ///////////////
   G4double Scint_rMin = 0.*cm;
-  G4double Scint_rMax = 0.5*2.54*cm;
-  G4double Scint_z = 0.5*2.54*cm;
   G4double Scint_sPhi = 0;
   G4double Scint_dPhi = 2*pi;
-
-  G4double Scint_posX = 0.*cm;
-  G4double Scint_posY = 0.*cm;
-  G4double Scint_posZ = -10 *cm;
   
   G4Tubs *block_S = new G4Tubs("block_S",
 		       Scint_rMin,
@@ -83,26 +256,222 @@ G4VPhysicalVolume *geometryConstruction::Construct()
   // Further documentation on how G4MaterialsManager works can be seen in the
   // MaterialsManager header files.
 
-  G4LogicalVolume *block_L = new G4LogicalVolume(block_S,
-						 G4MaterialsManager::GetInstance()->GetOpticalMaterial("EJ301"),
+  block_L = new G4LogicalVolume(block_S,
+						 detectorMaterials[0],
 						 "block_L");
-  
-  G4VPhysicalVolume *block_P = new G4PVPlacement(new G4RotationMatrix(),
-						 G4ThreeVector(0., 0., -10.*cm),
-						 block_L,
-						 "block_P",
-						 world_L,
-						 false,
-						 0);
+
+  // Every detector is a copy of block_L; the copy number is the index
+  // of the detector in the array and picks its position and material
+  std::vector<G4ThreeVector> localPositions;
+  for(const G4ThreeVector &position : positions)
+    localPositions.push_back(position - envelopeCentre);
+
+  delete arrayParameterisation;
+  arrayParameterisation = new detectorArrayParameterisation(localPositions, detectorMaterials);
+
+  G4VPhysicalVolume *block_P = new G4PVParameterised("block_P",
+						     block_L,
+						     envelope_L,
+						     kUndefined,
+						     G4int(positions.size()),
+						     arrayParameterisation);
   
   G4VisAttributes *blockVisAtt = new G4VisAttributes(G4Colour(0., 0., 1., 1.));
   blockVisAtt->SetForceSolid(1);
   block_L->SetVisAttributes(blockVisAtt);
 
+  /////////////////////////
+  // The Readout Windows //
+  /////////////////////////
+
+  // A thin glass disk on the +z face of every detector, where the
+  // photodetector is coupled.  Optical photons that get into it are
+  // the ones the light collection map counts as collected.  Only built
+  // for calibration runs
+  window_L = nullptr;
+  delete windowParameterisation;
+  windowParameterisation = nullptr;
+
+  if(opticalReadout){
+    G4Tubs *window_S = new G4Tubs("window_S",
+				  Scint_rMin,
+				  Scint_rMax,
+				  windowHalfThickness,
+				  Scint_sPhi,
+				  Scint_dPhi);
+
+    G4Material *windowMaterial = OpticalCopy("RMatrix_WindowGlass", "G4_Pyrex_Glass", 1.47);
+    window_L = new G4LogicalVolume(window_S, windowMaterial, "window_L");
+
+    std::vector<G4ThreeVector> windowPositions;
+    for(const G4ThreeVector &position : localPositions)
+      windowPositions.push_back(position + G4ThreeVector(0., 0., Scint_z + windowHalfThickness));
+
+    windowParameterisation = new detectorArrayParameterisation
+      (windowPositions, std::vector<G4Material *>(positions.size(), windowMaterial));
+
+    G4VPhysicalVolume *window_P = new G4PVParameterised("window_P",
+							window_L,
+							envelope_L,
+							kUndefined,
+							G4int(positions.size()),
+							windowParameterisation);
+
+    window_L->SetVisAttributes(new G4VisAttributes(G4Colour(0.7, 0.7, 0.7, 0.5)));
+
+    //////////////////////
+    // Optical Surfaces //
+    //////////////////////
+
+    // The side and back faces are wrapped in a diffuse reflector with an
+    // air gap; the readout face is coupled to the window with optical
+    // grease, i.e. a polished interface between the two refractive
+    // indices.  The border surface takes precedence over the skin
+    G4OpticalSurface *wrapSurface = new G4OpticalSurface("scintWrap", unified, groundbackpainted,
+							 dielectric_dielectric, 0.1);
+    G4MaterialPropertiesTable *wrapMPT = new G4MaterialPropertiesTable();
+    wrapMPT->AddProperty("RINDEX", opticalEnergies, std::vector<G4double>(2, 1.0003));
+    wrapMPT->AddProperty("REFLECTIVITY", opticalEnergies, std::vector<G4double>(2, wrapReflectivity));
+    wrapSurface->SetMaterialPropertiesTable(wrapMPT);
+    new G4LogicalSkinSurface("scintWrap_S", block_L, wrapSurface);
+
+    G4OpticalSurface *couplingSurface = new G4OpticalSurface("readoutCoupling", unified, polished,
+							     dielectric_dielectric);
+    new G4LogicalBorderSurface("readoutCoupling_S", block_P, window_P, couplingSurface);
+  }
+
+  detectorCentres.clear();
+  detectorRadii.clear();
+  for(const G4ThreeVector &position : positions){
+    detectorCentres.push_back(position);
+    detectorRadii.push_back(std::sqrt(Scint_rMax*Scint_rMax + Scint_z*Scint_z));
+  }
+
+  /////////////
+  // Regions //
+  /////////////
+
+  // The scintillator is a daughter of the envelope, so it has to be
+  // declared as a root volume of its own region to keep its own cuts
+  envelopeRegion->AddRootLogicalVolume(envelope_L);
+  scintRegion->AddRootLogicalVolume(block_L);
+
+  G4ProductionCuts *defaultCuts =
+    G4ProductionCutsTable::GetProductionCutsTable()->GetDefaultProductionCuts();
+  envelopeRegion->SetProductionCuts(envelopeCuts ? envelopeCuts : defaultCuts);
+  scintRegion->SetProductionCuts(scintCuts ? scintCuts : defaultCuts);
+
   //G4cout << "ScintMaterial Properties \n" << G4endl;
   //G4Material *ScintMat = block_L->GetMaterial();
   //G4MaterialPropertiesTable *Material_PT =  ScintMat->GetMaterialPropertiesTable();
   //Material_PT->DumpTable();
 
   return world_P;
-}
\ No newline at end of file
+}
+
+
+void geometryConstruction::ConstructSDandField()
+{
+  // Each thread keeps one operator for the whole session and attaches
+  // it again whenever the geometry has been rebuilt
+  static G4ThreadLocal forceCollisionOperator *forceCollision = nullptr;
+  if(!forceCollision)
+    forceCollision = new forceCollisionOperator();
+  forceCollision->AttachTo(block_L);
+
+  // The fast neutron response model belongs to the scintillator
+  // region, which survives geometry rebuilds, so it is only made once
+  static G4ThreadLocal neutronResponseModel *responseModel = nullptr;
+  if(!responseModel)
+    responseModel = new neutronResponseModel(G4RegionStore::GetInstance()->GetRegion("ScintillatorRegion"));
+}
+
+
+void geometryConstruction::SetScintMaterial(G4String name)
+{
+  Scint_material = name;
+  GeometryChanged();
+}
+
+
+void geometryConstruction::SetScintRadius(G4double radius)
+{
+  Scint_rMax = radius;
+  GeometryChanged();
+}
+
+
+void geometryConstruction::SetScintHalfLength(G4double halfLength)
+{
+  Scint_z = halfLength;
+  GeometryChanged();
+}
+
+
+void geometryConstruction::SetScintPositionZ(G4double z)
+{
+  Scint_posZ = z;
+  GeometryChanged();
+}
+
+
+void geometryConstruction::AddDetector(G4ThreeVector position, G4String material)
+{
+  arrayPositions.push_back(position);
+  arrayMaterials.push_back(material == "" ? Scint_material : material);
+  GeometryChanged();
+}
+
+
+void geometryConstruction::ClearDetectors()
+{
+  arrayPositions.clear();
+  arrayMaterials.clear();
+  GeometryChanged();
+}
+
+
+void geometryConstruction::SetEnvelopeMargin(G4double margin)
+{
+  Envelope_margin = margin;
+  GeometryChanged();
+}
+
+
+void geometryConstruction::SetRegionCut(G4String region, G4String particle, G4double cut)
+{
+  G4ProductionCuts *&cuts = (region == "scintillator") ? scintCuts : envelopeCuts;
+
+  // Cuts start out as a copy of the world defaults until the user
+  // overrides them
+  if(!cuts)
+    cuts = new G4ProductionCuts(*G4ProductionCutsTable::GetProductionCutsTable()->GetDefaultProductionCuts());
+
+  if(particle == "all")
+    cuts->SetProductionCut(cut);
+  else
+    cuts->SetProductionCut(cut, particle);
+
+  // Changed cuts are picked up by the run manager at the start of the
+  // next run, so only the region assignment needs to be kept in step
+  G4String regionName = (region == "scintillator") ? "ScintillatorRegion" : "EnvelopeRegion";
+  G4Region *theRegion = G4RegionStore::GetInstance()->GetRegion(regionName, false);
+  if(theRegion)
+    theRegion->SetProductionCuts(cuts);
+}
+
+
+void geometryConstruction::SetForceCollision(G4String onOff)
+{
+  if(onOff == "on") forceCollisionOperator::SetEnabled(true);
+  if(onOff == "off") forceCollisionOperator::SetEnabled(false);
+}
+
+
+void geometryConstruction::GeometryChanged()
+{
+  // Before initialization Construct() will pick up the new values on
+  // its own; afterwards the run manager must be told to rebuild
+  if(G4StateManager::GetStateManager()->GetCurrentState() != G4State_PreInit)
+    G4RunManager::GetRunManager()->ReinitializeGeometry();
+}
@@ -0,0 +1,194 @@
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include "G4UIcommand.hh"
+#include "G4UIparameter.hh"
+#include "G4UnitsTable.hh"
+
+#include <sstream>
+
+#include "geometryConstruction.hh"
+#include "geometryConstructionMessenger.hh"
+
+// geometryConstructionMessenger lets the user resize, move and change
+// the material of the scintillator without recompiling.  Any change
+// made after initialization triggers a rebuild of the geometry before
+// the next run.
+
+geometryConstructionMessenger::geometryConstructionMessenger(geometryConstruction *geometry)
+  : GC(geometry)
+{
+  // The geometry only exists on the master, so none of these commands
+  // are broadcast to the worker threads
+  geometryDir = new G4UIdirectory("/RMatrix/geometry/", false);
+  geometryDir -> SetGuidance("Detector geometry control");
+
+  // Command will let the user choose the scintillator material
+  materialCommand = new G4UIcmdWithAString("/RMatrix/geometry/setMaterial",this);
+  materialCommand -> SetGuidance("Set the scintillator material");
+  materialCommand -> SetParameterName("choice",false);
+  materialCommand -> SetCandidates("EJ301 EJ309 LanthanumBromide");
+  materialCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  materialCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user set the scintillator cylinder radius
+  radiusCommand = new G4UIcmdWithADoubleAndUnit("/RMatrix/geometry/setRadius",this);
+  radiusCommand -> SetGuidance("Set the scintillator radius");
+  radiusCommand -> SetParameterName("radius",false);
+  radiusCommand -> SetRange("radius>0.");
+  radiusCommand -> SetUnitCategory("Length");
+  radiusCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  radiusCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user set the scintillator cylinder half length
+  lengthCommand = new G4UIcmdWithADoubleAndUnit("/RMatrix/geometry/setHalfLength",this);
+  lengthCommand -> SetGuidance("Set the scintillator half length along z");
+  lengthCommand -> SetParameterName("halfLength",false);
+  lengthCommand -> SetRange("halfLength>0.");
+  lengthCommand -> SetUnitCategory("Length");
+  lengthCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  lengthCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user set the scintillator centre along z
+  positionCommand = new G4UIcmdWithADoubleAndUnit("/RMatrix/geometry/setPositionZ",this);
+  positionCommand -> SetGuidance("Set the z position of the scintillator centre");
+  positionCommand -> SetParameterName("z",false);
+  positionCommand -> SetUnitCategory("Length");
+  positionCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  positionCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user size the air envelope around the detector
+  marginCommand = new G4UIcmdWithADoubleAndUnit("/RMatrix/geometry/setEnvelopeMargin",this);
+  marginCommand -> SetGuidance("Set the gap between the scintillator and its envelope");
+  marginCommand -> SetParameterName("margin",false);
+  marginCommand -> SetRange("margin>0.");
+  marginCommand -> SetUnitCategory("Length");
+  marginCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  marginCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user set production cuts per region
+  cutCommand = new G4UIcommand("/RMatrix/geometry/setRegionCut",this);
+  cutCommand -> SetGuidance("Set a production cut in the scintillator or envelope region");
+  cutCommand -> SetGuidance("  region: scintillator or envelope");
+  cutCommand -> SetGuidance("  particle: e-, e+, gamma, proton or all");
+
+  G4UIparameter *regionParam = new G4UIparameter("region",'s',false);
+  regionParam -> SetParameterCandidates("scintillator envelope");
+  cutCommand -> SetParameter(regionParam);
+
+  G4UIparameter *particleParam = new G4UIparameter("particle",'s',false);
+  particleParam -> SetParameterCandidates("e- e+ gamma proton all");
+  cutCommand -> SetParameter(particleParam);
+
+  G4UIparameter *cutParam = new G4UIparameter("cut",'d',false);
+  cutParam -> SetParameterRange("cut>0.");
+  cutCommand -> SetParameter(cutParam);
+
+  G4UIparameter *unitParam = new G4UIparameter("unit",'s',true);
+  unitParam -> SetDefaultUnit("mm");
+  cutCommand -> SetParameter(unitParam);
+
+  cutCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  cutCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user build an array of detectors
+  addDetectorCommand = new G4UIcommand("/RMatrix/geometry/addDetector",this);
+  addDetectorCommand -> SetGuidance("Add a detector to the array at the given centre");
+  addDetectorCommand -> SetGuidance("The first one added replaces the single default detector");
+  addDetectorCommand -> SetGuidance("Detectors may not overlap; this is checked when the geometry is built");
+
+  G4UIparameter *xParam = new G4UIparameter("x",'d',false);
+  addDetectorCommand -> SetParameter(xParam);
+  G4UIparameter *yParam = new G4UIparameter("y",'d',false);
+  addDetectorCommand -> SetParameter(yParam);
+  G4UIparameter *zParam = new G4UIparameter("z",'d',false);
+  addDetectorCommand -> SetParameter(zParam);
+
+  G4UIparameter *positionUnitParam = new G4UIparameter("unit",'s',false);
+  positionUnitParam -> SetDefaultUnit("cm");
+  addDetectorCommand -> SetParameter(positionUnitParam);
+
+  // Left out, the detector takes the current scintillator material
+  G4UIparameter *detectorMaterialParam = new G4UIparameter("material",'s',true);
+  addDetectorCommand -> SetParameter(detectorMaterialParam);
+
+  addDetectorCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  addDetectorCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user go back to the single detector
+  clearDetectorsCommand = new G4UIcommand("/RMatrix/geometry/clearDetectors",this);
+  clearDetectorsCommand -> SetGuidance("Remove all detectors added to the array");
+  clearDetectorsCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  clearDetectorsCommand -> SetToBeBroadcasted(false);
+
+  biasDir = new G4UIdirectory("/RMatrix/bias/", false);
+  biasDir -> SetGuidance("Variance reduction control");
+
+  // Command will let the user force neutron collisions in the scintillator
+  forceCollisionCommand = new G4UIcmdWithAString("/RMatrix/bias/forceCollision",this);
+  forceCollisionCommand -> SetGuidance("Force neutrons entering the scintillator to interact in it");
+  forceCollisionCommand -> SetGuidance("Events are weighted accordingly in the output");
+  forceCollisionCommand -> SetParameterName("choice",true);
+  forceCollisionCommand -> SetDefaultValue("on");
+  forceCollisionCommand -> SetCandidates("on off");
+  forceCollisionCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  forceCollisionCommand -> SetToBeBroadcasted(false);
+}
+
+geometryConstructionMessenger::~geometryConstructionMessenger()
+{
+  delete forceCollisionCommand;
+  delete biasDir;
+  delete clearDetectorsCommand;
+  delete addDetectorCommand;
+  delete cutCommand;
+  delete marginCommand;
+  delete positionCommand;
+  delete lengthCommand;
+  delete radiusCommand;
+  delete materialCommand;
+  delete geometryDir;
+}
+
+
+void geometryConstructionMessenger::SetNewValue(G4UIcommand *command,
+						G4String newValue)
+{
+  if(command == materialCommand)
+    GC -> SetScintMaterial(newValue);
+
+  if(command == radiusCommand)
+    GC -> SetScintRadius(radiusCommand->GetNewDoubleValue(newValue));
+
+  if(command == lengthCommand)
+    GC -> SetScintHalfLength(lengthCommand->GetNewDoubleValue(newValue));
+
+  if(command == positionCommand)
+    GC -> SetScintPositionZ(positionCommand->GetNewDoubleValue(newValue));
+
+  if(command == marginCommand)
+    GC -> SetEnvelopeMargin(marginCommand->GetNewDoubleValue(newValue));
+
+  if(command == cutCommand){
+    std::istringstream is(newValue);
+    G4String region, particle, unit;
+    G4double cut;
+    is >> region >> particle >> cut >> unit;
+    GC -> SetRegionCut(region, particle, cut*G4UIcommand::ValueOf(unit));
+  }
+
+  if(command == addDetectorCommand){
+    std::istringstream is(newValue);
+    G4double x, y, z;
+    G4String unit, material;
+    is >> x >> y >> z >> unit >> material;
+    G4double unitValue = G4UIcommand::ValueOf(unit);
+    GC -> AddDetector(G4ThreeVector(x, y, z)*unitValue, material);
+  }
+
+  if(command == clearDetectorsCommand)
+    GC -> ClearDetectors();
+
+  if(command == forceCollisionCommand)
+    GC -> SetForceCollision(newValue);
+}
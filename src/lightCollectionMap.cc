@@ -0,0 +1,248 @@
+#include "G4SystemOfUnits.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4RunManager.hh"
+#include "G4StateManager.hh"
+
+#include "lightCollectionMap.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+lightCollectionMap::collectionMode lightCollectionMap::mode = lightCollectionMap::collectionOff;
+G4String lightCollectionMap::mapFile = "lightCollection.map";
+lightCollectionMap *lightCollectionMap::loadedMap = nullptr;
+
+G4int lightCollectionMap::mapRBins = 10;
+G4int lightCollectionMap::mapPhiBins = 8;
+G4int lightCollectionMap::mapZBins = 20;
+G4int lightCollectionMap::photonsPerEvent = 100;
+
+lightCollectionMap::lightCollectionMap(const G4String &name)
+  : G4VAccumulable(name),
+    materialName(""),
+    cylinderRadius(1.), cylinderHalfLength(1.),
+    meanProbability(0.)
+{
+  SetBinning(mapRBins, mapPhiBins, mapZBins);
+}
+
+
+lightCollectionMap::~lightCollectionMap()
+{;}
+
+
+void lightCollectionMap::SetBinning(G4int nR, G4int nPhi, G4int nZ)
+{
+  nRBins = nR;
+  nPhiBins = nPhi;
+  nZBins = nZ;
+
+  emitted.assign(nRBins*nPhiBins*nZBins, 0.);
+  collected.assign(nRBins*nPhiBins*nZBins, 0.);
+  probability.clear();
+}
+
+
+void lightCollectionMap::SetCylinder(G4String material, G4double radius, G4double halfLength)
+{
+  materialName = material;
+  cylinderRadius = radius;
+  cylinderHalfLength = halfLength;
+
+  Reset();
+}
+
+
+G4bool lightCollectionMap::Matches(const G4String &material, G4double radius, G4double halfLength) const
+{
+  // The header keeps the dimensions to a micron or so
+  G4double tolerance = 1e-3*mm;
+  return material == materialName
+    and std::abs(radius - cylinderRadius) < tolerance
+    and std::abs(halfLength - cylinderHalfLength) < tolerance;
+}
+
+
+G4int lightCollectionMap::FindVoxel(const G4ThreeVector &localPos) const
+{
+  G4double phi = localPos.phi();
+  if(phi < 0.)
+    phi += twopi;
+
+  G4int rBin = std::min(G4int(localPos.perp()/cylinderRadius*nRBins), nRBins - 1);
+  G4int phiBin = std::min(G4int(phi/twopi*nPhiBins), nPhiBins - 1);
+  G4int zBin = G4int((localPos.z() + cylinderHalfLength)/(2.*cylinderHalfLength)*nZBins);
+  zBin = std::min(std::max(zBin, 0), nZBins - 1);
+
+  return (rBin*nPhiBins + phiBin)*nZBins + zBin;
+}
+
+
+void lightCollectionMap::Fill(const G4ThreeVector &localPos, G4int nEmitted, G4int nCollected)
+{
+  G4int voxel = FindVoxel(localPos);
+  emitted[voxel] += nEmitted;
+  collected[voxel] += nCollected;
+}
+
+
+G4double lightCollectionMap::GetProbability(const G4ThreeVector &localPos) const
+{
+  return probability[FindVoxel(localPos)];
+}
+
+
+void lightCollectionMap::BuildProbabilities()
+{
+  G4double totalEmitted = 0., totalCollected = 0.;
+  for(std::size_t i=0; i<emitted.size(); i++){
+    totalEmitted += emitted[i];
+    totalCollected += collected[i];
+  }
+  meanProbability = (totalEmitted > 0.) ? totalCollected/totalEmitted : 0.;
+
+  // Voxels the calibration never reached fall back on the mean
+  probability.resize(emitted.size());
+  for(std::size_t i=0; i<emitted.size(); i++)
+    probability[i] = (emitted[i] > 0.) ? collected[i]/emitted[i] : meanProbability;
+}
+
+
+G4bool lightCollectionMap::Write(const G4String &fileName) const
+{
+  std::ofstream output(fileName, std::ofstream::trunc);
+  if(!output.is_open())
+    return false;
+
+  output << "# lightCollectionMap" << std::endl
+	 << "material " << materialName << std::endl
+	 << "cylinder " << cylinderRadius/mm << " " << cylinderHalfLength/mm << std::endl
+	 << "bins " << nRBins << " " << nPhiBins << " " << nZBins << std::endl;
+
+  // One "<emitted> <collected>" line per voxel, z fastest, then phi, then r
+  for(std::size_t i=0; i<emitted.size(); i++)
+    output << emitted[i] << " " << collected[i] << std::endl;
+
+  return true;
+}
+
+
+G4bool lightCollectionMap::Read(const G4String &fileName)
+{
+  std::ifstream input(fileName);
+  if(!input.is_open())
+    return false;
+
+  std::string line;
+  std::getline(input, line);
+  if(line != "# lightCollectionMap")
+    return false;
+
+  G4String key, material;
+  G4double radius = 0., halfLength = 0.;
+  G4int nR = 0, nPhi = 0, nZ = 0;
+  input >> key >> material
+	>> key >> radius >> halfLength
+	>> key >> nR >> nPhi >> nZ;
+  if(!input or radius <= 0. or halfLength <= 0. or nR <= 0 or nPhi <= 0 or nZ <= 0)
+    return false;
+
+  SetBinning(nR, nPhi, nZ);
+  SetCylinder(material, radius*mm, halfLength*mm);
+
+  for(std::size_t i=0; i<emitted.size(); i++)
+    if(!(input >> emitted[i] >> collected[i]))
+      return false;
+
+  BuildProbabilities();
+  return true;
+}
+
+
+void lightCollectionMap::Merge(const G4VAccumulable &other)
+{
+  const lightCollectionMap &otherMap = static_cast<const lightCollectionMap &>(other);
+  if(otherMap.emitted.size() != emitted.size())
+    return;
+
+  for(std::size_t i=0; i<emitted.size(); i++){
+    emitted[i] += otherMap.emitted[i];
+    collected[i] += otherMap.collected[i];
+  }
+}
+
+
+void lightCollectionMap::Reset()
+{
+  std::fill(emitted.begin(), emitted.end(), 0.);
+  std::fill(collected.begin(), collected.end(), 0.);
+}
+
+
+void lightCollectionMap::SetMode(G4String newMode)
+{
+  collectionMode oldMode = mode;
+  if(newMode == "off") mode = collectionOff;
+  if(newMode == "calibrate") mode = collectionCalibrate;
+  if(newMode == "apply") mode = collectionApply;
+
+  if(mode == collectionApply)
+    LoadMap();
+
+  // The readout windows are only part of the geometry in calibration
+  // runs (geometryConstruction)
+  if((oldMode == collectionCalibrate) != (mode == collectionCalibrate)
+     and G4StateManager::GetStateManager()->GetCurrentState() != G4State_PreInit)
+    G4RunManager::GetRunManager()->ReinitializeGeometry();
+}
+
+
+void lightCollectionMap::SetMapFile(G4String fileName)
+{
+  mapFile = fileName;
+
+  if(mode == collectionApply)
+    LoadMap();
+}
+
+
+void lightCollectionMap::SetMapBinning(G4int nR, G4int nPhi, G4int nZ)
+{
+  mapRBins = nR;
+  mapPhiBins = nPhi;
+  mapZBins = nZ;
+}
+
+
+void lightCollectionMap::ConfigureMap(lightCollectionMap &calibrationMap)
+{
+  calibrationMap.SetBinning(mapRBins, mapPhiBins, mapZBins);
+}
+
+
+void lightCollectionMap::LoadMap()
+{
+  // Only called between runs, so no worker is reading the old map
+  delete loadedMap;
+  loadedMap = new lightCollectionMap("loadedCollectionMap");
+
+  if(!loadedMap->Read(mapFile)){
+    delete loadedMap;
+    loadedMap = nullptr;
+    mode = collectionOff;
+
+    G4ExceptionDescription description;
+    description << "Could not read the light collection map " << mapFile
+		<< ", only created photons will be counted";
+    G4Exception("lightCollectionMap::LoadMap()",
+		"lightCollectionMap-001",
+		JustWarning,
+		description);
+    return;
+  }
+
+  G4cout << " Light collection map for " << loadedMap->materialName
+	 << " read from " << mapFile << ", mean collection probability "
+	 << loadedMap->GetMeanProbability() << G4endl;
+}
@@ -0,0 +1,94 @@
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4UIcommand.hh"
+#include "G4UIparameter.hh"
+
+#include <sstream>
+
+#include "lightCollectionMap.hh"
+#include "lightCollectionMapMessenger.hh"
+
+// lightCollectionMapMessenger lets the user build the light collection
+// map of a scintillator once and reuse it in production runs.
+
+lightCollectionMapMessenger::lightCollectionMapMessenger()
+{
+  mapDir = new G4UIdirectory("/RMatrix/lightMap/", false);
+  mapDir -> SetGuidance("Light collection map of the scintillator");
+
+  // Command will let the user choose what is done with the map
+  modeCommand = new G4UIcmdWithAString("/RMatrix/lightMap/mode",this);
+  modeCommand -> SetGuidance("off: count created photons only");
+  modeCommand -> SetGuidance("calibrate: emit optical photons in the scintillator and write the map");
+  modeCommand -> SetGuidance("  (needs full optical transport, i.e. the QGSP_BIC_HP physics list)");
+  modeCommand -> SetGuidance("apply: read the map and output collected photons");
+  modeCommand -> SetParameterName("mode",false);
+  modeCommand -> SetCandidates("off calibrate apply");
+  modeCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  modeCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user name the map file
+  fileCommand = new G4UIcmdWithAString("/RMatrix/lightMap/setMapFile",this);
+  fileCommand -> SetGuidance("Set the file the map is written to and read from");
+  fileCommand -> SetParameterName("fileName",false);
+  fileCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  fileCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user set the voxels of a new map
+  binningCommand = new G4UIcommand("/RMatrix/lightMap/setBinning",this);
+  binningCommand -> SetGuidance("Set the number of r, phi and z voxels of the calibration map");
+
+  G4UIparameter *rParam = new G4UIparameter("nR",'i',false);
+  rParam -> SetParameterRange("nR>0");
+  binningCommand -> SetParameter(rParam);
+
+  G4UIparameter *phiParam = new G4UIparameter("nPhi",'i',false);
+  phiParam -> SetParameterRange("nPhi>0");
+  binningCommand -> SetParameter(phiParam);
+
+  G4UIparameter *zParam = new G4UIparameter("nZ",'i',false);
+  zParam -> SetParameterRange("nZ>0");
+  binningCommand -> SetParameter(zParam);
+
+  binningCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  binningCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user set how many photons a calibration event emits
+  photonsCommand = new G4UIcmdWithAnInteger("/RMatrix/lightMap/setPhotonsPerEvent",this);
+  photonsCommand -> SetGuidance("Set the number of photons emitted from each calibration point");
+  photonsCommand -> SetParameterName("nPhotons",false);
+  photonsCommand -> SetRange("nPhotons>0");
+  photonsCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  photonsCommand -> SetToBeBroadcasted(false);
+}
+
+lightCollectionMapMessenger::~lightCollectionMapMessenger()
+{
+  delete photonsCommand;
+  delete binningCommand;
+  delete fileCommand;
+  delete modeCommand;
+  delete mapDir;
+}
+
+
+void lightCollectionMapMessenger::SetNewValue(G4UIcommand *command,
+					      G4String newValue)
+{
+  if(command == modeCommand)
+    lightCollectionMap::SetMode(newValue);
+
+  if(command == fileCommand)
+    lightCollectionMap::SetMapFile(newValue);
+
+  if(command == binningCommand){
+    std::istringstream is(newValue);
+    G4int nR, nPhi, nZ;
+    is >> nR >> nPhi >> nZ;
+    lightCollectionMap::SetMapBinning(nR, nPhi, nZ);
+  }
+
+  if(command == photonsCommand)
+    lightCollectionMap::SetPhotonsPerEvent(photonsCommand->GetNewIntValue(newValue));
+}
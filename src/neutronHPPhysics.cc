@@ -0,0 +1,43 @@
+#include "G4Neutron.hh"
+#include "G4HadronInelasticProcess.hh"
+#include "G4NeutronCaptureProcess.hh"
+#include "G4ParticleHPInelastic.hh"
+#include "G4ParticleHPInelasticData.hh"
+#include "G4ParticleHPCapture.hh"
+#include "G4ParticleHPCaptureData.hh"
+#include "G4PhysicsListHelper.hh"
+
+#include "neutronHPPhysics.hh"
+
+neutronHPPhysics::neutronHPPhysics(const G4String &name)
+  : G4VPhysicsConstructor(name)
+{;}
+
+
+neutronHPPhysics::~neutronHPPhysics()
+{;}
+
+
+void neutronHPPhysics::ConstructParticle()
+{
+  G4Neutron::NeutronDefinition();
+}
+
+
+void neutronHPPhysics::ConstructProcess()
+{
+  G4PhysicsListHelper *helper = G4PhysicsListHelper::GetPhysicsListHelper();
+  G4ParticleDefinition *neutron = G4Neutron::Neutron();
+
+  // Inelastic reactions, e.g. 12C(n,a) and 12C(n,n'3a)
+  G4HadronInelasticProcess *inelastic = new G4HadronInelasticProcess("neutronInelastic", neutron);
+  inelastic->AddDataSet(new G4ParticleHPInelasticData());
+  inelastic->RegisterMe(new G4ParticleHPInelastic());
+  helper->RegisterProcess(inelastic, neutron);
+
+  // Radiative capture, mostly on hydrogen once the neutron has thermalised
+  G4NeutronCaptureProcess *capture = new G4NeutronCaptureProcess();
+  capture->AddDataSet(new G4ParticleHPCaptureData());
+  capture->RegisterMe(new G4ParticleHPCapture());
+  helper->RegisterProcess(capture, neutron);
+}
@@ -0,0 +1,193 @@
+#include "G4Region.hh"
+#include "G4Neutron.hh"
+#include "G4Tubs.hh"
+#include "G4EventManager.hh"
+#include "G4VTouchable.hh"
+#include "G4SystemOfUnits.hh"
+
+#include "neutronResponseModel.hh"
+#include "neutronResponseTable.hh"
+#include "eventAction.hh"
+#include "lightCollectionMap.hh"
+#include "Randomize.hh"
+
+neutronResponseModel::responseMode neutronResponseModel::mode = neutronResponseModel::responseOff;
+G4String neutronResponseModel::tableFile = "neutronResponse.table";
+neutronResponseTable *neutronResponseModel::table = nullptr;
+G4bool neutronResponseModel::physicsBuilt = false;
+G4bool neutronResponseModel::fastSimulationPhysics = false;
+
+G4int neutronResponseModel::nEnergyBins = 50;
+G4double neutronResponseModel::energyMin = 0.;
+G4double neutronResponseModel::energyMax = 10.*MeV;
+G4int neutronResponseModel::nPositionBins = 4;
+G4int neutronResponseModel::nDirectionBins = 4;
+G4int neutronResponseModel::nLightBins = 100;
+G4double neutronResponseModel::lightMax = 50000.;
+
+neutronResponseModel::neutronResponseModel(G4Region *scintRegion)
+  : G4VFastSimulationModel("neutronResponseModel", scintRegion),
+    triggeredCell(-1)
+{;}
+
+
+neutronResponseModel::~neutronResponseModel()
+{;}
+
+
+G4bool neutronResponseModel::IsApplicable(const G4ParticleDefinition &particle)
+{
+  return &particle == G4Neutron::NeutronDefinition();
+}
+
+
+G4bool neutronResponseModel::ModelTrigger(const G4FastTrack &fastTrack)
+{
+  if(mode != responseFast or table == nullptr)
+    return false;
+
+  // The table was trained on the primary neutron's first entry only,
+  // so secondary neutrons and re-entries are left to full transport
+  if(fastTrack.GetPrimaryTrack()->GetParentID() != 0)
+    return false;
+
+  // Only take over neutrons as they come in through the surface; the
+  // table describes the whole history from the entry point on
+  const G4VSolid *solid = fastTrack.GetEnvelopeSolid();
+  const G4ThreeVector &localPos = fastTrack.GetPrimaryTrackLocalPosition();
+  const G4ThreeVector &localDir = fastTrack.GetPrimaryTrackLocalDirection();
+  if(solid->Inside(localPos) != kSurface or solid->SurfaceNormal(localPos).dot(localDir) >= 0.)
+    return false;
+
+  eventAction *evtAction = static_cast<eventAction *>
+    (G4EventManager::GetEventManager()->GetUserEventAction());
+  if(!evtAction->FirstPrimaryEntry())
+    return false;
+
+  const G4Tubs *cylinder = dynamic_cast<const G4Tubs *>(solid);
+  if(cylinder == nullptr)
+    return false;
+
+  G4double energy = fastTrack.GetPrimaryTrack()->GetKineticEnergy();
+  triggeredCell = table->FindCell(energy, localPos, localDir,
+				  cylinder->GetOuterRadius(), cylinder->GetZHalfLength());
+
+  // Cells without training data are left to full transport
+  return triggeredCell >= 0 and !table->IsEmpty(triggeredCell);
+}
+
+
+void neutronResponseModel::DoIt(const G4FastTrack &fastTrack, G4FastStep &fastStep)
+{
+  G4int species;
+  G4int nPhotons = G4int(table->Sample(triggeredCell, species) + 0.5);
+
+  if(nPhotons > 0){
+    eventAction *evtAction = static_cast<eventAction *>
+      (G4EventManager::GetEventManager()->GetUserEventAction());
+    const G4Track *track = fastTrack.GetPrimaryTrack();
+    G4int detector = track->GetTouchable()->GetCopyNumber();
+    G4int origin = evtAction->GetTrackOrigin(track->GetTrackID());
+    evtAction->AddPhotonCreated(nPhotons, track->GetWeight(), detector, origin);
+
+    // Where the light was made is not known, so it is collected with
+    // the map's mean probability
+    const lightCollectionMap *map = lightCollectionMap::GetMap();
+    if(map and lightCollectionMap::GetMode() == lightCollectionMap::collectionApply){
+      G4int nCollected = G4int(CLHEP::RandBinomial::shoot(nPhotons, map->GetMeanProbability()));
+      if(nCollected > 0)
+	evtAction->AddPhotonCollected(nCollected, track->GetWeight(), detector, origin);
+    }
+  }
+
+  fastStep.KillPrimaryTrack();
+  fastStep.ProposePrimaryTrackPathLength(0.);
+}
+
+
+void neutronResponseModel::SetMode(G4String newMode)
+{
+  if(newMode == "off") mode = responseOff;
+  if(newMode == "train") mode = responseTrain;
+  if(newMode == "fast") mode = responseFast;
+  if(newMode == "compare") mode = responseCompare;
+
+  // Without fast simulation in the physics list the model is never
+  // asked, and the run would silently be full transport
+  if(mode == responseFast and physicsBuilt and !fastSimulationPhysics){
+    mode = responseOff;
+    G4Exception("neutronResponseModel::SetMode()",
+		"neutronResponseModel-002",
+		JustWarning,
+		"Fast mode has to be chosen before the physics list is built (RMatrixGen --fast-response), keeping full transport");
+    return;
+  }
+
+  if(mode == responseFast or mode == responseCompare)
+    LoadTable();
+}
+
+
+void neutronResponseModel::SetTableFile(G4String fileName)
+{
+  tableFile = fileName;
+
+  if(mode == responseFast or mode == responseCompare)
+    LoadTable();
+}
+
+
+void neutronResponseModel::SetEnergyBinning(G4int nBins, G4double eMin, G4double eMax)
+{
+  nEnergyBins = nBins;
+  energyMin = eMin;
+  energyMax = eMax;
+}
+
+
+void neutronResponseModel::SetEntryBinning(G4int nPosition, G4int nDirection)
+{
+  nPositionBins = nPosition;
+  nDirectionBins = nDirection;
+}
+
+
+void neutronResponseModel::SetLightBinning(G4int nBins, G4double lMax)
+{
+  nLightBins = nBins;
+  lightMax = lMax;
+}
+
+
+void neutronResponseModel::ConfigureTable(neutronResponseTable &trainingTable)
+{
+  trainingTable.SetBinning(nEnergyBins, energyMin, energyMax,
+			   nPositionBins, nDirectionBins,
+			   nLightBins, lightMax);
+}
+
+
+void neutronResponseModel::LoadTable()
+{
+  // Only called between runs, so no worker is reading the old table
+  delete table;
+  table = new neutronResponseTable("loadedResponseTable");
+
+  if(!table->Read(tableFile)){
+    delete table;
+    table = nullptr;
+    mode = responseOff;
+
+    G4ExceptionDescription description;
+    description << "Could not read the neutron response table " << tableFile
+		<< ", falling back on full transport";
+    G4Exception("neutronResponseModel::LoadTable()",
+		"neutronResponseModel-001",
+		JustWarning,
+		description);
+    return;
+  }
+
+  G4cout << " Neutron response table for " << table->GetMaterialName()
+	 << " read from " << tableFile << G4endl;
+}
@@ -0,0 +1,136 @@
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcommand.hh"
+#include "G4UIparameter.hh"
+
+#include <sstream>
+
+#include "neutronResponseModel.hh"
+#include "neutronResponseModelMessenger.hh"
+
+// neutronResponseModelMessenger lets the user train, use and check the
+// parameterised neutron response without recompiling.
+
+neutronResponseModelMessenger::neutronResponseModelMessenger()
+{
+  responseDir = new G4UIdirectory("/RMatrix/fastResponse/", false);
+  responseDir -> SetGuidance("Parameterised neutron response in the scintillator");
+
+  // Command will let the user choose what the model does
+  modeCommand = new G4UIcmdWithAString("/RMatrix/fastResponse/mode",this);
+  modeCommand -> SetGuidance("off: full transport");
+  modeCommand -> SetGuidance("train: full transport, write the response table at end of run");
+  modeCommand -> SetGuidance("fast: read the table and use it instead of transport");
+  modeCommand -> SetGuidance("      (only once the physics list was built for it: RMatrixGen --fast-response)");
+  modeCommand -> SetGuidance("compare: full transport, report the difference to the table");
+  modeCommand -> SetParameterName("mode",false);
+  modeCommand -> SetCandidates("off train fast compare");
+  modeCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  modeCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user name the table file
+  fileCommand = new G4UIcmdWithAString("/RMatrix/fastResponse/setTableFile",this);
+  fileCommand -> SetGuidance("Set the file the response table is written to and read from");
+  fileCommand -> SetParameterName("fileName",false);
+  fileCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  fileCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user set the incident energy bins of training
+  energyCommand = new G4UIcommand("/RMatrix/fastResponse/setEnergyBinning",this);
+  energyCommand -> SetGuidance("Set the incident energy bins of the training table");
+
+  G4UIparameter *nEnergyParam = new G4UIparameter("nBins",'i',false);
+  nEnergyParam -> SetParameterRange("nBins>0");
+  energyCommand -> SetParameter(nEnergyParam);
+
+  G4UIparameter *eMinParam = new G4UIparameter("eMin",'d',false);
+  eMinParam -> SetParameterRange("eMin>=0.");
+  energyCommand -> SetParameter(eMinParam);
+
+  G4UIparameter *eMaxParam = new G4UIparameter("eMax",'d',false);
+  eMaxParam -> SetParameterRange("eMax>0.");
+  energyCommand -> SetParameter(eMaxParam);
+
+  G4UIparameter *unitParam = new G4UIparameter("unit",'s',true);
+  unitParam -> SetDefaultUnit("MeV");
+  energyCommand -> SetParameter(unitParam);
+
+  energyCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  energyCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user set the entry point and direction bins
+  entryCommand = new G4UIcommand("/RMatrix/fastResponse/setEntryBinning",this);
+  entryCommand -> SetGuidance("Set the entry position bins (per face) and direction cosine bins");
+
+  G4UIparameter *nPositionParam = new G4UIparameter("nPosition",'i',false);
+  nPositionParam -> SetParameterRange("nPosition>0");
+  entryCommand -> SetParameter(nPositionParam);
+
+  G4UIparameter *nDirectionParam = new G4UIparameter("nDirection",'i',false);
+  nDirectionParam -> SetParameterRange("nDirection>0");
+  entryCommand -> SetParameter(nDirectionParam);
+
+  entryCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  entryCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user set the light bins
+  lightCommand = new G4UIcommand("/RMatrix/fastResponse/setLightBinning",this);
+  lightCommand -> SetGuidance("Set the number of light bins and the photon count of the last one");
+
+  G4UIparameter *nLightParam = new G4UIparameter("nBins",'i',false);
+  nLightParam -> SetParameterRange("nBins>0");
+  lightCommand -> SetParameter(nLightParam);
+
+  G4UIparameter *lightMaxParam = new G4UIparameter("lightMax",'d',false);
+  lightMaxParam -> SetParameterRange("lightMax>0.");
+  lightCommand -> SetParameter(lightMaxParam);
+
+  lightCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  lightCommand -> SetToBeBroadcasted(false);
+}
+
+neutronResponseModelMessenger::~neutronResponseModelMessenger()
+{
+  delete lightCommand;
+  delete entryCommand;
+  delete energyCommand;
+  delete fileCommand;
+  delete modeCommand;
+  delete responseDir;
+}
+
+
+void neutronResponseModelMessenger::SetNewValue(G4UIcommand *command,
+						G4String newValue)
+{
+  if(command == modeCommand)
+    neutronResponseModel::SetMode(newValue);
+
+  if(command == fileCommand)
+    neutronResponseModel::SetTableFile(newValue);
+
+  if(command == energyCommand){
+    std::istringstream is(newValue);
+    G4int nBins;
+    G4double eMin, eMax;
+    G4String unit;
+    is >> nBins >> eMin >> eMax >> unit;
+    G4double unitValue = G4UIcommand::ValueOf(unit);
+    neutronResponseModel::SetEnergyBinning(nBins, eMin*unitValue, eMax*unitValue);
+  }
+
+  if(command == entryCommand){
+    std::istringstream is(newValue);
+    G4int nPosition, nDirection;
+    is >> nPosition >> nDirection;
+    neutronResponseModel::SetEntryBinning(nPosition, nDirection);
+  }
+
+  if(command == lightCommand){
+    std::istringstream is(newValue);
+    G4int nBins;
+    G4double lightMax;
+    is >> nBins >> lightMax;
+    neutronResponseModel::SetLightBinning(nBins, lightMax);
+  }
+}
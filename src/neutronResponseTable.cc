@@ -0,0 +1,258 @@
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+
+#include "neutronResponseTable.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+neutronResponseTable::neutronResponseTable(const G4String &name)
+  : G4VAccumulable(name),
+    materialName(""),
+    cylinderRadius(1.), cylinderHalfLength(1.)
+{
+  SetBinning(50, 0., 10.*MeV, 4, 4, 100, 50000.);
+}
+
+
+neutronResponseTable::~neutronResponseTable()
+{;}
+
+
+void neutronResponseTable::SetBinning(G4int nEnergy, G4double eMin, G4double eMax,
+				      G4int nPosition, G4int nDirection,
+				      G4int nLight, G4double lMax)
+{
+  nEnergyBins = nEnergy;
+  energyMin = eMin;
+  energyMax = eMax;
+  nPositionBins = nPosition;
+  nDirectionBins = nDirection;
+  nLightBins = nLight;
+  lightMax = lMax;
+  nCells = nEnergyBins*3*nPositionBins*nDirectionBins;
+
+  counts.clear();
+  cellSums.clear();
+  cumulative.clear();
+}
+
+
+void neutronResponseTable::SetCylinder(G4String material, G4double radius, G4double halfLength)
+{
+  materialName = material;
+  cylinderRadius = radius;
+  cylinderHalfLength = halfLength;
+}
+
+
+G4bool neutronResponseTable::Matches(const G4String &material, G4double radius, G4double halfLength) const
+{
+  // The header keeps the dimensions to a micron or so
+  G4double tolerance = 1e-3*mm;
+  return material == materialName
+    and std::abs(radius - cylinderRadius) < tolerance
+    and std::abs(halfLength - cylinderHalfLength) < tolerance;
+}
+
+
+G4int neutronResponseTable::FindCell(G4double energy,
+				     const G4ThreeVector &localPos, const G4ThreeVector &localDir,
+				     G4double radius, G4double halfLength) const
+{
+  if(energy < energyMin or energy >= energyMax)
+    return -1;
+  G4int energyBin = G4int((energy - energyMin)/(energyMax - energyMin)*nEnergyBins);
+
+  // Work out the face from whichever surface the point is closest to
+  G4double r = localPos.perp();
+  G4double capDistance = halfLength - std::abs(localPos.z());
+  G4double sideDistance = radius - r;
+
+  G4int face;
+  G4double position, cosine;
+  if(capDistance < sideDistance){
+    face = (localPos.z() < 0.) ? 0 : 2;
+    position = r/radius;
+    cosine = (face == 0) ? localDir.z() : -localDir.z();
+  }
+  else{
+    face = 1;
+    position = (localPos.z() + halfLength)/(2.*halfLength);
+    cosine = (r > 0.) ? -(localPos.x()*localDir.x() + localPos.y()*localDir.y())/r : 1.;
+  }
+
+  G4int positionBin = std::min(std::max(G4int(position*nPositionBins), 0), nPositionBins - 1);
+  G4int directionBin = std::min(std::max(G4int(cosine*nDirectionBins), 0), nDirectionBins - 1);
+
+  return ((energyBin*3 + face)*nPositionBins + positionBin)*nDirectionBins + directionBin;
+}
+
+
+void neutronResponseTable::Fill(G4int cell, G4int species, G4double light, G4double weight)
+{
+  if(cell < 0 or cell >= nCells)
+    return;
+
+  if(counts.empty()){
+    counts.assign(std::size_t(nCells)*nSpecies*nLightBins, 0.);
+    cellSums.assign(nCells, 0.);
+  }
+
+  if(light <= 0.)
+    species = noRecoil;
+  G4int lightBin = std::min(G4int(light/lightMax*nLightBins), nLightBins - 1);
+
+  counts[(std::size_t(cell)*nSpecies + species)*nLightBins + lightBin] += weight;
+  cellSums[cell] += weight;
+}
+
+
+void neutronResponseTable::BuildSamplingTables()
+{
+  cumulative.assign(counts.size(), 0.);
+
+  std::size_t cellSize = std::size_t(nSpecies)*nLightBins;
+  for(G4int cell=0; cell<G4int(cellSums.size()); cell++){
+    if(cellSums[cell] <= 0.)
+      continue;
+    G4double sum = 0.;
+    for(std::size_t k=0; k<cellSize; k++){
+      sum += counts[cell*cellSize + k];
+      cumulative[cell*cellSize + k] = sum/cellSums[cell];
+    }
+  }
+}
+
+
+G4double neutronResponseTable::Sample(G4int cell, G4int &species) const
+{
+  std::size_t cellSize = std::size_t(nSpecies)*nLightBins;
+  auto first = cumulative.begin() + cell*cellSize;
+  auto last = first + cellSize;
+
+  G4int k = std::min(G4int(std::upper_bound(first, last, G4UniformRand()) - first),
+		     G4int(cellSize) - 1);
+  species = k/nLightBins;
+  if(species == noRecoil)
+    return 0.;
+
+  // Uniform within the light bin
+  G4double lightWidth = lightMax/nLightBins;
+  return (k%nLightBins + G4UniformRand())*lightWidth;
+}
+
+
+G4bool neutronResponseTable::Write(const G4String &fileName) const
+{
+  std::ofstream output(fileName, std::ofstream::trunc);
+  if(!output.is_open())
+    return false;
+
+  output << "# neutronResponseTable" << std::endl
+	 << "material " << materialName << std::endl
+	 << "cylinder " << cylinderRadius/mm << " " << cylinderHalfLength/mm << std::endl
+	 << "energy " << nEnergyBins << " " << energyMin/MeV << " " << energyMax/MeV << std::endl
+	 << "position " << nPositionBins << std::endl
+	 << "direction " << nDirectionBins << std::endl
+	 << "light " << nLightBins << " " << lightMax << std::endl;
+
+  // Cells are sparse: "<cell> <pairs> <index> <count> ..."
+  std::size_t cellSize = std::size_t(nSpecies)*nLightBins;
+  for(G4int cell=0; cell<G4int(cellSums.size()); cell++){
+    if(cellSums[cell] <= 0.)
+      continue;
+    std::ostringstream line;
+    G4int nPairs = 0;
+    for(std::size_t k=0; k<cellSize; k++){
+      G4double value = counts[cell*cellSize + k];
+      if(value == 0.)
+	continue;
+      line << " " << k << " " << value;
+      nPairs++;
+    }
+    output << cell << " " << nPairs << line.str() << std::endl;
+  }
+
+  return true;
+}
+
+
+G4bool neutronResponseTable::Read(const G4String &fileName)
+{
+  std::ifstream input(fileName);
+  if(!input.is_open())
+    return false;
+
+  G4String key, material;
+  G4int nEnergy = 0, nPosition = 0, nDirection = 0, nLight = 0;
+  G4double radius = 0., halfLength = 0.;
+  G4double eMin = 0., eMax = 0., lMax = 0.;
+
+  std::string line;
+  std::getline(input, line);
+  if(line != "# neutronResponseTable")
+    return false;
+  input >> key >> material
+	>> key >> radius >> halfLength
+	>> key >> nEnergy >> eMin >> eMax
+	>> key >> nPosition
+	>> key >> nDirection
+	>> key >> nLight >> lMax;
+  if(!input or radius <= 0. or halfLength <= 0.
+     or nEnergy <= 0 or nPosition <= 0 or nDirection <= 0 or nLight <= 0)
+    return false;
+
+  SetBinning(nEnergy, eMin*MeV, eMax*MeV, nPosition, nDirection, nLight, lMax);
+  SetCylinder(material, radius*mm, halfLength*mm);
+  counts.assign(std::size_t(nCells)*nSpecies*nLightBins, 0.);
+  cellSums.assign(nCells, 0.);
+
+  std::size_t cellSize = std::size_t(nSpecies)*nLightBins;
+  G4int cell, nPairs;
+  while(input >> cell >> nPairs){
+    if(cell < 0 or cell >= nCells)
+      return false;
+    for(G4int p=0; p<nPairs; p++){
+      std::size_t k;
+      G4double value;
+      if(!(input >> k >> value) or k >= cellSize)
+	return false;
+      counts[cell*cellSize + k] = value;
+      cellSums[cell] += value;
+    }
+  }
+
+  BuildSamplingTables();
+  return true;
+}
+
+
+void neutronResponseTable::Merge(const G4VAccumulable &other)
+{
+  const neutronResponseTable &otherTable = static_cast<const neutronResponseTable &>(other);
+  if(otherTable.counts.empty())
+    return;
+
+  if(counts.empty()){
+    counts = otherTable.counts;
+    cellSums = otherTable.cellSums;
+    return;
+  }
+
+  if(otherTable.counts.size() != counts.size())
+    return;
+  for(std::size_t i=0; i<counts.size(); i++)
+    counts[i] += otherTable.counts[i];
+  for(std::size_t i=0; i<cellSums.size(); i++)
+    cellSums[i] += otherTable.cellSums[i];
+}
+
+
+void neutronResponseTable::Reset()
+{
+  std::fill(counts.begin(), counts.end(), 0.);
+  std::fill(cellSums.begin(), cellSums.end(), 0.);
+}
@@ -0,0 +1,209 @@
+#include "G4Threading.hh"
+#include "G4ios.hh"
+
+#include "progressMonitor.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+
+G4double progressMonitor::interval = 0.;
+G4String progressMonitor::metricsFile = "";
+
+std::unique_ptr<progressMonitor::threadSlot[]> progressMonitor::slots;
+G4int progressMonitor::nSlots = 0;
+G4long progressMonitor::eventsToProcess = 0;
+
+std::chrono::steady_clock::time_point progressMonitor::startTime;
+std::atomic<G4long> progressMonitor::nextReport(0);
+
+std::mutex progressMonitor::reportMutex;
+G4long progressMonitor::lastReportClock = 0;
+G4long progressMonitor::lastReportPhotons = 0;
+
+void progressMonitor::StartRun(G4long nEventsToProcess, G4int nThreads)
+{
+  nSlots = std::max(nThreads, 1);
+  slots.reset(new threadSlot[nSlots]);
+  for(G4int i=0; i<nSlots; i++){
+    slots[i].events = 0;
+    slots[i].photons = 0;
+    slots[i].litEvents = 0;
+    slots[i].reportedEvents = 0;
+  }
+  eventsToProcess = nEventsToProcess;
+
+  startTime = std::chrono::steady_clock::now();
+  nextReport = G4long(interval*1e9);
+  lastReportClock = 0;
+  lastReportPhotons = 0;
+}
+
+
+void progressMonitor::EndRun()
+{
+  if(interval <= 0. or nSlots == 0)
+    return;
+
+  // No worker is left to report by now
+  nextReport = std::numeric_limits<G4long>::max();
+  Report(true);
+}
+
+
+G4long progressMonitor::GetEventsDone()
+{
+  G4long events = 0;
+  for(G4int i=0; i<nSlots; i++)
+    events += slots[i].events.load(std::memory_order_relaxed);
+  return events;
+}
+
+
+G4long progressMonitor::GetPhotons()
+{
+  G4long photons = 0;
+  for(G4int i=0; i<nSlots; i++)
+    photons += slots[i].photons.load(std::memory_order_relaxed);
+  return photons;
+}
+
+
+G4int progressMonitor::SlotIndex()
+{
+  // The master (or the only thread of a sequential run) has id -1
+  G4int id = G4Threading::G4GetThreadId();
+  return (id < 0) ? 0 : id % nSlots;
+}
+
+
+void progressMonitor::Report(G4bool endOfRun)
+{
+  // A report still being written when the next one falls due wins
+  std::unique_lock<std::mutex> lock(reportMutex, std::try_to_lock);
+  if(!lock.owns_lock())
+    return;
+
+  G4long clock = Clock();
+  G4double elapsed = clock*1e-9;
+  G4double sinceLast = std::max((clock - lastReportClock)*1e-9, 1e-9);
+
+  G4long events = 0, photons = 0, litEvents = 0;
+  std::vector<G4double> threadRates(nSlots);
+  for(G4int i=0; i<nSlots; i++){
+    G4long threadEvents = slots[i].events.load(std::memory_order_relaxed);
+    events += threadEvents;
+    photons += slots[i].photons.load(std::memory_order_relaxed);
+    litEvents += slots[i].litEvents.load(std::memory_order_relaxed);
+    threadRates[i] = (threadEvents - slots[i].reportedEvents)/sinceLast;
+    slots[i].reportedEvents = threadEvents;
+  }
+
+  G4double eventRate = 0.;
+  for(G4double rate : threadRates)
+    eventRate += rate;
+  G4double photonRate = (photons - lastReportPhotons)/sinceLast;
+  G4double litFraction = (events > 0) ? G4double(litEvents)/events : 0.;
+
+  // The time left is estimated from the mean rate of the whole run
+  G4double meanRate = (elapsed > 0.) ? events/elapsed : 0.;
+  G4double eta = (meanRate > 0.) ? std::max(eventsToProcess - events, 0L)/meanRate : -1.;
+  G4double rss = ResidentMemory();
+
+  lastReportClock = clock;
+  lastReportPhotons = photons;
+
+  std::ostringstream report;
+  report << std::fixed << std::setprecision(1)
+	 << (endOfRun ? " Run progress (final): " : " Run progress: ")
+	 << events << "/" << eventsToProcess << " events ("
+	 << (eventsToProcess > 0 ? 100.*events/eventsToProcess : 0.) << "%) in "
+	 << elapsed << " s, " << eventRate << " events/s, "
+	 << photonRate << " photons/s, ETA ";
+  if(eta >= 0.)
+    report << eta << " s";
+  else
+    report << "unknown";
+  report << ", RSS " << rss/1048576. << " MB, "
+	 << std::setprecision(3) << 100.*litFraction << "% of events with light";
+  if(nSlots > 1){
+    report << "\n   events/s per thread:" << std::setprecision(1);
+    for(G4int i=0; i<nSlots; i++)
+      report << " " << threadRates[i];
+  }
+  G4cout << report.str() << G4endl;
+
+  if(metricsFile != "")
+    WriteMetrics(elapsed, events, eventRate, photonRate, litFraction, eta, rss, threadRates.data());
+}
+
+
+void progressMonitor::WriteMetrics(G4double elapsed, G4long events, G4double eventRate,
+				   G4double photonRate, G4double litFraction, G4double eta,
+				   G4double rss, const G4double *threadRates)
+{
+  // Written next to the target and renamed over it, so that a scrape
+  // never sees half a file
+  std::string tmpFile = metricsFile + ".tmp";
+  std::ofstream file(tmpFile.c_str());
+  if(!file.is_open())
+    return;
+
+  file << "# HELP rmatrix_run_elapsed_seconds Time since the start of the current run\n"
+       << "# TYPE rmatrix_run_elapsed_seconds gauge\n"
+       << "rmatrix_run_elapsed_seconds " << elapsed << "\n"
+       << "# HELP rmatrix_events_processed_total Events processed in the current run\n"
+       << "# TYPE rmatrix_events_processed_total counter\n"
+       << "rmatrix_events_processed_total " << events << "\n"
+       << "# HELP rmatrix_events_to_process Events in the current run\n"
+       << "# TYPE rmatrix_events_to_process gauge\n"
+       << "rmatrix_events_to_process " << eventsToProcess << "\n"
+       << "# HELP rmatrix_events_per_second Event rate since the previous report\n"
+       << "# TYPE rmatrix_events_per_second gauge\n"
+       << "rmatrix_events_per_second " << eventRate << "\n"
+       << "# HELP rmatrix_photons_per_second Optical photon rate since the previous report\n"
+       << "# TYPE rmatrix_photons_per_second gauge\n"
+       << "rmatrix_photons_per_second " << photonRate << "\n"
+       << "# HELP rmatrix_lit_event_fraction Fraction of events that made light\n"
+       << "# TYPE rmatrix_lit_event_fraction gauge\n"
+       << "rmatrix_lit_event_fraction " << litFraction << "\n"
+       << "# HELP rmatrix_eta_seconds Estimated time left in the current run\n"
+       << "# TYPE rmatrix_eta_seconds gauge\n"
+       << "rmatrix_eta_seconds " << eta << "\n"
+       << "# HELP rmatrix_resident_memory_bytes Resident set size of the process\n"
+       << "# TYPE rmatrix_resident_memory_bytes gauge\n"
+       << "rmatrix_resident_memory_bytes " << rss << "\n"
+       << "# HELP rmatrix_thread_events_per_second Event rate of each thread since the previous report\n"
+       << "# TYPE rmatrix_thread_events_per_second gauge\n";
+  for(G4int i=0; i<nSlots; i++)
+    file << "rmatrix_thread_events_per_second{thread=\"" << i << "\"} " << threadRates[i] << "\n";
+  file.close();
+
+  std::rename(tmpFile.c_str(), metricsFile.c_str());
+}
+
+
+G4double progressMonitor::ResidentMemory()
+{
+  // Current RSS from /proc where there is one, else the peak
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while(std::getline(status, line))
+    if(line.compare(0, 6, "VmRSS:") == 0)
+      return std::stod(line.substr(6))*1024.;
+
+  rusage usage;
+  if(getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0.;
+#ifdef __APPLE__
+  return usage.ru_maxrss;
+#else
+  return usage.ru_maxrss*1024.;
+#endif
+}
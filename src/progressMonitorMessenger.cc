@@ -0,0 +1,52 @@
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include "G4SystemOfUnits.hh"
+
+#include "progressMonitor.hh"
+#include "progressMonitorMessenger.hh"
+
+// progressMonitorMessenger lets the user follow long runs from the log
+// or from a metrics scraper.
+
+progressMonitorMessenger::progressMonitorMessenger()
+{
+  progressDir = new G4UIdirectory("/RMatrix/progress/", false);
+  progressDir -> SetGuidance("Progress and throughput reports during a run");
+
+  // Command will let the user set how often progress is reported
+  intervalCommand = new G4UIcmdWithADoubleAndUnit("/RMatrix/progress/setInterval",this);
+  intervalCommand -> SetGuidance("Report the progress of a run at this interval (0 turns it off)");
+  intervalCommand -> SetParameterName("interval",false);
+  intervalCommand -> SetRange("interval>=0.");
+  intervalCommand -> SetUnitCategory("Time");
+  intervalCommand -> SetDefaultUnit("s");
+  intervalCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  intervalCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user have the reports scraped
+  metricsCommand = new G4UIcmdWithAString("/RMatrix/progress/setMetricsFile",this);
+  metricsCommand -> SetGuidance("Also write each report to this file in the Prometheus text format");
+  metricsCommand -> SetGuidance("Use 'none' to stop writing it");
+  metricsCommand -> SetParameterName("fileName",false);
+  metricsCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  metricsCommand -> SetToBeBroadcasted(false);
+}
+
+progressMonitorMessenger::~progressMonitorMessenger()
+{
+  delete metricsCommand;
+  delete intervalCommand;
+  delete progressDir;
+}
+
+
+void progressMonitorMessenger::SetNewValue(G4UIcommand *command,
+					   G4String newValue)
+{
+  if(command == intervalCommand)
+    progressMonitor::SetInterval(intervalCommand->GetNewDoubleValue(newValue)/s);
+
+  if(command == metricsCommand)
+    progressMonitor::SetMetricsFile(newValue);
+}
@@ -0,0 +1,159 @@
+#include "Randomize.hh"
+
+#include "resolutionModel.hh"
+#include "responseMatrix.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+resolutionModel::foldMode resolutionModel::mode = resolutionModel::foldOff;
+G4double resolutionModel::alpha = 0.;
+G4double resolutionModel::beta = 0.;
+G4double resolutionModel::gamma = 0.;
+G4double resolutionModel::lightUnit = 1.;
+std::map<G4String, resolutionModel::resolutionTable> resolutionModel::tables;
+
+namespace
+{
+  // FWHM of a Gaussian over its sigma, 2*sqrt(2*ln 2)
+  const G4double fwhmToSigma = 1./2.354820045;
+
+  // Fraction of a unit Gaussian below x
+  G4double NormalCDF(G4double x)
+  {
+    return 0.5*std::erfc(-x/std::sqrt(2.));
+  }
+}
+
+
+G4double resolutionModel::Resolution(const G4String &material, G4double light)
+{
+  G4double L = light/lightUnit;
+  if(L <= 0.)
+    return 0.;
+
+  auto table = tables.find(material);
+  if(table != tables.end()){
+    const std::vector<G4double> &x = table->second.light;
+    const std::vector<G4double> &y = table->second.resolution;
+    if(L <= x.front())
+      return y.front();
+    if(L >= x.back())
+      return y.back();
+    std::size_t i = std::upper_bound(x.begin(), x.end(), L) - x.begin();
+    return y[i-1] + (y[i] - y[i-1])*(L - x[i-1])/(x[i] - x[i-1]);
+  }
+
+  return std::sqrt(alpha*alpha + beta*beta/L + gamma*gamma/(L*L));
+}
+
+
+G4double resolutionModel::Sigma(const G4String &material, G4double light)
+{
+  return (light > 0.) ? light*Resolution(material, light)*fwhmToSigma : 0.;
+}
+
+
+G4double resolutionModel::Smear(const G4String &material, G4double light)
+{
+  G4double sigma = Sigma(material, light);
+  if(sigma <= 0.)
+    return light;
+  return std::max(G4RandGauss::shoot(light, sigma), 0.);
+}
+
+
+void resolutionModel::Fold(const G4String &material, const responseMatrix &in, responseMatrix &out)
+{
+  G4int nEnergy = in.GetNumberOfEnergyBins();
+  G4int nLight = in.GetNumberOfLightBins();
+  G4double lightWidth = in.GetLightMax()/nLight;
+  out.SetBinning(nEnergy, in.GetEnergyMin(), in.GetEnergyMax(), nLight, in.GetLightMax());
+
+  // The kernel is the same for every energy column, so it is worked
+  // out once: the share of light bin j that ends up in each bin of
+  // [first[j], first[j] + share[j].size()), cut at 5 sigma.  The tails
+  // go into the outermost bins of that band, so that light below zero
+  // lands in the first bin and light beyond the last in the overflow
+  std::vector<G4int> first(nLight);
+  std::vector<std::vector<G4double>> share(nLight);
+  for(G4int j=0; j<nLight; j++){
+    G4double centre = (j + 0.5)*lightWidth;
+    G4double sigma = Sigma(material, centre);
+    if(j == nLight - 1 or sigma <= 0.){
+      first[j] = j;
+      share[j].assign(1, 1.);
+      continue;
+    }
+
+    G4int low = std::max(G4int(std::floor((centre - 5.*sigma)/lightWidth)), 0);
+    G4int high = std::min(G4int(std::floor((centre + 5.*sigma)/lightWidth)), nLight - 1);
+    first[j] = low;
+    for(G4int k=low; k<=high; k++){
+      G4double below = (k == low) ? 0. : NormalCDF((k*lightWidth - centre)/sigma);
+      G4double above = (k == high) ? 1. : NormalCDF(((k+1)*lightWidth - centre)/sigma);
+      share[j].push_back(above - below);
+    }
+  }
+
+  for(G4int i=0; i<nEnergy; i++)
+    for(G4int j=0; j<nLight; j++){
+      G4double sum = in.GetBinContent(i, j);
+      if(sum == 0.)
+	continue;
+      G4double sum2 = in.GetBinError2(i, j);
+      for(std::size_t k=0; k<share[j].size(); k++)
+	out.AddToBin(i, first[j] + G4int(k), share[j][k]*sum, share[j][k]*sum2);
+    }
+}
+
+
+void resolutionModel::SetMode(G4String newMode)
+{
+  if(newMode == "off") mode = foldOff;
+  if(newMode == "event") mode = foldEvent;
+  if(newMode == "matrix") mode = foldMatrix;
+}
+
+
+void resolutionModel::SetTable(G4String material, G4String fileName)
+{
+  resolutionTable table;
+
+  std::ifstream input(fileName);
+  G4bool good = input.is_open();
+  std::string line;
+  while(good and std::getline(input, line)){
+    if(line.empty() or line[0] == '#')
+      continue;
+    for(char &c : line)
+      if(c == ';' or c == ',' or c == '\t') c = ' ';
+
+    std::istringstream is(line);
+    G4double light, resolution;
+    if(!(is >> light >> resolution))
+      continue;
+    if(!table.light.empty() and light <= table.light.back())
+      good = false;
+    table.light.push_back(light);
+    table.resolution.push_back(std::max(resolution, 0.));
+  }
+
+  if(!good or table.light.size() < 2){
+    G4ExceptionDescription description;
+    description << "Could not read the resolution curve " << fileName
+		<< ", " << material << " keeps the parameterised resolution";
+    G4Exception("resolutionModel::SetTable()",
+		"resolutionModel-001",
+		JustWarning,
+		description);
+    return;
+  }
+
+  tables[material] = table;
+  G4cout << " Resolution curve for " << material << " read from " << fileName
+	 << " (" << table.light.size() << " points)" << G4endl;
+}
@@ -0,0 +1,117 @@
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithADouble.hh"
+#include "G4UIcommand.hh"
+#include "G4UIparameter.hh"
+
+#include <sstream>
+
+#include "resolutionModel.hh"
+#include "resolutionModelMessenger.hh"
+
+// resolutionModelMessenger lets the user fold the detector resolution
+// into the light axis of the response matrices.
+
+resolutionModelMessenger::resolutionModelMessenger()
+{
+  resolutionDir = new G4UIdirectory("/RMatrix/resolution/", false);
+  resolutionDir -> SetGuidance("Detector resolution folded into the response matrices");
+
+  // Command will let the user choose how the resolution is folded
+  foldCommand = new G4UIcmdWithAString("/RMatrix/resolution/fold",this);
+  foldCommand -> SetGuidance("off: write the unfolded matrices only");
+  foldCommand -> SetGuidance("event: smear the light of every event as it is tallied");
+  foldCommand -> SetGuidance("matrix: fold the matrices at the end of the run");
+  foldCommand -> SetGuidance("  (other resolutions can then be tried on cached results)");
+  foldCommand -> SetParameterName("mode",false);
+  foldCommand -> SetCandidates("off event matrix");
+  foldCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  foldCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user set the parameterised resolution
+  parametersCommand = new G4UIcommand("/RMatrix/resolution/setParameters",this);
+  parametersCommand -> SetGuidance("Set alpha, beta and gamma of the relative FWHM");
+  parametersCommand -> SetGuidance("  R(L) = sqrt(alpha^2 + beta^2/L + gamma^2/L^2)");
+
+  G4UIparameter *alphaParam = new G4UIparameter("alpha",'d',false);
+  alphaParam -> SetParameterRange("alpha>=0");
+  parametersCommand -> SetParameter(alphaParam);
+
+  G4UIparameter *betaParam = new G4UIparameter("beta",'d',false);
+  betaParam -> SetParameterRange("beta>=0");
+  parametersCommand -> SetParameter(betaParam);
+
+  G4UIparameter *gammaParam = new G4UIparameter("gamma",'d',false);
+  gammaParam -> SetParameterRange("gamma>=0");
+  parametersCommand -> SetParameter(gammaParam);
+
+  parametersCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  parametersCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user set the unit of L
+  lightUnitCommand = new G4UIcmdWithADouble("/RMatrix/resolution/setLightUnit",this);
+  lightUnitCommand -> SetGuidance("Set the photons in one unit of the light L of the resolution");
+  lightUnitCommand -> SetGuidance("  (e.g. the photons per MeVee to give L in MeVee)");
+  lightUnitCommand -> SetParameterName("photons",false);
+  lightUnitCommand -> SetRange("photons>0");
+  lightUnitCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  lightUnitCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user give a material its measured resolution
+  tableCommand = new G4UIcommand("/RMatrix/resolution/setTable",this);
+  tableCommand -> SetGuidance("Read the resolution curve of a scintillator material");
+  tableCommand -> SetGuidance("  lines of 'L relativeFWHM', used instead of the parameters");
+
+  G4UIparameter *materialParam = new G4UIparameter("material",'s',false);
+  tableCommand -> SetParameter(materialParam);
+
+  G4UIparameter *fileParam = new G4UIparameter("fileName",'s',false);
+  tableCommand -> SetParameter(fileParam);
+
+  tableCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  tableCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user go back to the parameterised resolution
+  clearTablesCommand = new G4UIcommand("/RMatrix/resolution/clearTables",this);
+  clearTablesCommand -> SetGuidance("Forget all resolution curves read so far");
+  clearTablesCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  clearTablesCommand -> SetToBeBroadcasted(false);
+}
+
+resolutionModelMessenger::~resolutionModelMessenger()
+{
+  delete clearTablesCommand;
+  delete tableCommand;
+  delete lightUnitCommand;
+  delete parametersCommand;
+  delete foldCommand;
+  delete resolutionDir;
+}
+
+
+void resolutionModelMessenger::SetNewValue(G4UIcommand *command,
+					   G4String newValue)
+{
+  if(command == foldCommand)
+    resolutionModel::SetMode(newValue);
+
+  if(command == parametersCommand){
+    std::istringstream is(newValue);
+    G4double alpha, beta, gamma;
+    is >> alpha >> beta >> gamma;
+    resolutionModel::SetParameters(alpha, beta, gamma);
+  }
+
+  if(command == lightUnitCommand)
+    resolutionModel::SetLightUnit(lightUnitCommand->GetNewDoubleValue(newValue));
+
+  if(command == tableCommand){
+    std::istringstream is(newValue);
+    G4String material, fileName;
+    is >> material >> fileName;
+    resolutionModel::SetTable(material, fileName);
+  }
+
+  if(command == clearTablesCommand)
+    resolutionModel::ClearTables();
+}
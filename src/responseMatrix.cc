@@ -0,0 +1,209 @@
+#include "G4SystemOfUnits.hh"
+
+#include "responseMatrix.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+responseMatrix::responseMatrix(const G4String &name)
+  : G4VAccumulable(name),
+    nEnergyBins(100), energyMin(0.), energyMax(10.*MeV),
+    nLightBins(250), lightMax(50000.)
+{
+  sumW.assign(nEnergyBins*nLightBins, 0.);
+  sumW2.assign(nEnergyBins*nLightBins, 0.);
+}
+
+
+responseMatrix::~responseMatrix()
+{;}
+
+
+void responseMatrix::SetBinning(G4int nEnergy, G4double eMin, G4double eMax,
+				G4int nLight, G4double lMax)
+{
+  nEnergyBins = nEnergy;
+  energyMin = eMin;
+  energyMax = eMax;
+  nLightBins = nLight;
+  lightMax = lMax;
+
+  sumW.assign(nEnergyBins*nLightBins, 0.);
+  sumW2.assign(nEnergyBins*nLightBins, 0.);
+}
+
+
+void responseMatrix::Fill(G4double energy, G4double light, G4double weight)
+{
+  if(energy < energyMin or energy >= energyMax)
+    return;
+
+  G4int energyBin = G4int((energy - energyMin)/(energyMax - energyMin)*nEnergyBins);
+  G4int lightBin = std::min(G4int(std::max(light, 0.)/lightMax*nLightBins), nLightBins - 1);
+
+  G4int bin = energyBin*nLightBins + lightBin;
+  sumW[bin] += weight;
+  sumW2[bin] += weight*weight;
+}
+
+
+void responseMatrix::Merge(const G4VAccumulable &other)
+{
+  const responseMatrix &otherMatrix = static_cast<const responseMatrix &>(other);
+  if(otherMatrix.sumW.size() != sumW.size())
+    return;
+
+  for(std::size_t i=0; i<sumW.size(); i++){
+    sumW[i] += otherMatrix.sumW[i];
+    sumW2[i] += otherMatrix.sumW2[i];
+  }
+}
+
+
+void responseMatrix::Reset()
+{
+  std::fill(sumW.begin(), sumW.end(), 0.);
+  std::fill(sumW2.begin(), sumW2.end(), 0.);
+}
+
+
+void responseMatrix::ScaleColumn(G4int energyBin, G4double factor)
+{
+  for(G4int j=0; j<nLightBins; j++){
+    sumW[energyBin*nLightBins + j] *= factor;
+    sumW2[energyBin*nLightBins + j] *= factor*factor;
+  }
+}
+
+
+G4double responseMatrix::GetColumnSum(G4int energyBin) const
+{
+  G4double sum = 0.;
+  for(G4int j=0; j<nLightBins; j++)
+    sum += GetBinContent(energyBin, j);
+  return sum;
+}
+
+
+G4double responseMatrix::ColumnChiSquare(const responseMatrix &other, G4int energyBin) const
+{
+  G4double norm = GetColumnSum(energyBin);
+  G4double otherNorm = other.GetColumnSum(energyBin);
+  if(norm <= 0. or otherNorm <= 0.)
+    return -1.;
+
+  G4double chi2 = 0.;
+  G4int nDof = 0;
+  for(G4int j=0; j<nLightBins; j++){
+    G4double variance = GetBinError2(energyBin, j)/(norm*norm)
+      + other.GetBinError2(energyBin, j)/(otherNorm*otherNorm);
+    if(variance <= 0.)
+      continue;
+    G4double difference = GetBinContent(energyBin, j)/norm
+      - other.GetBinContent(energyBin, j)/otherNorm;
+    chi2 += difference*difference/variance;
+    nDof++;
+  }
+
+  return (nDof > 1) ? chi2/(nDof - 1) : 0.;
+}
+
+
+G4double responseMatrix::ColumnKSDistance(const responseMatrix &other, G4int energyBin) const
+{
+  G4double norm = GetColumnSum(energyBin);
+  G4double otherNorm = other.GetColumnSum(energyBin);
+  if(norm <= 0. or otherNorm <= 0.)
+    return -1.;
+
+  G4double cumulative = 0., otherCumulative = 0., distance = 0.;
+  for(G4int j=0; j<nLightBins; j++){
+    cumulative += GetBinContent(energyBin, j)/norm;
+    otherCumulative += other.GetBinContent(energyBin, j)/otherNorm;
+    distance = std::max(distance, std::abs(cumulative - otherCumulative));
+  }
+  return distance;
+}
+
+
+void responseMatrix::Pack(std::vector<G4double> &buffer) const
+{
+  buffer.insert(buffer.end(), sumW.begin(), sumW.end());
+  buffer.insert(buffer.end(), sumW2.begin(), sumW2.end());
+}
+
+
+std::size_t responseMatrix::Unpack(const std::vector<G4double> &buffer, std::size_t position)
+{
+  std::copy(buffer.begin() + position, buffer.begin() + position + sumW.size(), sumW.begin());
+  position += sumW.size();
+  std::copy(buffer.begin() + position, buffer.begin() + position + sumW2.size(), sumW2.begin());
+  return position + sumW2.size();
+}
+
+
+G4bool responseMatrix::Write(const G4String &fileName) const
+{
+  std::ofstream output(fileName, std::ofstream::trunc);
+  if(!output.is_open())
+    return false;
+
+  G4double energyWidth = (energyMax - energyMin)/nEnergyBins;
+  G4double lightWidth = lightMax/nLightBins;
+
+  output << "EnergyLow;EnergyHigh;LightLow;LightHigh;Sum;SumW2" << std::endl;
+  for(G4int i=0; i<nEnergyBins; i++)
+    for(G4int j=0; j<nLightBins; j++){
+      if(GetBinContent(i, j) == 0.)
+	continue;
+      output << (energyMin + i*energyWidth)/MeV << ";"
+	     << (energyMin + (i+1)*energyWidth)/MeV << ";"
+	     << j*lightWidth << ";" << (j+1)*lightWidth << ";"
+	     << GetBinContent(i, j) << ";" << GetBinError2(i, j) << std::endl;
+    }
+
+  return true;
+}
+
+
+G4bool responseMatrix::Read(const G4String &fileName)
+{
+  std::ifstream input(fileName);
+  if(!input.is_open())
+    return false;
+
+  Reset();
+
+  G4double energyWidth = (energyMax - energyMin)/nEnergyBins;
+  G4double lightWidth = lightMax/nLightBins;
+
+  std::string line;
+  std::getline(input, line);
+  while(std::getline(input, line)){
+    if(line.empty())
+      continue;
+    for(char &c : line)
+      if(c == ';') c = ' ';
+
+    std::istringstream is(line);
+    G4double eLow, eHigh, lLow, lHigh, sum, sum2;
+    if(!(is >> eLow >> eHigh >> lLow >> lHigh >> sum >> sum2))
+      return false;
+
+    // The bin edges have to be those of this binning
+    G4int i = G4int(std::floor((eLow*MeV - energyMin)/energyWidth + 0.5));
+    G4int j = G4int(std::floor(lLow/lightWidth + 0.5));
+    if(i < 0 or i >= nEnergyBins or j < 0 or j >= nLightBins
+       or std::abs(eHigh*MeV - (energyMin + (i+1)*energyWidth)) > 1e-6*energyWidth*nEnergyBins
+       or std::abs(lHigh - (j+1)*lightWidth) > 1e-6*lightMax)
+      return false;
+
+    sumW[i*nLightBins + j] = sum;
+    sumW2[i*nLightBins + j] = sum2;
+  }
+
+  return true;
+}
@@ -0,0 +1,240 @@
+#include "responseUnfolder.hh"
+
+#include <algorithm>
+#include <cmath>
+
+responseUnfolder::responseUnfolder()
+  : nLightBins(0), nEnergyBins(0),
+    method(unfoldMLEM),
+    maxIterations(1000), chi2Tolerance(1e-6),
+    regularisation(1e-3), regularisationOrder(2)
+{;}
+
+
+responseUnfolder::~responseUnfolder()
+{;}
+
+
+void responseUnfolder::SetResponse(const std::vector<G4double> &response, G4int nLight, G4int nEnergy)
+{
+  nLightBins = nLight;
+  nEnergyBins = nEnergy;
+  byLight = response;
+
+  byEnergy.assign(nEnergyBins*nLightBins, 0.);
+  efficiency.assign(nEnergyBins, 0.);
+  for(G4int j=0; j<nLightBins; j++)
+    for(G4int i=0; i<nEnergyBins; i++){
+      byEnergy[i*nLightBins + j] = byLight[j*nEnergyBins + i];
+      efficiency[i] += byLight[j*nEnergyBins + i];
+    }
+}
+
+
+void responseUnfolder::Fold(const std::vector<G4double> &spectrum, std::vector<G4double> &folded) const
+{
+  // Sum of the energy bins' light distributions, scaled by the spectrum
+  folded.assign(nLightBins, 0.);
+  G4double *f = folded.data();
+  for(G4int i=0; i<nEnergyBins; i++){
+    G4double phi = spectrum[i];
+    if(phi == 0.)
+      continue;
+    const G4double *column = &byEnergy[i*nLightBins];
+    for(G4int j=0; j<nLightBins; j++)
+      f[j] += phi*column[j];
+  }
+}
+
+
+G4double responseUnfolder::ChiSquare(const std::vector<G4double> &counts, const std::vector<G4double> &variances,
+				     const std::vector<G4double> &spectrum) const
+{
+  std::vector<G4double> folded;
+  Fold(spectrum, folded);
+
+  G4double chi2 = 0.;
+  for(G4int j=0; j<nLightBins; j++){
+    G4double difference = folded[j] - counts[j];
+    chi2 += difference*difference/std::max(variances[j], 1.);
+  }
+  return chi2;
+}
+
+
+G4int responseUnfolder::Unfold(const std::vector<G4double> &counts, const std::vector<G4double> &variances,
+			       std::vector<G4double> &spectrum) const
+{
+  if(nLightBins <= 0 or nEnergyBins <= 0
+     or G4int(counts.size()) != nLightBins or G4int(variances.size()) != nLightBins)
+    return -1;
+
+  if(method == unfoldTikhonov)
+    return SolveTikhonov(counts, variances, spectrum);
+
+  // Flat start with as many counts as were measured
+  G4double totalCounts = 0., totalEfficiency = 0.;
+  for(G4int j=0; j<nLightBins; j++)
+    totalCounts += std::max(counts[j], 0.);
+  for(G4int i=0; i<nEnergyBins; i++)
+    totalEfficiency += efficiency[i];
+  if(totalCounts <= 0. or totalEfficiency <= 0.)
+    return -1;
+
+  spectrum.assign(nEnergyBins, 0.);
+  for(G4int i=0; i<nEnergyBins; i++)
+    if(efficiency[i] > 0.)
+      spectrum[i] = totalCounts/totalEfficiency;
+
+  return Iterate(counts, variances, spectrum);
+}
+
+
+G4int responseUnfolder::Iterate(const std::vector<G4double> &counts, const std::vector<G4double> &variances,
+				std::vector<G4double> &spectrum) const
+{
+  std::vector<G4double> folded;
+  std::vector<G4double> ratio(nLightBins), weight(nLightBins);
+  std::vector<G4double> update(nEnergyBins), norm(nEnergyBins);
+
+  G4double lastChi2 = -1.;
+  G4int iteration = 0;
+  while(iteration < maxIterations){
+    Fold(spectrum, folded);
+
+    G4double chi2 = 0.;
+    for(G4int j=0; j<nLightBins; j++){
+      G4double difference = folded[j] - counts[j];
+      chi2 += difference*difference/std::max(variances[j], 1.);
+    }
+    if(lastChi2 >= 0. and std::abs(lastChi2 - chi2) <= chi2Tolerance*std::max(lastChi2, 1.))
+      break;
+    lastChi2 = chi2;
+    iteration++;
+
+    // Per light bin factors: the measured over folded counts for MLEM,
+    // their log and its weight for GRAVEL.  Bins GRAVEL cannot take a
+    // log of are left out
+    for(G4int j=0; j<nLightBins; j++){
+      G4double m = std::max(counts[j], 0.);
+      if(method == unfoldMLEM){
+	ratio[j] = (folded[j] > 0.) ? m/folded[j] : 0.;
+	weight[j] = 1.;
+      }
+      else if(m > 0. and folded[j] > 0.){
+	ratio[j] = std::log(m/folded[j]);
+	weight[j] = m*m/(std::max(variances[j], 1.)*folded[j]);
+      }
+      else{
+	ratio[j] = 0.;
+	weight[j] = 0.;
+      }
+    }
+
+    // Back projection, as a sum of the light bins' rows of R
+    std::fill(update.begin(), update.end(), 0.);
+    std::fill(norm.begin(), norm.end(), 0.);
+    G4double *u = update.data();
+    G4double *n = norm.data();
+    for(G4int j=0; j<nLightBins; j++){
+      G4double r = ratio[j]*weight[j];
+      G4double w = weight[j];
+      if(w == 0.)
+	continue;
+      const G4double *row = &byLight[j*nEnergyBins];
+      for(G4int i=0; i<nEnergyBins; i++){
+	u[i] += r*row[i];
+	n[i] += w*row[i];
+      }
+    }
+
+    for(G4int i=0; i<nEnergyBins; i++){
+      if(method == unfoldMLEM)
+	spectrum[i] = (efficiency[i] > 0.) ? spectrum[i]*update[i]/efficiency[i] : 0.;
+      else if(norm[i] > 0.)
+	spectrum[i] *= std::exp(update[i]/norm[i]);
+    }
+  }
+
+  return iteration;
+}
+
+
+G4int responseUnfolder::SolveTikhonov(const std::vector<G4double> &counts, const std::vector<G4double> &variances,
+				      std::vector<G4double> &spectrum) const
+{
+  G4int n = nEnergyBins;
+
+  // Normal equations of the weighted least squares, (A^T A) phi = A^T b
+  // with A = R/sigma and b = m/sigma
+  std::vector<G4double> invVariance(nLightBins);
+  for(G4int j=0; j<nLightBins; j++)
+    invVariance[j] = 1./std::max(variances[j], 1.);
+
+  std::vector<G4double> normal(n*n, 0.), rhs(n, 0.);
+  std::vector<G4double> weighted(nLightBins);
+  for(G4int i=0; i<n; i++){
+    const G4double *column = &byEnergy[i*nLightBins];
+    for(G4int j=0; j<nLightBins; j++)
+      weighted[j] = column[j]*invVariance[j];
+    for(G4int j=0; j<nLightBins; j++)
+      rhs[i] += weighted[j]*counts[j];
+    for(G4int k=0; k<=i; k++){
+      const G4double *other = &byEnergy[k*nLightBins];
+      G4double sum = 0.;
+      for(G4int j=0; j<nLightBins; j++)
+	sum += weighted[j]*other[j];
+      normal[i*n + k] = sum;
+      normal[k*n + i] = sum;
+    }
+  }
+
+  // Penalty L^T L, L the identity or the first or second difference
+  std::vector<G4double> penalty(n*n, 0.);
+  G4int order = std::max(0, std::min(regularisationOrder, 2));
+  const G4double stencils[3][3] = {{1., 0., 0.}, {-1., 1., 0.}, {1., -2., 1.}};
+  for(G4int row=0; row+order<n; row++)
+    for(G4int a=0; a<=order; a++)
+      for(G4int b=0; b<=order; b++)
+	penalty[(row+a)*n + row+b] += stencils[order][a]*stencils[order][b];
+
+  G4double normalTrace = 0., penaltyTrace = 0.;
+  for(G4int i=0; i<n; i++){
+    normalTrace += normal[i*n + i];
+    penaltyTrace += penalty[i*n + i];
+  }
+  if(normalTrace <= 0.)
+    return -1;
+  G4double lambda = (penaltyTrace > 0.) ? regularisation*normalTrace/penaltyTrace : 0.;
+  for(G4int i=0; i<n*n; i++)
+    normal[i] += lambda*penalty[i];
+
+  // Cholesky factorisation, in the lower triangle
+  for(G4int i=0; i<n; i++)
+    for(G4int k=0; k<=i; k++){
+      G4double sum = normal[i*n + k];
+      for(G4int l=0; l<k; l++)
+	sum -= normal[i*n + l]*normal[k*n + l];
+      if(i == k){
+	if(sum <= 0.)
+	  return -1;
+	normal[i*n + i] = std::sqrt(sum);
+      }
+      else
+	normal[i*n + k] = sum/normal[k*n + k];
+    }
+
+  spectrum = rhs;
+  for(G4int i=0; i<n; i++){
+    for(G4int l=0; l<i; l++)
+      spectrum[i] -= normal[i*n + l]*spectrum[l];
+    spectrum[i] /= normal[i*n + i];
+  }
+  for(G4int i=n-1; i>=0; i--){
+    for(G4int l=i+1; l<n; l++)
+      spectrum[i] -= normal[l*n + i]*spectrum[l];
+    spectrum[i] /= normal[i*n + i];
+  }
+
+  return 1;
+}
@@ -0,0 +1,346 @@
+#include "G4RunManager.hh"
+#include "G4UImanager.hh"
+#include "G4Version.hh"
+
+#include "resultsCache.hh"
+#include "resolutionModel.hh"
+#include "neutronResponseModel.hh"
+#include "lightCollectionMap.hh"
+#include "runAction.hh"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+
+// Written at build time from 'git describe' and a hash of any
+// uncommitted changes (cmake/RMatrixVersion.cmake)
+#include "RMatrixVersion.hh"
+
+G4String resultsCache::directory = "RMatrixCache";
+
+namespace
+{
+  // Commands that change nothing a run tallies: output, verbosity,
+  // seeding (an entry keeps its own stream), threads, the cache, and
+  // the target spectra the matrices are reweighted to as they are
+  // written
+  const char *ignoredCommands[] = {
+    "/control/", "/vis/", "/gui/", "/random/", "/mpi/",
+    "/run/beamOn", "/run/initialize", "/run/printProgress",
+    "/run/numberOfThreads", "/run/useMaximumNumberOfThreads",
+    "/tracking/storeTrajectory",
+    "/RMatrix/cache/", "/RMatrix/random/", "/RMatrix/progress/", "/RMatrix/profile/",
+    "/RMatrix/output/setFileName", "/RMatrix/output/setDataOutput",
+    "/RMatrix/response/matrixOutput", "/RMatrix/response/setFileName",
+    "/RMatrix/response/addTargetSpectrum", "/RMatrix/response/clearTargetSpectra",
+    "/RMatrix/stack/printPolicy"
+  };
+
+  // Commands that add to what is there rather than set it, so that
+  // every repeat of them counts.  Settings made before one of them may
+  // have gone into what it added (the material of a detector, the
+  // source the /gps/ commands apply to), so they are all kept
+  const char *accumulatingCommands[] = {
+    "/RMatrix/geometry/addDetector", "/RMatrix/geometry/clearDetectors",
+    "/RMatrix/resolution/clearTables",
+    "/gps/source/add", "/gps/source/select", "/gps/hist/point", "/process/"
+  };
+
+  // Commands whose first parameters say what is set, with how many of
+  // them, e.g. the region and particle of a cut
+  const std::pair<const char *, G4int> selectorCommands[] = {
+    {"/RMatrix/geometry/setRegionCut", 2},
+    {"/RMatrix/stack/setClassification", 1},
+    {"/RMatrix/stack/countOnly", 1},
+    {"/RMatrix/stack/setEnergyThreshold", 1},
+    {"/RMatrix/resolution/setTable", 1},
+    {"/run/setCutForRegion", 1},
+    {"/run/setCutForAGivenParticle", 1}
+  };
+
+  // Commands that read a file, with the position of its name among
+  // their parameters
+  const std::pair<const char *, G4int> fileCommands[] = {
+    {"/RMatrix/resolution/setTable", 1},
+    {"/gps/hist/file", 0}
+  };
+
+  G4bool StartsWith(const G4String &command, const char *prefix)
+  {
+    return command.compare(0, std::string(prefix).size(), prefix) == 0;
+  }
+
+  // The setting a command makes: its path, and the parameters that
+  // select what it sets
+  G4String Setting(const G4String &command)
+  {
+    std::istringstream words(command);
+    std::string word, setting;
+    words >> setting;
+    G4int nSelectors = 0;
+    for(const auto &selector : selectorCommands)
+      if(setting == selector.first)
+	nSelectors = selector.second;
+    for(G4int i=0; i<nSelectors and words >> word; i++)
+      setting += " " + word;
+    return setting;
+  }
+}
+
+
+G4String resultsCache::ConfigurationKey()
+{
+  std::ostringstream key;
+  key << "RMatrixG4 " << RMATRIX_VERSION << "\n"
+      << "Geant4 " << G4VERSION_NUMBER << "\n";
+
+  // Fast mode can be set from the command line, before the physics
+  // list is built, which leaves no command in the history.  Files are
+  // known by their contents as well as their names, so that one
+  // written again under the same name makes another configuration
+  neutronResponseModel::responseMode responseMode = neutronResponseModel::GetMode();
+  if(responseMode == neutronResponseModel::responseFast)
+    key << "fastResponse " << neutronResponseModel::GetTableFile() << "\n";
+  if(responseMode == neutronResponseModel::responseFast or responseMode == neutronResponseModel::responseCompare)
+    key << "file " << neutronResponseModel::GetTableFile() << " "
+	<< FileDigest(neutronResponseModel::GetTableFile()) << "\n";
+  if(lightCollectionMap::GetMode() == lightCollectionMap::collectionApply)
+    key << "file " << lightCollectionMap::GetMapFile() << " "
+	<< FileDigest(lightCollectionMap::GetMapFile()) << "\n";
+
+  G4UImanager *UI = G4UImanager::GetUIpointer();
+  std::vector<G4String> commands;
+  for(G4int i=0; i<UI->GetNumberOfHistory(); i++){
+    G4String command = UI->GetPreviousCommand(i);
+    G4String path = command.substr(0, command.find(' '));
+
+    G4bool ignored = (path.find("verbose") != std::string::npos
+		      or path.find("Verbose") != std::string::npos);
+    for(const char *prefix : ignoredCommands)
+      ignored = ignored or StartsWith(path, prefix);
+
+    // The resolution is only tallied when it is folded event by event;
+    // otherwise it is applied to the cached matrices as they are written
+    if(resolutionModel::GetMode() != resolutionModel::foldEvent)
+      ignored = ignored or StartsWith(path, "/RMatrix/resolution/");
+    if(!ignored)
+      commands.push_back(command);
+  }
+
+  // Only the last of the repeats of a setting counts, where it was last
+  // set, unless something was added in between; the order of the
+  // settings is kept
+  std::set<G4String> seen;
+  std::vector<G4String> kept;
+  for(auto command = commands.rbegin(); command != commands.rend(); ++command){
+    G4bool accumulating = false;
+    for(const char *prefix : accumulatingCommands)
+      accumulating = accumulating or StartsWith(*command, prefix);
+    if(accumulating){
+      seen.clear();
+      kept.push_back(*command);
+    }
+    else if(seen.insert(Setting(*command)).second)
+      kept.push_back(*command);
+  }
+  for(auto command = kept.rbegin(); command != kept.rend(); ++command){
+    key << *command << "\n";
+
+    for(const auto &fileCommand : fileCommands){
+      if(!StartsWith(*command, fileCommand.first))
+	continue;
+      std::istringstream words(*command);
+      std::string fileName;
+      words >> fileName;
+      for(G4int i=0; i<=fileCommand.second; i++)
+	words >> fileName;
+      key << "file " << fileName << " " << FileDigest(fileName) << "\n";
+    }
+  }
+
+  return key.str();
+}
+
+
+G4String resultsCache::FileDigest(const G4String &fileName)
+{
+  std::ifstream input(fileName, std::ios::binary);
+  if(!input.is_open())
+    return "missing";
+  std::ostringstream contents;
+  contents << input.rdbuf();
+  return Hash(contents.str());
+}
+
+
+G4String resultsCache::Hash(const G4String &key)
+{
+  // 64-bit FNV-1a; the entry also keeps the key to rule out collisions
+  std::uint64_t hash = 0xcbf29ce484222325ULL;
+  for(unsigned char c : key){
+    hash ^= c;
+    hash *= 0x100000001b3ULL;
+  }
+
+  std::ostringstream hex;
+  hex << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return hex.str();
+}
+
+
+void resultsCache::BeamOn(G4int nEvents)
+{
+  G4RunManager *runManager = G4RunManager::GetRunManager();
+
+  if(!runAction::GetPerEventSeeding()){
+    G4Exception("resultsCache::BeamOn()",
+		"resultsCache-001",
+		JustWarning,
+		"Per-event seeding is off, so cached results could not be extended; running without the cache");
+    runManager -> BeamOn(nEvents);
+    return;
+  }
+
+  // The response matrices are what is cached
+  runAction::SetMatrixOutput("on");
+  runAction *rnAction = const_cast<runAction *>
+    (static_cast<const runAction *>(runManager->GetUserRunAction()));
+
+  G4String key = ConfigurationKey();
+  G4String fileName = directory + "/" + Hash(key) + ".cache";
+
+  rnAction -> BinTallies();
+  std::vector<G4double> tallies(rnAction->PackTallies().size(), 0.);
+
+  G4long cachedEvents = 0;
+  G4long runSeed = runAction::GetRunSeed();
+  std::vector<G4double> cached;
+  if(Load(fileName, key, cachedEvents, runSeed, cached)){
+    if(cached.size() == tallies.size()){
+      tallies = cached;
+      G4cout << " Results cache: " << cachedEvents << " events of this configuration in "
+	     << fileName << G4endl;
+    }
+    else{
+      G4Exception("resultsCache::BeamOn()",
+		  "resultsCache-002",
+		  JustWarning,
+		  ("The tallies in " + fileName + " are binned differently; the entry is replaced").c_str());
+      cachedEvents = 0;
+      runSeed = runAction::GetRunSeed();
+    }
+  }
+
+  // Only the events the entry does not have yet are simulated: the
+  // next ones of the entry's stream
+  G4long missing = nEvents - cachedEvents;
+  if(missing > 0){
+    G4long sessionSeed = runAction::GetRunSeed();
+    G4long sessionOffset = runAction::GetEventOffset();
+    runAction::SetRunSeed(runSeed);
+    runAction::SetEventOffset(cachedEvents);
+
+    runAction::SetBlockMode(true);
+    runManager -> BeamOn(G4int(missing));
+    runAction::SetBlockMode(false);
+
+    runAction::SetRunSeed(sessionSeed);
+    runAction::SetEventOffset(sessionOffset);
+
+    std::vector<G4double> added = rnAction->PackTallies();
+    for(std::size_t i=0; i<tallies.size(); i++)
+      tallies[i] += added[i];
+    cachedEvents += missing;
+
+    if(!Save(fileName, key, cachedEvents, runSeed, tallies))
+      G4Exception("resultsCache::BeamOn()",
+		  "resultsCache-003",
+		  JustWarning,
+		  ("Could not write the cache entry " + fileName).c_str());
+  }
+  else if(missing < 0)
+    G4cout << " Results cache: the entry holds more events than asked for, all "
+	   << cachedEvents << " are used" << G4endl;
+
+  rnAction -> UnpackTallies(tallies);
+  rnAction -> ReportTallies(G4int(cachedEvents));
+}
+
+
+G4bool resultsCache::Load(const G4String &fileName, const G4String &key,
+			  G4long &nEvents, G4long &runSeed, std::vector<G4double> &tallies)
+{
+  std::ifstream input(fileName);
+  if(!input.is_open())
+    return false;
+
+  std::string label;
+  G4int version = 0;
+  std::size_t nTallies = 0;
+  G4long events = 0, seed = 0;
+  if(!(input >> label >> version) or label != "RMatrixCache" or version != 1
+     or !(input >> label >> events) or !(input >> label >> seed)
+     or !(input >> label >> nTallies))
+    return false;
+
+  std::vector<G4double> values(nTallies);
+  for(G4double &value : values)
+    if(!(input >> value))
+      return false;
+
+  // The rest of the file is the configuration it was made for
+  std::string line;
+  std::getline(input, line);
+  std::getline(input, line);
+  if(line != "configuration")
+    return false;
+  std::ostringstream configuration;
+  configuration << input.rdbuf();
+  if(configuration.str() != key){
+    G4Exception("resultsCache::Load()",
+		"resultsCache-004",
+		JustWarning,
+		("The entry " + fileName + " is for another configuration").c_str());
+    return false;
+  }
+
+  nEvents = events;
+  runSeed = seed;
+  tallies = values;
+  return true;
+}
+
+
+G4bool resultsCache::Save(const G4String &fileName, const G4String &key,
+			  G4long nEvents, G4long runSeed, const std::vector<G4double> &tallies)
+{
+  if(mkdir(directory.c_str(), 0755) != 0 and errno != EEXIST)
+    return false;
+
+  // Written next to the entry and renamed over it, so that a job that
+  // stops half way leaves the old entry intact
+  std::string tmpFile = fileName + ".tmp";
+  std::ofstream output(tmpFile.c_str());
+  if(!output.is_open())
+    return false;
+
+  output << "RMatrixCache 1\n"
+	 << "events " << nEvents << "\n"
+	 << "runSeed " << runSeed << "\n"
+	 << "tallies " << tallies.size() << "\n"
+	 << std::setprecision(17);
+  for(G4double value : tallies)
+    output << value << "\n";
+  output << "configuration\n" << key;
+  output.close();
+  if(output.fail())
+    return false;
+
+  return std::rename(tmpFile.c_str(), fileName.c_str()) == 0;
+}
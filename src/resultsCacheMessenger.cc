@@ -0,0 +1,54 @@
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4UImanager.hh"
+
+#include "resultsCache.hh"
+#include "resultsCacheMessenger.hh"
+
+// resultsCacheMessenger lets the user ask for a response matrix without
+// simulating again what has been simulated before.
+
+resultsCacheMessenger::resultsCacheMessenger()
+{
+  // The configuration key is read from the command history, which
+  // only keeps the last 20 commands unless told otherwise
+  G4UImanager::GetUIpointer() -> SetMaxHistSize(1000000);
+
+  cacheDir = new G4UIdirectory("/RMatrix/cache/", false);
+  cacheDir -> SetGuidance("Results cache of response matrices");
+
+  // Command will let the user choose where the cache is kept
+  directoryCommand = new G4UIcmdWithAString("/RMatrix/cache/setDirectory",this);
+  directoryCommand -> SetGuidance("Set the directory cache entries are kept in");
+  directoryCommand -> SetParameterName("directory",false);
+  directoryCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  directoryCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user run through the cache
+  beamOnCommand = new G4UIcmdWithAnInteger("/RMatrix/cache/beamOn",this);
+  beamOnCommand -> SetGuidance("Get the response matrices of N events of the current configuration");
+  beamOnCommand -> SetGuidance("Cached events are reused and only the missing ones are simulated");
+  beamOnCommand -> SetParameterName("N",false);
+  beamOnCommand -> SetRange("N>0");
+  beamOnCommand -> AvailableForStates(G4State_Idle);
+  beamOnCommand -> SetToBeBroadcasted(false);
+}
+
+resultsCacheMessenger::~resultsCacheMessenger()
+{
+  delete beamOnCommand;
+  delete directoryCommand;
+  delete cacheDir;
+}
+
+
+void resultsCacheMessenger::SetNewValue(G4UIcommand *command,
+					G4String newValue)
+{
+  if(command == directoryCommand)
+    resultsCache::SetDirectory(newValue);
+
+  if(command == beamOnCommand)
+    resultsCache::BeamOn(beamOnCommand->GetNewIntValue(newValue));
+}
@@ -1,20 +1,652 @@
 #include "G4RunManager.hh"
+#include "G4Threading.hh"
+#include "G4AccumulableManager.hh"
+#include "G4UnitsTable.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+
 #include "runAction.hh"
+#include "runActionMessenger.hh"
+#include "neutronResponseModel.hh"
+#include "neutronResponseModelMessenger.hh"
+#include "lightCollectionMapMessenger.hh"
+#include "stepProfileMessenger.hh"
+#include "progressMonitor.hh"
+#include "progressMonitorMessenger.hh"
+#include "resultsCacheMessenger.hh"
+#include "resolutionModel.hh"
+#include "resolutionModelMessenger.hh"
+#include "traceRecorder.hh"
+#include "spectrumReweighter.hh"
+#include "eventAction.hh"
+#include "geometryConstruction.hh"
+#include "G4LogicalVolume.hh"
+#include "G4Material.hh"
+#include "G4Tubs.hh"
+#include "G4OpticalParameters.hh"
+#include "G4GeneralParticleSourceData.hh"
+#include "G4SingleParticleSource.hh"
+#include "G4SPSEneDistribution.hh"
+#include "G4Neutron.hh"
+#include "PhysicsList.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+
+G4long runAction::runSeed = 0;
+G4long runAction::eventOffset = 0;
+G4bool runAction::perEventSeeding = true;
+
+G4bool runAction::matrixOutput = false;
+G4String runAction::matrixFileName = "RMatrix";
+G4int runAction::matrixEnergyBins = 100;
+G4double runAction::matrixEnergyMin = 0.;
+G4double runAction::matrixEnergyMax = 10.*MeV;
+G4int runAction::matrixLightBins = 250;
+G4double runAction::matrixLightMax = 50000.;
+std::vector<G4String> runAction::targetSpectra;
+
+G4bool runAction::blockMode = false;
+G4int runAction::blockRuns = 0;
+
+namespace
+{
+  // SplitMix64 finalizer; a cheap counter-based hash with good
+  // avalanche, so neighbouring event numbers give unrelated seeds
+  std::uint64_t SplitMix64(std::uint64_t x)
+  {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+  }
+
+  // File name without its extension, and without its directory too
+  // if baseOnly is set
+  G4String FileStem(const G4String &fileName, G4bool baseOnly)
+  {
+    std::size_t slash = fileName.find_last_of('/');
+    std::size_t start = (slash == std::string::npos) ? 0 : slash + 1;
+    std::size_t dot = fileName.find_last_of('.');
+    G4String stem = (dot == std::string::npos or dot < start) ? fileName : fileName.substr(0, dot);
+    return baseOnly ? stem.substr(start) : stem;
+  }
+
+  // Highest energy a GPS energy distribution can give, taking a
+  // Gaussian to stop at 5 sigma; 0 for per nucleon spectra, which are
+  // not checked
+  G4double SourceEnergyMax(G4SPSEneDistribution *energy)
+  {
+    const G4String &type = energy->GetEnergyDisType();
+    if(type == "Mono")
+      return energy->GetMonoEnergy();
+    if(type == "Gauss")
+      return energy->GetMonoEnergy() + 5.*energy->GetSE();
+    if(type == "User")
+      return energy->GetUserDefinedEnergyHisto().GetMaxEnergy();
+    if(type == "Arb")
+      return energy->GetArbEnergyHisto().GetMaxEnergy();
+    if(type == "Epn")
+      return 0.;
+    return energy->GetEmax();
+  }
+}
 
 runAction::runAction()
-{;}
+  : runMessenger(nullptr),
+    responseMessenger(nullptr),
+    mapMessenger(nullptr),
+    profileMessenger(nullptr),
+    progressMessenger(nullptr),
+    cacheMessenger(nullptr),
+    resolutionMessenger(nullptr),
+    nKilledNeutrons(0.),
+    killedNeutronEnergy(0.),
+    nCountedTracks(0),
+    profile("stepProfile"),
+    trainingTable("trainingTable"),
+    fullResponse("fullResponse"),
+    fastResponse("fastResponse"),
+    calibrationMap("calibrationMap"),
+    neutronMatrix("neutronMatrix"),
+    gammaMatrix("gammaMatrix"),
+    neutronLight(0.),
+    neutronLightViaGamma(0.),
+    neutronFolded("neutronFolded"),
+    gammaFolded("gammaFolded"),
+    scintMaterial(""),
+    source("sourceTally"),
+    arrayTally("arrayTally")
+{
+  // Run tallies are filled per thread and merged on the master
+  G4AccumulableManager *accumulableManager = G4AccumulableManager::Instance();
+  accumulableManager->RegisterAccumulable(nKilledNeutrons);
+  accumulableManager->RegisterAccumulable(killedNeutronEnergy);
+  accumulableManager->RegisterAccumulable(nCountedTracks);
+  accumulableManager->RegisterAccumulable(&profile);
+  accumulableManager->RegisterAccumulable(&trainingTable);
+  accumulableManager->RegisterAccumulable(&fullResponse);
+  accumulableManager->RegisterAccumulable(&fastResponse);
+  accumulableManager->RegisterAccumulable(&calibrationMap);
+  accumulableManager->RegisterAccumulable(&arrayTally);
+  accumulableManager->RegisterAccumulable(&neutronMatrix);
+  accumulableManager->RegisterAccumulable(&gammaMatrix);
+  accumulableManager->RegisterAccumulable(neutronLight);
+  accumulableManager->RegisterAccumulable(neutronLightViaGamma);
+  accumulableManager->RegisterAccumulable(&neutronFolded);
+  accumulableManager->RegisterAccumulable(&gammaFolded);
+  accumulableManager->RegisterAccumulable(&source);
+
+  // The seeding settings are shared by all threads and only changed
+  // by the master, between runs.  Default to the seed that main() gave
+  // the master engine
+  if(!G4Threading::IsWorkerThread()){
+    runSeed = CLHEP::HepRandom::getTheSeed();
+    runMessenger = new runActionMessenger(this);
+    responseMessenger = new neutronResponseModelMessenger();
+    mapMessenger = new lightCollectionMapMessenger();
+    profileMessenger = new stepProfileMessenger();
+    progressMessenger = new progressMonitorMessenger();
+    cacheMessenger = new resultsCacheMessenger();
+    resolutionMessenger = new resolutionModelMessenger();
+  }
+}
 
 runAction::~runAction()
-{;}
+{
+  delete resolutionMessenger;
+  delete cacheMessenger;
+  delete progressMessenger;
+  delete profileMessenger;
+  delete mapMessenger;
+  delete responseMessenger;
+  delete runMessenger;
+}
 
-void runAction::BeginOfRunAction(const G4Run *)
+void runAction::BeginOfRunAction(const G4Run *aRun)
 {
     G4cout << "\n *********** Run Started *************"
     << G4endl;
+
+    // In block mode the master keeps what the earlier blocks added up
+    G4bool keepTallies = (IsMaster() and blockMode and blockRuns > 0);
+    if(IsMaster() and blockMode)
+      blockRuns++;
+
+    // Size the response tallies for this run before they are cleared.
+    // The table records the scintillator it is trained on
+    if(neutronResponseModel::GetMode() == neutronResponseModel::responseTrain){
+      const geometryConstruction *geometry = static_cast<const geometryConstruction *>
+	(G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+      const G4Tubs *cylinder = static_cast<const G4Tubs *>(geometry->GetScintVolume()->GetSolid());
+      neutronResponseModel::ConfigureTable(trainingTable);
+      trainingTable.SetCylinder(geometry->GetDetectorMaterial(0)->GetName(),
+				cylinder->GetOuterRadius(), cylinder->GetZHalfLength());
+    }
+
+    const neutronResponseTable *table = neutronResponseModel::GetTable();
+    if(neutronResponseModel::GetMode() == neutronResponseModel::responseCompare and table){
+      fullResponse.SetBinning(table->GetNumberOfEnergyBins(), table->GetEnergyMin(), table->GetEnergyMax(),
+			      table->GetNumberOfLightBins(), table->GetLightMax());
+      fastResponse.SetBinning(table->GetNumberOfEnergyBins(), table->GetEnergyMin(), table->GetEnergyMax(),
+			      table->GetNumberOfLightBins(), table->GetLightMax());
+    }
+
+    if(!keepTallies)
+      BinTallies();
+
+    // A calibration map describes the scintillator as it is now.  It
+    // needs optical photons transported through the surfaces, which the
+    // lean physics list turns off
+    if(lightCollectionMap::GetMode() == lightCollectionMap::collectionCalibrate){
+      if(!G4OpticalParameters::Instance()->GetProcessActivation("OpBoundary"))
+	G4Exception("runAction::BeginOfRunAction()",
+		    "runAction-005",
+		    FatalException,
+		    "Light collection calibration needs optical photon transport; use the QGSP_BIC_HP physics list");
+      const geometryConstruction *geometry = static_cast<const geometryConstruction *>
+	(G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+      const G4LogicalVolume *scint = geometry->GetScintVolume();
+      const G4Tubs *cylinder = static_cast<const G4Tubs *>(scint->GetSolid());
+      lightCollectionMap::ConfigureMap(calibrationMap);
+      calibrationMap.SetCylinder(geometry->GetDetectorMaterial(0)->GetName(),
+				 cylinder->GetOuterRadius(), cylinder->GetZHalfLength());
+    }
+
+    // A map read from disk only holds for the scintillator it was made
+    // for, and one map serves every detector of an array
+    const lightCollectionMap *map = lightCollectionMap::GetMap();
+    if(IsMaster() and map and lightCollectionMap::GetMode() == lightCollectionMap::collectionApply){
+      const geometryConstruction *geometry = static_cast<const geometryConstruction *>
+	(G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+      const G4Tubs *cylinder = static_cast<const G4Tubs *>(geometry->GetScintVolume()->GetSolid());
+      for(G4int i=0; i<geometry->GetNumberOfDetectors(); i++)
+	if(!map->Matches(geometry->GetDetectorMaterial(i)->GetName(),
+			 cylinder->GetOuterRadius(), cylinder->GetZHalfLength())){
+	  G4ExceptionDescription description;
+	  description << "The light collection map " << lightCollectionMap::GetMapFile() << " was made for "
+		      << map->GetMaterialName() << " (r = " << map->GetRadius()/mm << " mm, half-length "
+		      << map->GetHalfLength()/mm << " mm), but detector " << i << " is "
+		      << geometry->GetDetectorMaterial(i)->GetName() << " (r = " << cylinder->GetOuterRadius()/mm
+		      << " mm, half-length " << cylinder->GetZHalfLength()/mm << " mm)";
+	  G4Exception("runAction::BeginOfRunAction()",
+		      "runAction-006",
+		      FatalException,
+		      description);
+	}
+    }
+
+    // Likewise a neutron response table only holds for the scintillator
+    // it was trained on
+    if(IsMaster() and table and (neutronResponseModel::GetMode() == neutronResponseModel::responseFast
+				 or neutronResponseModel::GetMode() == neutronResponseModel::responseCompare)){
+      const geometryConstruction *geometry = static_cast<const geometryConstruction *>
+	(G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+      const G4Tubs *cylinder = static_cast<const G4Tubs *>(geometry->GetScintVolume()->GetSolid());
+      for(G4int i=0; i<geometry->GetNumberOfDetectors(); i++)
+	if(!table->Matches(geometry->GetDetectorMaterial(i)->GetName(),
+			   cylinder->GetOuterRadius(), cylinder->GetZHalfLength())){
+	  G4ExceptionDescription description;
+	  description << "The neutron response table " << neutronResponseModel::GetTableFile() << " was trained on "
+		      << table->GetMaterialName() << " (r = " << table->GetRadius()/mm << " mm, half-length "
+		      << table->GetHalfLength()/mm << " mm), but detector " << i << " is "
+		      << geometry->GetDetectorMaterial(i)->GetName() << " (r = " << cylinder->GetOuterRadius()/mm
+		      << " mm, half-length " << cylinder->GetZHalfLength()/mm << " mm)";
+	  G4Exception("runAction::BeginOfRunAction()",
+		      "runAction-008",
+		      FatalException,
+		      description);
+	}
+    }
+
+    // A response matrix is the response of one detector, while the
+    // light of an event is summed over the array
+    if(IsMaster() and matrixOutput){
+      const geometryConstruction *geometry = static_cast<const geometryConstruction *>
+	(G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+      if(geometry->GetNumberOfDetectors() > 1){
+	G4ExceptionDescription description;
+	description << "Response matrices are made for a single detector, but the array has "
+		    << geometry->GetNumberOfDetectors() << "; turn /RMatrix/response/matrixOutput off and use"
+		    << " the event output, which gives the light of every detector";
+	G4Exception("runAction::BeginOfRunAction()",
+		    "runAction-010",
+		    FatalException,
+		    description);
+      }
+    }
+
+    // The lean physics list has nothing to transport a neutron with
+    // above the HP data, so a source reaching beyond it is refused
+    // before any event is made.  The sources are shared by all threads
+    G4GeneralParticleSourceData *sources = G4GeneralParticleSourceData::Instance();
+    G4double energyLimit = PhysicsList::GetNeutronEnergyLimit();
+    if(IsMaster() and lightCollectionMap::GetMode() != lightCollectionMap::collectionCalibrate)
+      for(G4int i=0; i<sources->GetSourceVectorSize(); i++){
+	G4SingleParticleSource *source = sources->GetCurrentSource(i);
+	if(source->GetParticleDefinition() != G4Neutron::NeutronDefinition())
+	  continue;
+
+	G4double sourceMax = SourceEnergyMax(source->GetEneDist());
+	if(sourceMax <= energyLimit)
+	  continue;
+	G4ExceptionDescription description;
+	description << "Source " << i << " reaches " << G4BestUnit(sourceMax, "Energy")
+		    << ", above the " << G4BestUnit(energyLimit, "Energy")
+		    << " the lean physics list covers neutrons to; lower /gps/ene/max or use QGSP_BIC_HP";
+	G4Exception("runAction::BeginOfRunAction()",
+		    "runAction-009",
+		    FatalException,
+		    description);
+      }
+
+    if(!keepTallies)
+      G4AccumulableManager::Instance()->Reset();
+
+    runTimer.Start();
+
+    // Workers count their events into the monitor as they go
+    if(IsMaster())
+      progressMonitor::StartRun(aRun->GetNumberOfEventToBeProcessed(),
+				G4RunManager::GetRunManager()->GetNumberOfThreads());
+
+    if(IsMaster() and perEventSeeding)
+      G4cout << " Per-event seeding: run seed " << runSeed
+	     << ", first event " << eventOffset << G4endl;
 }
 
-void runAction::EndOfRunAction(const G4Run *)
+void runAction::EndOfRunAction(const G4Run *aRun)
 {
     G4cout << "\n *********** Run Finished ************"
     << G4endl;
-}
\ No newline at end of file
+
+    G4AccumulableManager::Instance()->Merge();
+
+    runTimer.Stop();
+    if(IsMaster())
+      progressMonitor::EndRun();
+
+    if(IsMaster()){
+      G4double runTime = runTimer.GetRealElapsed();
+      G4cout << " Run time: " << runTime << " s, "
+	     << aRun->GetNumberOfEvent() / std::max(runTime, 1e-9) << " events/s"
+	     << G4endl;
+    }
+
+    // The job reports the blocks once they are all done
+    if(IsMaster() and blockMode)
+      return;
+
+    if(IsMaster())
+      ReportTallies(aRun->GetNumberOfEvent());
+
+    if(IsMaster() and neutronResponseModel::GetMode() == neutronResponseModel::responseTrain){
+      G4String tableFile = neutronResponseModel::GetTableFile();
+      if(trainingTable.Write(tableFile))
+	G4cout << " Neutron response table written to " << tableFile << G4endl;
+      else
+	G4Exception("runAction::EndOfRunAction()",
+		    "runAction-001",
+		    JustWarning,
+		    "Could not write the neutron response table");
+    }
+
+    if(IsMaster() and lightCollectionMap::GetMode() == lightCollectionMap::collectionCalibrate){
+      G4String mapFile = lightCollectionMap::GetMapFile();
+      if(calibrationMap.Write(mapFile))
+	G4cout << " Light collection map written to " << mapFile << G4endl;
+      else
+	G4Exception("runAction::EndOfRunAction()",
+		    "runAction-002",
+		    JustWarning,
+		    "Could not write the light collection map");
+    }
+
+    if(IsMaster() and neutronResponseModel::GetMode() == neutronResponseModel::responseCompare)
+      ReportResponseComparison();
+
+    if(IsMaster() and stepProfile::IsEnabled()){
+      profile.Print(stepProfile::GetReportLength());
+      G4String profileFile = stepProfile::GetFileName();
+      if(profile.Write(profileFile))
+	G4cout << " Step profile written to " << profileFile << G4endl;
+      else
+	G4Exception("runAction::EndOfRunAction()",
+		    "runAction-003",
+		    JustWarning,
+		    "Could not write the step profile");
+    }
+
+    // Carry on the event numbering so the next run in this session
+    // draws fresh random streams rather than repeating this one
+    if(IsMaster())
+      eventOffset += aRun->GetNumberOfEventToBeProcessed();
+
+    if(IsMaster())
+      RMATRIX_TRACE_DUMP();
+}
+
+void runAction::ReportTallies(G4int nEvents)
+{
+  // Neutrons killed below the threshold could at most have deposited
+  // the kinetic energy they still carried.  Both are weighted, so the
+  // count need not be whole
+  if(nKilledNeutrons.GetValue() > 0.)
+    G4cout << " Neutrons killed below threshold: " << nKilledNeutrons.GetValue()
+	   << "\n Deposited energy bias (upper bound): "
+	   << G4BestUnit(killedNeutronEnergy.GetValue(), "Energy")
+	   << " in total, "
+	   << G4BestUnit(killedNeutronEnergy.GetValue() / std::max(nEvents, 1), "Energy")
+	   << " per event" << G4endl;
+
+  if(nCountedTracks.GetValue() > 0)
+    G4cout << " Tracks counted and killed by the stacking policy: "
+	   << nCountedTracks.GetValue() << G4endl;
+
+  if(matrixOutput)
+    WriteResponseMatrices();
+
+  if(arrayTally.GetNumberOfDetectors() > 1)
+    arrayTally.Print(nEvents);
+
+  // The source tally is binned like the matrices, whatever the range
+  // of the source; primaries beyond it cannot be reweighted
+  if((matrixOutput or eventAction::GetDataOutput()) and source.GetNumberOutside() > 0.){
+    G4ExceptionDescription description;
+    description << source.GetNumberOutside() << " primaries fell outside the matrix energy range ("
+		<< source.GetEnergyMin()/MeV << " - " << source.GetEnergyMax()/MeV
+		<< " MeV) and are not in the source tally or the matrices; widen it with /RMatrix/response/setEnergyBinning";
+    G4Exception("runAction::ReportTallies()",
+		"runAction-007",
+		JustWarning,
+		description);
+  }
+
+  // The event output needs the source density to be reweighted
+  if(eventAction::GetDataOutput()){
+    G4String sourceFile = FileStem(eventAction::GetOutputFileName(), false) + "_source.csv";
+    if(source.Write(sourceFile))
+      G4cout << " Source tally written to " << sourceFile << G4endl;
+  }
+}
+
+
+void runAction::BinTallies()
+{
+  const geometryConstruction *geometry = static_cast<const geometryConstruction *>
+    (G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+  if(arrayTally.GetNumberOfDetectors() != geometry->GetNumberOfDetectors())
+    arrayTally.SetNumberOfDetectors(geometry->GetNumberOfDetectors());
+  scintMaterial = geometry->GetDetectorMaterial(0)->GetName();
+
+  source.SetBinning(matrixEnergyBins, matrixEnergyMin, matrixEnergyMax);
+
+  if(matrixOutput){
+    neutronMatrix.SetBinning(matrixEnergyBins, matrixEnergyMin, matrixEnergyMax,
+			     matrixLightBins, matrixLightMax);
+    gammaMatrix.SetBinning(matrixEnergyBins, matrixEnergyMin, matrixEnergyMax,
+			   matrixLightBins, matrixLightMax);
+  }
+
+  if(matrixOutput and resolutionModel::GetMode() == resolutionModel::foldEvent){
+    neutronFolded.SetBinning(matrixEnergyBins, matrixEnergyMin, matrixEnergyMax,
+			     matrixLightBins, matrixLightMax);
+    gammaFolded.SetBinning(matrixEnergyBins, matrixEnergyMin, matrixEnergyMax,
+			   matrixLightBins, matrixLightMax);
+  }
+}
+
+
+std::vector<G4double> runAction::PackTallies() const
+{
+  std::vector<G4double> buffer = {nKilledNeutrons.GetValue(),
+				  killedNeutronEnergy.GetValue(),
+				  G4double(nCountedTracks.GetValue()),
+				  neutronLight.GetValue(),
+				  neutronLightViaGamma.GetValue()};
+  neutronMatrix.Pack(buffer);
+  gammaMatrix.Pack(buffer);
+  arrayTally.Pack(buffer);
+  source.Pack(buffer);
+  if(resolutionModel::GetMode() == resolutionModel::foldEvent){
+    neutronFolded.Pack(buffer);
+    gammaFolded.Pack(buffer);
+  }
+  return buffer;
+}
+
+
+void runAction::UnpackTallies(const std::vector<G4double> &buffer)
+{
+  nKilledNeutrons = buffer[0];
+  killedNeutronEnergy = buffer[1];
+  nCountedTracks = G4int(buffer[2] + 0.5);
+  neutronLight = buffer[3];
+  neutronLightViaGamma = buffer[4];
+
+  std::size_t position = 5;
+  position = neutronMatrix.Unpack(buffer, position);
+  position = gammaMatrix.Unpack(buffer, position);
+  position = arrayTally.Unpack(buffer, position);
+  position = source.Unpack(buffer, position);
+  if(resolutionModel::GetMode() == resolutionModel::foldEvent){
+    position = neutronFolded.Unpack(buffer, position);
+    gammaFolded.Unpack(buffer, position);
+  }
+}
+
+
+void runAction::AddNeutronEntry(G4double energy,
+				const G4ThreeVector &localPos, const G4ThreeVector &localDir,
+				G4double radius, G4double halfLength,
+				G4int species, G4double light, G4double weight)
+{
+  if(neutronResponseModel::GetMode() == neutronResponseModel::responseTrain){
+    G4int cell = trainingTable.FindCell(energy, localPos, localDir, radius, halfLength);
+    trainingTable.Fill(cell, species, light, weight);
+    return;
+  }
+
+  // Compare mode: the same neutron, once as transported and once as
+  // the fast model would have drawn it
+  const neutronResponseTable *table = neutronResponseModel::GetTable();
+  if(table == nullptr)
+    return;
+  G4int cell = table->FindCell(energy, localPos, localDir, radius, halfLength);
+  if(cell < 0 or table->IsEmpty(cell))
+    return;
+
+  G4int fastSpecies;
+  G4double fastLight = G4int(table->Sample(cell, fastSpecies) + 0.5);
+  fullResponse.Fill(energy, light, weight);
+  fastResponse.Fill(energy, fastLight, weight);
+}
+
+
+void runAction::AddResponse(G4bool gamma, G4double energy, G4double light,
+			    G4double lightViaGamma, G4double weight)
+{
+  if(resolutionModel::GetMode() == resolutionModel::foldEvent)
+    (gamma ? gammaFolded : neutronFolded).Fill(energy, resolutionModel::Smear(scintMaterial, light), weight);
+
+  if(gamma){
+    gammaMatrix.Fill(energy, light, weight);
+    return;
+  }
+
+  neutronMatrix.Fill(energy, light, weight);
+  neutronLight += light*weight;
+  neutronLightViaGamma += lightViaGamma*weight;
+}
+
+
+void runAction::WriteResponseMatrices()
+{
+  RMATRIX_TRACE_SCOPE("runAction::WriteResponseMatrices");
+
+  // Only the species that were actually fired get a file
+  G4bool anyNeutrons = false, anyGammas = false;
+  for(G4int i=0; i<neutronMatrix.GetNumberOfEnergyBins(); i++){
+    anyNeutrons = anyNeutrons or neutronMatrix.GetColumnSum(i) > 0.;
+    anyGammas = anyGammas or gammaMatrix.GetColumnSum(i) > 0.;
+  }
+
+  if(anyNeutrons and neutronMatrix.Write(matrixFileName + "_neutron.csv"))
+    G4cout << " Neutron response matrix written to " << matrixFileName << "_neutron.csv" << G4endl;
+  if(anyGammas and gammaMatrix.Write(matrixFileName + "_gamma.csv"))
+    G4cout << " Gamma response matrix written to " << matrixFileName << "_gamma.csv" << G4endl;
+
+  // Folded matrices next to the unfolded ones, smeared event by event
+  // or folded now
+  if(resolutionModel::GetMode() != resolutionModel::foldOff)
+    for(G4bool gamma : {false, true}){
+      if(!(gamma ? anyGammas : anyNeutrons))
+	continue;
+      responseMatrix folded("foldedMatrix");
+      if(resolutionModel::GetMode() == resolutionModel::foldMatrix)
+	resolutionModel::Fold(scintMaterial, gamma ? gammaMatrix : neutronMatrix, folded);
+      const responseMatrix &written = (resolutionModel::GetMode() == resolutionModel::foldEvent) ?
+	(gamma ? gammaFolded : neutronFolded) : folded;
+      G4String fileName = matrixFileName + (gamma ? "_gamma" : "_neutron") + "_folded.csv";
+      if(written.Write(fileName))
+	G4cout << " Matrix folded with the resolution of " << scintMaterial
+	       << " written to " << fileName << G4endl;
+    }
+
+  if(source.Write(matrixFileName + "_source.csv"))
+    G4cout << " Source tally written to " << matrixFileName << "_source.csv" << G4endl;
+
+  for(const G4String &targetFile : targetSpectra){
+    spectrumReweighter reweighter;
+    if(!reweighter.ReadTarget(targetFile)){
+      G4Exception("runAction::WriteResponseMatrices()",
+		  "runAction-004",
+		  JustWarning,
+		  ("Could not read the target spectrum " + targetFile).c_str());
+      continue;
+    }
+
+    for(G4bool gamma : {false, true}){
+      if(!(gamma ? anyGammas : anyNeutrons))
+	continue;
+      responseMatrix weighted("weightedMatrix");
+      if(!reweighter.SetSource(source, gamma)
+	 or !reweighter.Reweight(gamma ? gammaMatrix : neutronMatrix, weighted))
+	continue;
+      G4String fileName = matrixFileName + (gamma ? "_gamma_" : "_neutron_")
+	+ FileStem(targetFile, true) + ".csv";
+      if(weighted.Write(fileName))
+	G4cout << " Matrix reweighted to " << targetFile << " written to " << fileName << G4endl;
+    }
+  }
+
+  if(neutronLight.GetValue() > 0. and neutronLightViaGamma.GetValue() > 0.)
+    G4cout << " Fraction of the neutron light made through gammas: "
+	   << neutronLightViaGamma.GetValue() / neutronLight.GetValue() << G4endl;
+}
+
+
+void runAction::ReportResponseComparison()
+{
+  G4cout << "\n Fast neutron response vs full transport (per energy column):\n"
+	 << "   E [MeV]    entries    chi2/ndf   KS" << G4endl;
+
+  G4double energyWidth = (fullResponse.GetEnergyMax() - fullResponse.GetEnergyMin())
+    / fullResponse.GetNumberOfEnergyBins();
+  for(G4int i=0; i<fullResponse.GetNumberOfEnergyBins(); i++){
+    G4double chi2 = fullResponse.ColumnChiSquare(fastResponse, i);
+    if(chi2 < 0.)
+      continue;
+    G4cout << "   " << std::setw(7) << (fullResponse.GetEnergyMin() + (i+0.5)*energyWidth)/MeV
+	   << "  " << std::setw(9) << fullResponse.GetColumnSum(i)
+	   << "  " << std::setw(9) << chi2
+	   << "  " << fullResponse.ColumnKSDistance(fastResponse, i) << G4endl;
+  }
+
+  G4String tableFile = neutronResponseModel::GetTableFile();
+  fullResponse.Write(tableFile + "_full.csv");
+  fastResponse.Write(tableFile + "_fast.csv");
+  G4cout << " Response matrices written to " << tableFile << "_full.csv and "
+	 << tableFile << "_fast.csv" << G4endl;
+}
+
+
+void runAction::SeedEvent(G4int eventID)
+{
+  if(!perEventSeeding)
+    return;
+
+  std::uint64_t globalEvent = std::uint64_t(eventOffset) + std::uint64_t(eventID);
+  std::uint64_t state = SplitMix64(std::uint64_t(runSeed)) ^ globalEvent;
+
+  // Four positive 31-bit seeds, zero terminated as CLHEP expects
+  long seeds[5];
+  for(G4int i=0; i<4; i++){
+    state = SplitMix64(state);
+    seeds[i] = long(state >> 33) + 1;
+  }
+  seeds[4] = 0;
+
+  G4Random::setTheSeeds(seeds);
+}
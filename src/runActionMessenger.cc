@@ -0,0 +1,178 @@
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithALongInt.hh"
+#include "G4UIcommand.hh"
+#include "G4UIparameter.hh"
+
+#include <sstream>
+
+#include "runAction.hh"
+#include "runActionMessenger.hh"
+
+// runActionMessenger is how the user can change the run-level settings
+// in runAction at runtime, e.g. to re-run a single event out of a
+// large production by setting its seed and event number.
+
+runActionMessenger::runActionMessenger(runAction *theRunAction)
+  : RA(theRunAction)
+{
+  randomDir = new G4UIdirectory("/RMatrix/random/", false);
+  randomDir -> SetGuidance("Per-event random number seeding");
+
+  // Command will let the user set the seed shared by all events
+  seedCommand = new G4UIcmdWithALongInt("/RMatrix/random/setRunSeed",this);
+  seedCommand -> SetGuidance("Set the run seed that every event seed is derived from");
+  seedCommand -> SetParameterName("seed",false);
+  seedCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  seedCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user start the event numbering anywhere, to
+  // run one shard of a larger job or re-run a single event
+  offsetCommand = new G4UIcmdWithALongInt("/RMatrix/random/setEventOffset",this);
+  offsetCommand -> SetGuidance("Set the global number of the next event to be run");
+  offsetCommand -> SetParameterName("offset",false);
+  offsetCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  offsetCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user turn per-event seeding 'on' or 'off'
+  seedingCommand = new G4UIcmdWithAString("/RMatrix/random/perEventSeeding",this);
+  seedingCommand -> SetGuidance("Reseed every event from (run seed, event number)");
+  seedingCommand -> SetParameterName("choice",true);
+  seedingCommand -> SetDefaultValue("on");
+  seedingCommand -> SetCandidates("on off");
+  seedingCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  seedingCommand -> SetToBeBroadcasted(false);
+
+  responseDir = new G4UIdirectory("/RMatrix/response/", false);
+  responseDir -> SetGuidance("Response matrices accumulated over the run");
+
+  // Command will let the user turn the response matrices 'on' or 'off'
+  matrixCommand = new G4UIcmdWithAString("/RMatrix/response/matrixOutput",this);
+  matrixCommand -> SetGuidance("Write the neutron and gamma response matrices at the end of each run");
+  matrixCommand -> SetGuidance("Only for a single detector; runs with a detector array are refused");
+  matrixCommand -> SetParameterName("choice",true);
+  matrixCommand -> SetDefaultValue("on");
+  matrixCommand -> SetCandidates("on off");
+  matrixCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  matrixCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user name the matrix files
+  matrixFileCommand = new G4UIcmdWithAString("/RMatrix/response/setFileName",this);
+  matrixFileCommand -> SetGuidance("Set the base name of the matrix files (<name>_neutron.csv, <name>_gamma.csv)");
+  matrixFileCommand -> SetParameterName("fileName",false);
+  matrixFileCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  matrixFileCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user set the primary energy bins
+  energyBinningCommand = new G4UIcommand("/RMatrix/response/setEnergyBinning",this);
+  energyBinningCommand -> SetGuidance("Set the primary energy bins of the response matrices");
+
+  G4UIparameter *nEnergyParam = new G4UIparameter("nBins",'i',false);
+  nEnergyParam -> SetParameterRange("nBins>0");
+  energyBinningCommand -> SetParameter(nEnergyParam);
+
+  G4UIparameter *eMinParam = new G4UIparameter("eMin",'d',false);
+  eMinParam -> SetParameterRange("eMin>=0.");
+  energyBinningCommand -> SetParameter(eMinParam);
+
+  G4UIparameter *eMaxParam = new G4UIparameter("eMax",'d',false);
+  eMaxParam -> SetParameterRange("eMax>0.");
+  energyBinningCommand -> SetParameter(eMaxParam);
+
+  G4UIparameter *unitParam = new G4UIparameter("unit",'s',true);
+  unitParam -> SetDefaultUnit("MeV");
+  energyBinningCommand -> SetParameter(unitParam);
+
+  energyBinningCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  energyBinningCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user set the light bins
+  lightBinningCommand = new G4UIcommand("/RMatrix/response/setLightBinning",this);
+  lightBinningCommand -> SetGuidance("Set the number of light bins and the photon count of the last one");
+
+  G4UIparameter *nLightParam = new G4UIparameter("nBins",'i',false);
+  nLightParam -> SetParameterRange("nBins>0");
+  lightBinningCommand -> SetParameter(nLightParam);
+
+  G4UIparameter *lightMaxParam = new G4UIparameter("lightMax",'d',false);
+  lightMaxParam -> SetParameterRange("lightMax>0.");
+  lightBinningCommand -> SetParameter(lightMaxParam);
+
+  lightBinningCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  lightBinningCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user have the matrices reweighted to another
+  // incident spectrum
+  addTargetCommand = new G4UIcmdWithAString("/RMatrix/response/addTargetSpectrum",this);
+  addTargetCommand -> SetGuidance("Also write the matrices reweighted to the spectrum in this file");
+  addTargetCommand -> SetGuidance("Lines of 'energy[MeV] intensity'; see spectrumReweighter.hh");
+  addTargetCommand -> SetGuidance("Written as <name>_neutron_<spectrum>.csv and <name>_gamma_<spectrum>.csv");
+  addTargetCommand -> SetParameterName("fileName",false);
+  addTargetCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  addTargetCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user drop the target spectra
+  clearTargetsCommand = new G4UIcommand("/RMatrix/response/clearTargetSpectra",this);
+  clearTargetsCommand -> SetGuidance("Stop reweighting the matrices");
+  clearTargetsCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  clearTargetsCommand -> SetToBeBroadcasted(false);
+}
+
+runActionMessenger::~runActionMessenger()
+{
+  delete clearTargetsCommand;
+  delete addTargetCommand;
+  delete lightBinningCommand;
+  delete energyBinningCommand;
+  delete matrixFileCommand;
+  delete matrixCommand;
+  delete responseDir;
+  delete seedingCommand;
+  delete offsetCommand;
+  delete seedCommand;
+  delete randomDir;
+}
+
+
+void runActionMessenger::SetNewValue(G4UIcommand *command,
+				     G4String newValue)
+{
+  if(command == seedCommand)
+    RA -> SetRunSeed(seedCommand->GetNewLongIntValue(newValue));
+
+  if(command == offsetCommand)
+    RA -> SetEventOffset(offsetCommand->GetNewLongIntValue(newValue));
+
+  if(command == seedingCommand)
+    RA -> SetPerEventSeeding(newValue);
+
+  if(command == matrixCommand)
+    RA -> SetMatrixOutput(newValue);
+
+  if(command == matrixFileCommand)
+    RA -> SetMatrixFileName(newValue);
+
+  if(command == addTargetCommand)
+    RA -> AddTargetSpectrum(newValue);
+
+  if(command == clearTargetsCommand)
+    RA -> ClearTargetSpectra();
+
+  if(command == energyBinningCommand){
+    std::istringstream is(newValue);
+    G4int nBins;
+    G4double eMin, eMax;
+    G4String unit;
+    is >> nBins >> eMin >> eMax >> unit;
+    G4double unitValue = G4UIcommand::ValueOf(unit);
+    RA -> SetMatrixEnergyBinning(nBins, eMin*unitValue, eMax*unitValue);
+  }
+
+  if(command == lightBinningCommand){
+    std::istringstream is(newValue);
+    G4int nBins;
+    G4double lightMax;
+    is >> nBins >> lightMax;
+    RA -> SetMatrixLightBinning(nBins, lightMax);
+  }
+}
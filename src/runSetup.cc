@@ -0,0 +1,59 @@
+#include "G4RunManager.hh"
+#include "G4RunManagerFactory.hh"
+#include "G4UImanager.hh"
+
+#include "runSetup.hh"
+#include "geometryConstruction.hh"
+#include "actionInitialization.hh"
+#include "workerInitialization.hh"
+#include "PhysicsList.hh"
+
+G4RunManager *runSetup::CreateRunManager(G4int nThreads, const G4String &physics, G4int emOption)
+{
+  // More than one thread needs the multithreaded manager.  Workers are
+  // pinned as they start, before they allocate anything
+  G4RunManager *runManager = nullptr;
+  if(nThreads > 1){
+    runManager = G4RunManagerFactory::CreateRunManager(G4RunManagerType::MT);
+    runManager -> SetNumberOfThreads(nThreads);
+    runManager -> SetUserInitialization(new workerInitialization);
+  }
+  else{
+    runManager = G4RunManagerFactory::CreateRunManager(G4RunManagerType::Serial);
+    if(workerInitialization::IsPinning())
+      workerInitialization::PlaceMainThread();
+  }
+
+  runManager -> SetUserInitialization(new geometryConstruction);
+
+  // The physics list has to be chosen before it is handed over, which
+  // is before any macro runs.  It lives as long as the program, for
+  // its messenger
+  PhysicsList *physicsList = new PhysicsList();
+  if(physics != "")
+    G4UImanager::GetUIpointer() -> ApplyCommand("/RMatrix/physics/list " + physics);
+  if(emOption >= 0)
+    G4UImanager::GetUIpointer() -> ApplyCommand("/RMatrix/physics/emOption " + std::to_string(emOption));
+  runManager -> SetUserInitialization(physicsList->GetPhysicsList());
+
+  // One set of user actions per worker thread
+  runManager -> SetUserInitialization(new actionInitialization);
+
+  return runManager;
+}
+
+
+std::vector<G4String> runSetup::PlaneSourceCommands()
+{
+  return {
+    "/gps/pos/type Plane",
+    "/gps/pos/shape Square",
+    "/gps/pos/centre 0. 0. -49. cm",
+    "/gps/pos/halfx 0.1 cm",
+    "/gps/pos/halfy 0.1 cm",
+    "/gps/direction 0. 0. +1.",
+    "/gps/ene/type Lin",
+    "/gps/ene/gradient 0",
+    "/gps/ene/intercept 1"
+  };
+}
@@ -0,0 +1,156 @@
+#include "G4SystemOfUnits.hh"
+
+#include "sourceTally.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+sourceTally::sourceTally(const G4String &name)
+  : G4VAccumulable(name),
+    nBins(100), energyMin(0.), energyMax(10.*MeV),
+    nEvents(0.), nOutside(0.)
+{
+  counts.assign(2*nBins, 0.);
+}
+
+
+sourceTally::~sourceTally()
+{;}
+
+
+void sourceTally::SetBinning(G4int n, G4double eMin, G4double eMax)
+{
+  nBins = n;
+  energyMin = eMin;
+  energyMax = eMax;
+
+  nEvents = 0.;
+  nOutside = 0.;
+  counts.assign(2*nBins, 0.);
+}
+
+
+void sourceTally::Fill(G4bool gamma, G4double energy)
+{
+  if(energy < energyMin or energy >= energyMax){
+    nOutside += 1.;
+    return;
+  }
+
+  G4int bin = G4int((energy - energyMin)/(energyMax - energyMin)*nBins);
+  counts[gamma ? nBins + bin : bin] += 1.;
+}
+
+
+void sourceTally::Merge(const G4VAccumulable &other)
+{
+  const sourceTally &otherTally = static_cast<const sourceTally &>(other);
+  if(otherTally.counts.size() != counts.size())
+    return;
+
+  nEvents += otherTally.nEvents;
+  nOutside += otherTally.nOutside;
+  for(std::size_t i=0; i<counts.size(); i++)
+    counts[i] += otherTally.counts[i];
+}
+
+
+void sourceTally::Reset()
+{
+  nEvents = 0.;
+  nOutside = 0.;
+  std::fill(counts.begin(), counts.end(), 0.);
+}
+
+
+G4double sourceTally::GetTotal(G4bool gamma) const
+{
+  G4double total = 0.;
+  for(G4int i=0; i<nBins; i++)
+    total += GetBinCount(gamma, i);
+  return total;
+}
+
+
+G4bool sourceTally::Write(const G4String &fileName) const
+{
+  std::ofstream output(fileName, std::ofstream::trunc);
+  if(!output.is_open())
+    return false;
+
+  G4double width = (energyMax - energyMin)/nBins;
+
+  output << "Events;" << nEvents << "\n"
+	 << "Species;EnergyLow;EnergyHigh;Primaries" << std::endl;
+  for(G4bool gamma : {false, true})
+    for(G4int i=0; i<nBins; i++)
+      output << (gamma ? "gamma" : "neutron") << ";"
+	     << (energyMin + i*width)/MeV << ";" << (energyMin + (i+1)*width)/MeV << ";"
+	     << GetBinCount(gamma, i) << std::endl;
+
+  return true;
+}
+
+
+G4bool sourceTally::Read(const G4String &fileName)
+{
+  std::ifstream input(fileName);
+  if(!input.is_open())
+    return false;
+
+  std::string line;
+  std::getline(input, line);
+  if(line.compare(0, 7, "Events;") != 0)
+    return false;
+  G4double events = std::stod(line.substr(7));
+  std::getline(input, line);
+
+  // The binning is that of the file; the neutron bins come first
+  std::vector<G4double> lows, highs, values;
+  std::vector<G4bool> species;
+  while(std::getline(input, line)){
+    if(line.empty())
+      continue;
+    for(char &c : line)
+      if(c == ';') c = ' ';
+
+    std::istringstream is(line);
+    std::string name;
+    G4double eLow, eHigh, value;
+    if(!(is >> name >> eLow >> eHigh >> value))
+      return false;
+    species.push_back(name == "gamma");
+    lows.push_back(eLow*MeV);
+    highs.push_back(eHigh*MeV);
+    values.push_back(value);
+  }
+
+  std::size_t n = values.size()/2;
+  if(n == 0 or values.size() != 2*n or species[0] or !species[n])
+    return false;
+
+  SetBinning(G4int(n), lows[0], highs[n-1]);
+  nEvents = events;
+  counts = values;
+  return true;
+}
+
+
+void sourceTally::Pack(std::vector<G4double> &buffer) const
+{
+  buffer.push_back(nEvents);
+  buffer.push_back(nOutside);
+  buffer.insert(buffer.end(), counts.begin(), counts.end());
+}
+
+
+std::size_t sourceTally::Unpack(const std::vector<G4double> &buffer, std::size_t position)
+{
+  nEvents = buffer[position++];
+  nOutside = buffer[position++];
+  std::copy(buffer.begin() + position, buffer.begin() + position + counts.size(), counts.begin());
+  return position + counts.size();
+}
@@ -0,0 +1,140 @@
+#include "G4SystemOfUnits.hh"
+
+#include "spectrumReweighter.hh"
+#include "sourceTally.hh"
+#include "responseMatrix.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+spectrumReweighter::spectrumReweighter()
+  : targetNorm(0.),
+    nSourceBins(0), sourceMin(0.), sourceMax(0.)
+{;}
+
+
+spectrumReweighter::~spectrumReweighter()
+{;}
+
+
+G4bool spectrumReweighter::ReadTarget(const G4String &fileName)
+{
+  std::ifstream input(fileName);
+  if(!input.is_open())
+    return false;
+
+  targetEnergies.clear();
+  targetValues.clear();
+
+  std::string line;
+  while(std::getline(input, line)){
+    if(line.empty() or line[0] == '#')
+      continue;
+    for(char &c : line)
+      if(c == ';' or c == ',' or c == '\t') c = ' ';
+
+    std::istringstream is(line);
+    G4double energy, value;
+    if(!(is >> energy >> value))
+      continue;
+    if(!targetEnergies.empty() and energy*MeV <= targetEnergies.back())
+      return false;
+    targetEnergies.push_back(energy*MeV);
+    targetValues.push_back(std::max(value, 0.));
+  }
+
+  return targetEnergies.size() >= 2;
+}
+
+
+G4bool spectrumReweighter::SetSource(const sourceTally &source, G4bool gamma)
+{
+  nSourceBins = source.GetNumberOfBins();
+  sourceMin = source.GetEnergyMin();
+  sourceMax = source.GetEnergyMax();
+
+  G4double total = source.GetTotal(gamma);
+  sourceFractions.assign(nSourceBins, 0.);
+  if(total > 0.)
+    for(G4int i=0; i<nSourceBins; i++)
+      sourceFractions[i] = source.GetBinCount(gamma, i)/total;
+
+  targetNorm = TargetIntegral(sourceMin, sourceMax);
+  return total > 0. and targetNorm > 0.;
+}
+
+
+G4double spectrumReweighter::Weight(G4double energy) const
+{
+  if(energy < sourceMin or energy >= sourceMax or targetNorm <= 0.)
+    return 0.;
+
+  G4double width = (sourceMax - sourceMin)/nSourceBins;
+  G4int bin = G4int((energy - sourceMin)/width);
+  if(sourceFractions[bin] <= 0.)
+    return 0.;
+
+  // Both densities per unit energy
+  return (Target(energy)/targetNorm) / (sourceFractions[bin]/width);
+}
+
+
+G4double spectrumReweighter::BinWeight(G4int bin) const
+{
+  if(bin < 0 or bin >= nSourceBins or sourceFractions[bin] <= 0. or targetNorm <= 0.)
+    return 0.;
+
+  G4double width = (sourceMax - sourceMin)/nSourceBins;
+  G4double eLow = sourceMin + bin*width;
+  return (TargetIntegral(eLow, eLow + width)/targetNorm) / sourceFractions[bin];
+}
+
+
+G4bool spectrumReweighter::Reweight(const responseMatrix &in, responseMatrix &out) const
+{
+  G4double width = (sourceMax - sourceMin)/nSourceBins;
+  if(in.GetNumberOfEnergyBins() != nSourceBins
+     or std::abs(in.GetEnergyMin() - sourceMin) > 1e-6*width
+     or std::abs(in.GetEnergyMax() - sourceMax) > 1e-6*width)
+    return false;
+
+  out.SetBinning(in.GetNumberOfEnergyBins(), in.GetEnergyMin(), in.GetEnergyMax(),
+		 in.GetNumberOfLightBins(), in.GetLightMax());
+  out.Merge(in);
+  for(G4int i=0; i<nSourceBins; i++)
+    out.ScaleColumn(i, BinWeight(i));
+  return true;
+}
+
+
+G4double spectrumReweighter::Target(G4double energy) const
+{
+  if(targetEnergies.empty() or energy < targetEnergies.front() or energy > targetEnergies.back())
+    return 0.;
+
+  std::size_t k = std::upper_bound(targetEnergies.begin(), targetEnergies.end(), energy)
+    - targetEnergies.begin();
+  if(k >= targetEnergies.size())
+    return targetValues.back();
+
+  G4double fraction = (energy - targetEnergies[k-1])/(targetEnergies[k] - targetEnergies[k-1]);
+  return targetValues[k-1] + fraction*(targetValues[k] - targetValues[k-1]);
+}
+
+
+G4double spectrumReweighter::TargetIntegral(G4double eLow, G4double eHigh) const
+{
+  // Exact for the piecewise linear spectrum: trapezoids over the part
+  // of every segment inside [eLow, eHigh]
+  G4double integral = 0.;
+  for(std::size_t k=1; k<targetEnergies.size(); k++){
+    G4double low = std::max(eLow, targetEnergies[k-1]);
+    G4double high = std::min(eHigh, targetEnergies[k]);
+    if(low < high)
+      integral += 0.5*(high - low)*(Target(low) + Target(high));
+  }
+  return integral;
+}
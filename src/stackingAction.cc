@@ -2,60 +2,378 @@
 #include "G4ParticleTypes.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4VProcess.hh"
+#include "G4RunManager.hh"
+#include "G4LogicalVolume.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4VSolid.hh"
+#include "G4VTouchable.hh"
+#include "G4NavigationHistory.hh"
+#include "G4AffineTransform.hh"
+#include "G4Material.hh"
+#include "G4MaterialPropertiesTable.hh"
+#include "G4Poisson.hh"
+#include "G4ParticleTable.hh"
+#include "G4UnitsTable.hh"
+#include "Randomize.hh"
 
 #include "stackingAction.hh"
+#include "stackingActionMessenger.hh"
+#include "geometryConstruction.hh"
+#include "runAction.hh"
 #include "eventAction.hh"
+#include "neutronResponseModel.hh"
+#include "neutronResponseTable.hh"
+#include "lightCollectionMap.hh"
+#include "traceRecorder.hh"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
-stackingAction::stackingAction(eventAction *currentEvent)
-    : evtAction(currentEvent)
-{;}
+stackingAction::stackingAction(runAction *currentRun, eventAction *currentEvent)
+    : rnAction(currentRun),
+      evtAction(currentEvent),
+      localDeposition(false),
+      rangeSafetyFactor(2.),
+      trackGammas(false)
+{
+  ionPolicy.classify = nullptr;
+
+  // The detector construction is shared by all threads and keeps
+  // track of the volumes of the current geometry
+  geometry = static_cast<const geometryConstruction *>
+    (G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+
+  // Create a messenger to allow user commands
+  stackMessenger = new stackingActionMessenger(this);
+}
 
 
 stackingAction::~stackingAction()
-{;}
+{
+  delete stackMessenger;
+}
 
 
 G4ClassificationOfNewTrack stackingAction::ClassifyNewTrack(const G4Track* currentTrack)
 {
-  // Get particle definiton
-  G4ParticleDefinition *PDef = currentTrack->GetDefinition();
-
-    // Add count to tally of photons created
-  if(PDef == G4OpticalPhoton::OpticalPhotonDefinition())
-    evtAction->AddPhotonCreated(1);
-  else if (PDef == G4Neutron::NeutronDefinition()){
-    G4double PKE = 0;
-    PKE =+ currentTrack->GetKineticEnergy()/keV;
-    evtAction->SetEnergy(PKE);
-  }
-
-  //if (PKE > evtAction->GetEnergy() and PDef == G4Proton::ProtonDefinition()){
-  //  G4String CreatorProcess = currentTrack->GetCreatorProcess()->GetProcessName();
-  //  G4cout <<PDef->GetParticleName()<<"; "<<PKE<<";"<<evtAction->GetEnergy()<<";"<<CreatorProcess<<G4endl;
-  //}
- 
-  // Set this flag to drastically improve CPU when using optical
-  // physics, provided the spectra from photon creation is sufficient
-  G4bool killOpticalPhotons = true;
-
-  // Set this flag to kill gammas in order to mimick
-  // post-processing of experimental data using PSD.
-  // This will also kill gammas from the PGA
-  G4bool killSecondaryGammas = true;
-  
-  if(killOpticalPhotons or killSecondaryGammas){
-
-    if(killOpticalPhotons and PDef == G4OpticalPhoton::OpticalPhotonDefinition())
-      return fKill;
-
-    else if(killSecondaryGammas and PDef == G4Gamma::GammaDefinition())
-      return fKill;
-    
-    else
+  RMATRIX_TRACE_SCOPE("stackingAction::ClassifyNewTrack");
+
+  const stackPolicy &policy = GetPolicy(currentTrack->GetDefinition());
+
+  // In a mixed field, find out which primary the track descends from
+  G4int origin = trackGammas ? evtAction->TagTrack(currentTrack) : 0;
+
+  if(policy.special and HandleSpecial(currentTrack))
+    return fKill;
+
+  return (this->*policy.classify)(currentTrack, policy, origin);
+}
+
+
+template<G4bool OpticalPhoton, G4bool CountOnly, G4bool Threshold>
+G4ClassificationOfNewTrack stackingAction::Classify(const G4Track *currentTrack,
+						    const stackPolicy &policy,
+						    G4int origin)
+{
+  if(Threshold and currentTrack->GetKineticEnergy() < policy.energyThreshold)
+    return fKill;
+
+  // Add count to tally of photons created.  Photons are born with the
+  // touchable of the step that made them, so its copy number is the
+  // detector of the array they belong to
+  if(OpticalPhoton){
+    const G4VTouchable *touchable = currentTrack->GetTouchable();
+    evtAction->AddPhotonCreated(1, currentTrack->GetWeight(), touchable ? touchable->GetCopyNumber() : 0, origin);
+
+    // Calibration photons of the light collection map are the primaries
+    // and have to be tracked to the readout face
+    if(currentTrack->GetParentID() == 0
+       and lightCollectionMap::GetMode() == lightCollectionMap::collectionCalibrate)
       return fUrgent;
   }
-  else
-    return fUrgent;
+  else if(CountOnly)
+    rnAction->AddCountedTrack();
+
+  return CountOnly ? fKill : policy.classification;
+}
+
+
+G4bool stackingAction::HandleSpecial(const G4Track *currentTrack)
+{
+  const G4ParticleDefinition *PDef = currentTrack->GetDefinition();
+
+  if(PDef == G4Neutron::NeutronDefinition()){
+    evtAction->SetEnergy(currentTrack->GetKineticEnergy()/keV);
+    return false;
+  }
+
+  // Tag the event with the first recoil made by the entering primary
+  // neutron, for the response model tables
+  if(neutronResponseModel::IsRecordingEntries() and currentTrack->GetParentID() == 1
+     and evtAction->HasNeutronEntry()){
+    if(PDef == G4Proton::ProtonDefinition())
+      evtAction->SetRecoilSpecies(neutronResponseTable::protonRecoil);
+    else if(PDef == G4Alpha::AlphaDefinition())
+      evtAction->SetRecoilSpecies(neutronResponseTable::alphaRecoil);
+    else if(PDef->IsGeneralIon())
+      evtAction->SetRecoilSpecies(neutronResponseTable::ionRecoil);
+    else
+      evtAction->SetRecoilSpecies(neutronResponseTable::otherRecoil);
+  }
+
+  // Short range recoil ions and alphas: deposit their light on the spot
+  return localDeposition and currentTrack->GetParentID() > 0
+    and (PDef->IsGeneralIon() or PDef == G4Alpha::AlphaDefinition() or PDef == G4He3::He3Definition())
+    and DepositLocally(currentTrack);
+}
+
+
+const stackingAction::stackPolicy &stackingAction::BuildPolicy(const G4ParticleDefinition *PDef)
+{
+  G4int index = PDef->GetParticleDefinitionID();
+
+  // Ions made on the fly may have no index of their own, and all of
+  // them share the GenericIon settings anyway
+  stackPolicy *policy = &ionPolicy;
+  if(index >= 0){
+    if(index >= G4int(policyTable.size())){
+      stackPolicy empty = {fUrgent, false, 0., false, nullptr};
+      policyTable.resize(index + 1, empty);
+    }
+    policy = &policyTable[index];
+  }
+  else if(ionPolicy.classify)
+    return ionPolicy;
+
+  *policy = DefaultPolicy(PDef);
+
+  G4String name = PDef->IsGeneralIon() ? G4String("GenericIon") : PDef->GetParticleName();
+  std::map<G4String, stackPolicy>::const_iterator user = userPolicies.find(name);
+  if(user != userPolicies.end()){
+    policy->classification = user->second.classification;
+    policy->countOnly = user->second.countOnly;
+    policy->energyThreshold = user->second.energyThreshold;
+  }
+
+  SelectClassifier(*policy, PDef);
+  return *policy;
+}
+
+
+stackingAction::stackPolicy stackingAction::DefaultPolicy(const G4ParticleDefinition *PDef) const
+{
+  stackPolicy policy = {fUrgent, false, 0., false, nullptr};
+
+  // Count optical photons and kill them: this drastically improves
+  // CPU when using optical physics, provided the spectra from photon
+  // creation is sufficient
+  if(PDef == G4OpticalPhoton::OpticalPhotonDefinition()){
+    policy.classification = fKill;
+    policy.countOnly = true;
+  }
+
+  // Kill gammas in order to mimick post-processing of experimental
+  // data using PSD.  This will also kill gammas from the PGA
+  else if(PDef == G4Gamma::GammaDefinition() and not trackGammas)
+    policy.classification = fKill;
+
+  return policy;
+}
+
+
+void stackingAction::SelectClassifier(stackPolicy &policy, const G4ParticleDefinition *PDef) const
+{
+  policy.special = (PDef == G4Neutron::NeutronDefinition() or PDef == G4Proton::ProtonDefinition()
+		    or PDef == G4Deuteron::DeuteronDefinition() or PDef == G4Triton::TritonDefinition()
+		    or PDef == G4He3::He3Definition() or PDef == G4Alpha::AlphaDefinition()
+		    or PDef->IsGeneralIon());
+
+  G4bool threshold = policy.energyThreshold > 0.;
+
+  if(PDef == G4OpticalPhoton::OpticalPhotonDefinition()){
+    if(policy.countOnly)
+      policy.classify = threshold ? &stackingAction::Classify<true, true, true>
+	: &stackingAction::Classify<true, true, false>;
+    else
+      policy.classify = threshold ? &stackingAction::Classify<true, false, true>
+	: &stackingAction::Classify<true, false, false>;
+  }
+  else{
+    if(policy.countOnly)
+      policy.classify = threshold ? &stackingAction::Classify<false, true, true>
+	: &stackingAction::Classify<false, true, false>;
+    else
+      policy.classify = threshold ? &stackingAction::Classify<false, false, true>
+	: &stackingAction::Classify<false, false, false>;
+  }
+}
+
+
+const G4ParticleDefinition *stackingAction::FindParticle(G4String particle) const
+{
+  return G4ParticleTable::GetParticleTable()->FindParticle(particle);
+}
+
+
+stackingAction::stackPolicy &stackingAction::UserPolicy(G4String particle)
+{
+  // The table is rebuilt from the defaults and user settings as
+  // tracks of each particle come along
+  policyTable.clear();
+  ionPolicy.classify = nullptr;
+
+  std::map<G4String, stackPolicy>::iterator user = userPolicies.find(particle);
+  if(user != userPolicies.end())
+    return user->second;
+
+  stackPolicy policy = {fUrgent, false, 0., false, nullptr};
+  const G4ParticleDefinition *PDef = FindParticle(particle);
+  if(PDef)
+    policy = DefaultPolicy(PDef);
+  return userPolicies[particle] = policy;
+}
+
+
+void stackingAction::SetTrackGammas(G4String onOff)
+{
+  if(onOff == "on") trackGammas = true;
+  if(onOff == "off") trackGammas = false;
+
+  // The gamma default depends on it
+  policyTable.clear();
+  ionPolicy.classify = nullptr;
+}
+
+
+void stackingAction::SetClassification(G4String particle, G4String classification)
+{
+  if(particle != "GenericIon" and FindParticle(particle) == nullptr){
+    G4Exception("stackingAction::SetClassification()",
+		"stackingAction-001",
+		JustWarning,
+		("Unknown particle " + particle + ", the stacking policy is unchanged").c_str());
+    return;
+  }
+
+  stackPolicy &policy = UserPolicy(particle);
+  if(classification == "urgent") policy.classification = fUrgent;
+  if(classification == "waiting") policy.classification = fWaiting;
+  if(classification == "kill") policy.classification = fKill;
+}
+
+
+void stackingAction::SetCountOnly(G4String particle, G4String onOff)
+{
+  if(particle != "GenericIon" and FindParticle(particle) == nullptr){
+    G4Exception("stackingAction::SetCountOnly()",
+		"stackingAction-001",
+		JustWarning,
+		("Unknown particle " + particle + ", the stacking policy is unchanged").c_str());
+    return;
+  }
+
+  stackPolicy &policy = UserPolicy(particle);
+  if(onOff == "on") policy.countOnly = true;
+  if(onOff == "off") policy.countOnly = false;
+}
+
+
+void stackingAction::SetEnergyThreshold(G4String particle, G4double threshold)
+{
+  if(particle != "GenericIon" and FindParticle(particle) == nullptr){
+    G4Exception("stackingAction::SetEnergyThreshold()",
+		"stackingAction-001",
+		JustWarning,
+		("Unknown particle " + particle + ", the stacking policy is unchanged").c_str());
+    return;
+  }
+
+  UserPolicy(particle).energyThreshold = threshold;
+}
+
+
+void stackingAction::PrintPolicies()
+{
+  G4cout << "\n Stacking policy (particles not listed are tracked as urgent):";
+  std::map<G4String, stackPolicy> listed = userPolicies;
+  if(listed.find("opticalphoton") == listed.end())
+    listed["opticalphoton"] = DefaultPolicy(G4OpticalPhoton::OpticalPhotonDefinition());
+  if(listed.find("gamma") == listed.end())
+    listed["gamma"] = DefaultPolicy(G4Gamma::GammaDefinition());
+
+  for(std::map<G4String, stackPolicy>::const_iterator it = listed.begin(); it != listed.end(); ++it){
+    G4String action = "urgent";
+    if(it->second.classification == fWaiting) action = "waiting";
+    if(it->second.classification == fKill) action = "kill";
+    G4cout << "\n   " << it->first << ": " << (it->second.countOnly ? G4String("count only") : action);
+    if(it->second.energyThreshold > 0.)
+      G4cout << ", killed below " << G4BestUnit(it->second.energyThreshold, "Energy");
+  }
+  G4cout << G4endl;
+}
+
+
+G4bool stackingAction::DepositLocally(const G4Track *currentTrack)
+{
+  // New tracks carry the touchable of the step that made them.  Its
+  // history gives the copy and the frame of the detector without a
+  // second navigator relocating the parameterised array, whose volume
+  // is shared with the one used for tracking
+  const G4VTouchable *touchable = currentTrack->GetTouchable();
+  if(touchable == nullptr or touchable->GetVolume() == nullptr
+     or touchable->GetVolume()->GetLogicalVolume() != geometry->GetScintVolume())
+    return false;
+
+  G4int copyNo = touchable->GetCopyNumber();
+  G4ThreeVector localPos = touchable->GetHistory()->GetTopTransform()
+    .TransformPoint(currentTrack->GetPosition());
+  const G4VSolid *cylinder = geometry->GetScintVolume()->GetSolid();
+  if(cylinder->Inside(localPos) == kOutside)
+    return false;
+
+  // Only scintillators with a light curve for this species qualify
+  const G4Material *material = geometry->GetDetectorMaterial(copyNo);
+  G4MaterialPropertiesTable *MPT = material->GetMaterialPropertiesTable();
+  if(MPT == nullptr)
+    return false;
+
+  const G4ParticleDefinition *PDef = currentTrack->GetDefinition();
+  G4MaterialPropertyVector *yieldVector = (PDef == G4Alpha::AlphaDefinition()) ?
+    MPT->GetProperty("ALPHASCINTILLATIONYIELD") : MPT->GetProperty("IONSCINTILLATIONYIELD");
+  G4double KE = currentTrack->GetKineticEnergy();
+  if(yieldVector == nullptr or KE > yieldVector->GetMaxEnergy())
+    return false;
+
+  // The particle must stop well clear of the cylinder's surface; the
+  // detector holds no daughters, so that is the nearest boundary
+  G4double range = emCalculator.GetRangeFromRestricteDEDX(KE, PDef, material);
+  if(range*rangeSafetyFactor >= cylinder->DistanceToOut(localPos))
+    return false;
+
+  // Sample the number of photons the same way G4Scintillation does
+  G4double meanPhotons = yieldVector->Value(KE);
+  G4double resolutionScale = MPT->ConstPropertyExists("RESOLUTIONSCALE") ?
+    MPT->GetConstProperty("RESOLUTIONSCALE") : 1.;
+  G4int nPhotons = 0;
+  if(meanPhotons > 10.){
+    G4double sigma = resolutionScale*std::sqrt(meanPhotons);
+    nPhotons = std::max(0, G4int(G4RandGauss::shoot(meanPhotons, sigma) + 0.5));
+  }
+  else if(meanPhotons > 0.)
+    nPhotons = G4int(G4Poisson(meanPhotons));
+
+  G4int origin = evtAction->GetTrackOrigin(currentTrack->GetTrackID());
+  if(nPhotons > 0)
+    evtAction->AddPhotonCreated(nPhotons, currentTrack->GetWeight(), copyNo, origin);
+
+  // All of it is emitted at the creation point
+  const lightCollectionMap *map = lightCollectionMap::GetMap();
+  if(nPhotons > 0 and map and lightCollectionMap::GetMode() == lightCollectionMap::collectionApply){
+    G4int nCollected = G4int(CLHEP::RandBinomial::shoot(nPhotons, map->GetProbability(localPos)));
+    if(nCollected > 0)
+      evtAction->AddPhotonCollected(nCollected, currentTrack->GetWeight(), copyNo, origin);
+  }
+
+  return true;
 }
@@ -0,0 +1,149 @@
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithADouble.hh"
+#include "G4UIcmdWithoutParameter.hh"
+#include "G4UIcommand.hh"
+#include "G4UIparameter.hh"
+
+#include <sstream>
+
+#include "stackingAction.hh"
+#include "stackingActionMessenger.hh"
+
+// stackingActionMessenger is how the user can change which new tracks
+// stackingAction lets through to be tracked.
+
+stackingActionMessenger::stackingActionMessenger(stackingAction *theStackingAction)
+  : SA(theStackingAction)
+{
+  // Creates a new directory where the commands will live
+  stackDir = new G4UIdirectory("/RMatrix/stack/");
+  stackDir -> SetGuidance("New track classification control");
+
+  // Command will let the user deposit short range ions on the spot
+  localCommand = new G4UIcmdWithAString("/RMatrix/stack/localDeposition",this);
+  localCommand -> SetGuidance("Deposit the light of short range recoil ions and alphas where they are created");
+  localCommand -> SetParameterName("choice",true);
+  localCommand -> SetDefaultValue("on");
+  localCommand -> SetCandidates("on off");
+  localCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  // Command will let the user set how far from a boundary that must be
+  safetyCommand = new G4UIcmdWithADouble("/RMatrix/stack/rangeSafetyFactor",this);
+  safetyCommand -> SetGuidance("Only deposit locally if range x factor is below the distance to the nearest boundary");
+  safetyCommand -> SetParameterName("factor",false);
+  safetyCommand -> SetRange("factor>=1.");
+  safetyCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  // Command will let the user keep gammas for a mixed neutron/gamma field
+  gammaCommand = new G4UIcmdWithAString("/RMatrix/stack/trackGammas",this);
+  gammaCommand -> SetGuidance("Track primary and secondary gammas and tag the light by primary species");
+  gammaCommand -> SetParameterName("choice",true);
+  gammaCommand -> SetDefaultValue("on");
+  gammaCommand -> SetCandidates("on off");
+  gammaCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  // Command will let the user choose what happens to new tracks of a particle
+  classificationCommand = new G4UIcommand("/RMatrix/stack/setClassification",this);
+  classificationCommand -> SetGuidance("Set the classification of new tracks of a particle");
+  classificationCommand -> SetGuidance("  particle: particle name, or GenericIon for all ions");
+  classificationCommand -> SetGuidance("  classification: urgent, waiting or kill");
+
+  G4UIparameter *particleParam = new G4UIparameter("particle",'s',false);
+  classificationCommand -> SetParameter(particleParam);
+
+  G4UIparameter *classificationParam = new G4UIparameter("classification",'s',false);
+  classificationParam -> SetParameterCandidates("urgent waiting kill");
+  classificationCommand -> SetParameter(classificationParam);
+
+  classificationCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  // Command will let the user count tracks of a particle without following them
+  countOnlyCommand = new G4UIcommand("/RMatrix/stack/countOnly",this);
+  countOnlyCommand -> SetGuidance("Count new tracks of a particle and kill them without tracking");
+  countOnlyCommand -> SetGuidance("Optical photons are counted in the light of the event");
+
+  G4UIparameter *countParticleParam = new G4UIparameter("particle",'s',false);
+  countOnlyCommand -> SetParameter(countParticleParam);
+
+  G4UIparameter *countParam = new G4UIparameter("choice",'s',true);
+  countParam -> SetDefaultValue("on");
+  countParam -> SetParameterCandidates("on off");
+  countOnlyCommand -> SetParameter(countParam);
+
+  countOnlyCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  // Command will let the user kill low energy tracks of a particle
+  thresholdCommand = new G4UIcommand("/RMatrix/stack/setEnergyThreshold",this);
+  thresholdCommand -> SetGuidance("Kill new tracks of a particle below a kinetic energy");
+  thresholdCommand -> SetGuidance("A threshold of zero turns it off");
+
+  G4UIparameter *thresholdParticleParam = new G4UIparameter("particle",'s',false);
+  thresholdCommand -> SetParameter(thresholdParticleParam);
+
+  G4UIparameter *thresholdParam = new G4UIparameter("threshold",'d',false);
+  thresholdParam -> SetParameterRange("threshold>=0.");
+  thresholdCommand -> SetParameter(thresholdParam);
+
+  G4UIparameter *unitParam = new G4UIparameter("unit",'s',true);
+  unitParam -> SetDefaultUnit("keV");
+  thresholdCommand -> SetParameter(unitParam);
+
+  thresholdCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  // Command will let the user see the current policy
+  printCommand = new G4UIcmdWithoutParameter("/RMatrix/stack/printPolicy",this);
+  printCommand -> SetGuidance("Print the stacking policy of every particle set so far");
+  printCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+}
+
+stackingActionMessenger::~stackingActionMessenger()
+{
+  delete printCommand;
+  delete thresholdCommand;
+  delete countOnlyCommand;
+  delete classificationCommand;
+  delete gammaCommand;
+  delete safetyCommand;
+  delete localCommand;
+  delete stackDir;
+}
+
+
+void stackingActionMessenger::SetNewValue(G4UIcommand *command,
+					  G4String newValue)
+{
+  if(command == localCommand)
+    SA -> SetLocalDeposition(newValue);
+
+  if(command == safetyCommand)
+    SA -> SetRangeSafetyFactor(safetyCommand->GetNewDoubleValue(newValue));
+
+  if(command == gammaCommand)
+    SA -> SetTrackGammas(newValue);
+
+  if(command == classificationCommand){
+    std::istringstream is(newValue);
+    G4String particle, classification;
+    is >> particle >> classification;
+    SA -> SetClassification(particle, classification);
+  }
+
+  if(command == countOnlyCommand){
+    std::istringstream is(newValue);
+    G4String particle, onOff;
+    is >> particle >> onOff;
+    SA -> SetCountOnly(particle, onOff);
+  }
+
+  if(command == thresholdCommand){
+    std::istringstream is(newValue);
+    G4String particle, unit;
+    G4double threshold;
+    is >> particle >> threshold >> unit;
+    SA -> SetEnergyThreshold(particle, threshold*G4UIcommand::ValueOf(unit));
+  }
+
+  if(command == printCommand)
+    SA -> PrintPolicies();
+}
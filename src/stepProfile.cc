@@ -0,0 +1,188 @@
+#include "G4Step.hh"
+#include "G4Track.hh"
+#include "G4VProcess.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4ios.hh"
+
+#include "stepProfile.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+G4bool stepProfile::enabled = false;
+G4String stepProfile::fileName = "stepProfile.csv";
+G4int stepProfile::samplingInterval = 16;
+G4int stepProfile::reportLength = 20;
+
+stepProfile::stepProfile(const G4String &name)
+  : G4VAccumulable(name),
+    stepCounter(0),
+    interval(samplingInterval),
+    lastTrack(nullptr),
+    lastStepNumber(0)
+{;}
+
+
+stepProfile::~stepProfile()
+{;}
+
+
+void stepProfile::Fill(const G4Step *aStep)
+{
+  const G4Track *track = aStep->GetTrack();
+  const G4StepPoint *postStep = aStep->GetPostStepPoint();
+
+  cellKey key = {track->GetDefinition(), postStep->GetProcessDefinedStep(),
+		 aStep->GetPreStepPoint()->GetPhysicalVolume()};
+  profileCell &cell = FindCell(key);
+
+  cell.steps++;
+  G4int stepNumber = track->GetCurrentStepNumber();
+  if(stepNumber == 1)
+    cell.tracks++;
+
+  // Only time a step from the end of the previous step of the same
+  // track, so that stacking, new tracks and event boundaries are left
+  // out of the sample
+  stepCounter++;
+  if(stepCounter % interval == 0
+     and lastTrack == track and lastStepNumber == stepNumber - 1){
+    std::chrono::duration<G4double> elapsed = std::chrono::steady_clock::now() - lastClock;
+    cell.timedSteps++;
+    cell.sampledTime += elapsed.count();
+  }
+
+  if((stepCounter + 1) % interval == 0){
+    lastTrack = track;
+    lastStepNumber = stepNumber;
+    lastClock = std::chrono::steady_clock::now();
+  }
+}
+
+
+stepProfile::profileCell &stepProfile::FindCell(const cellKey &key)
+{
+  std::unordered_map<cellKey, std::size_t, cellKeyHash>::const_iterator found = cellIndex.find(key);
+  if(found != cellIndex.end())
+    return cells[found->second];
+
+  profileCell cell;
+  cell.particle = key.particle->GetParticleName();
+  cell.process = key.process ? key.process->GetProcessName() : G4String("none");
+  cell.volume = key.volume ? key.volume->GetName() : G4String("none");
+  cell.steps = cell.tracks = cell.timedSteps = 0;
+  cell.sampledTime = 0.;
+
+  cellIndex[key] = cells.size();
+  cells.push_back(cell);
+  return cells.back();
+}
+
+
+stepProfile::profileCell &stepProfile::FindCell(const G4String &particle,
+						const G4String &process,
+						const G4String &volume)
+{
+  // Cells filled on this thread are indexed by name on first use
+  if(nameIndex.size() < cells.size())
+    for(std::size_t i=nameIndex.size(); i<cells.size(); i++)
+      nameIndex[cells[i].particle + "/" + cells[i].process + "/" + cells[i].volume] = i;
+
+  G4String name = particle + "/" + process + "/" + volume;
+  std::map<G4String, std::size_t>::const_iterator found = nameIndex.find(name);
+  if(found != nameIndex.end())
+    return cells[found->second];
+
+  profileCell cell;
+  cell.particle = particle;
+  cell.process = process;
+  cell.volume = volume;
+  cell.steps = cell.tracks = cell.timedSteps = 0;
+  cell.sampledTime = 0.;
+
+  nameIndex[name] = cells.size();
+  cells.push_back(cell);
+  return cells.back();
+}
+
+
+void stepProfile::Merge(const G4VAccumulable &other)
+{
+  const stepProfile &otherProfile = static_cast<const stepProfile &>(other);
+
+  for(std::size_t i=0; i<otherProfile.cells.size(); i++){
+    const profileCell &otherCell = otherProfile.cells[i];
+    profileCell &cell = FindCell(otherCell.particle, otherCell.process, otherCell.volume);
+    cell.steps += otherCell.steps;
+    cell.tracks += otherCell.tracks;
+    cell.timedSteps += otherCell.timedSteps;
+    cell.sampledTime += otherCell.sampledTime;
+  }
+}
+
+
+void stepProfile::Reset()
+{
+  cells.clear();
+  cellIndex.clear();
+  nameIndex.clear();
+
+  stepCounter = 0;
+  interval = samplingInterval;
+  lastTrack = nullptr;
+  lastStepNumber = 0;
+}
+
+
+void stepProfile::Print(G4int nCells) const
+{
+  std::vector<const profileCell *> sorted;
+  G4long totalSteps = 0;
+  G4double totalTime = 0.;
+  for(std::size_t i=0; i<cells.size(); i++){
+    sorted.push_back(&cells[i]);
+    totalSteps += cells[i].steps;
+    totalTime += cells[i].EstimatedTime();
+  }
+  std::sort(sorted.begin(), sorted.end(),
+	    [](const profileCell *a, const profileCell *b)
+	    { return a->EstimatedTime() > b->EstimatedTime(); });
+
+  G4cout << "\n Step profile: " << totalSteps << " steps, about "
+	 << totalTime << " s of stepping (1 in " << interval << " steps timed)"
+	 << "\n   " << std::setw(14) << std::left << "Particle"
+	 << std::setw(20) << "Process" << std::setw(14) << "Volume"
+	 << std::setw(14) << std::right << "Steps" << std::setw(12) << "Tracks"
+	 << std::setw(12) << "Time [s]" << std::setw(8) << "%";
+
+  G4int nPrinted = std::min(nCells, G4int(sorted.size()));
+  for(G4int i=0; i<nPrinted; i++){
+    const profileCell &cell = *sorted[i];
+    G4cout << "\n   " << std::setw(14) << std::left << cell.particle
+	   << std::setw(20) << cell.process << std::setw(14) << cell.volume
+	   << std::setw(14) << std::right << cell.steps << std::setw(12) << cell.tracks
+	   << std::setw(12) << std::setprecision(4) << cell.EstimatedTime()
+	   << std::setw(8) << std::setprecision(3)
+	   << (totalTime > 0. ? 100.*cell.EstimatedTime()/totalTime : 0.);
+  }
+  G4cout << std::setprecision(6) << G4endl;
+}
+
+
+G4bool stepProfile::Write(G4String name) const
+{
+  std::ofstream file(name.c_str());
+  if(!file.is_open())
+    return false;
+
+  file << "Particle;Process;Volume;Steps;Tracks;TimedSteps;SampledTime_s;EstimatedTime_s\n";
+  for(std::size_t i=0; i<cells.size(); i++){
+    const profileCell &cell = cells[i];
+    file << cell.particle << ";" << cell.process << ";" << cell.volume << ";"
+	 << cell.steps << ";" << cell.tracks << ";" << cell.timedSteps << ";"
+	 << cell.sampledTime << ";" << cell.EstimatedTime() << "\n";
+  }
+  return file.good();
+}
@@ -0,0 +1,74 @@
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithAnInteger.hh"
+
+#include "stepProfile.hh"
+#include "stepProfileMessenger.hh"
+
+// stepProfileMessenger lets the user find out where the CPU time of
+// a run goes, per particle, process and volume.
+
+stepProfileMessenger::stepProfileMessenger()
+{
+  profileDir = new G4UIdirectory("/RMatrix/profile/", false);
+  profileDir -> SetGuidance("CPU time attribution per particle, process and volume");
+
+  // Command will let the user turn the profile on
+  enableCommand = new G4UIcmdWithAString("/RMatrix/profile/enable",this);
+  enableCommand -> SetGuidance("Count steps and tracks and time a sample of steps");
+  enableCommand -> SetGuidance("The report is printed and written at the end of every run");
+  enableCommand -> SetParameterName("choice",true);
+  enableCommand -> SetDefaultValue("on");
+  enableCommand -> SetCandidates("on off");
+  enableCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  enableCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user name the profile file
+  fileCommand = new G4UIcmdWithAString("/RMatrix/profile/setFileName",this);
+  fileCommand -> SetGuidance("Set the file every profile cell is written to");
+  fileCommand -> SetParameterName("fileName",false);
+  fileCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  fileCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user set how many steps are timed
+  intervalCommand = new G4UIcmdWithAnInteger("/RMatrix/profile/setSamplingInterval",this);
+  intervalCommand -> SetGuidance("Time one step in every N");
+  intervalCommand -> SetParameterName("N",false);
+  intervalCommand -> SetRange("N>0");
+  intervalCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  intervalCommand -> SetToBeBroadcasted(false);
+
+  // Command will let the user set how long the printed report is
+  lengthCommand = new G4UIcmdWithAnInteger("/RMatrix/profile/setReportLength",this);
+  lengthCommand -> SetGuidance("Set how many of the most expensive cells are printed");
+  lengthCommand -> SetParameterName("nCells",false);
+  lengthCommand -> SetRange("nCells>=0");
+  lengthCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+  lengthCommand -> SetToBeBroadcasted(false);
+}
+
+stepProfileMessenger::~stepProfileMessenger()
+{
+  delete lengthCommand;
+  delete intervalCommand;
+  delete fileCommand;
+  delete enableCommand;
+  delete profileDir;
+}
+
+
+void stepProfileMessenger::SetNewValue(G4UIcommand *command,
+				       G4String newValue)
+{
+  if(command == enableCommand)
+    stepProfile::SetEnabled(newValue);
+
+  if(command == fileCommand)
+    stepProfile::SetFileName(newValue);
+
+  if(command == intervalCommand)
+    stepProfile::SetSamplingInterval(intervalCommand->GetNewIntValue(newValue));
+
+  if(command == lengthCommand)
+    stepProfile::SetReportLength(lengthCommand->GetNewIntValue(newValue));
+}
@@ -0,0 +1,164 @@
+#include "G4Step.hh"
+#include "G4Track.hh"
+#include "G4Neutron.hh"
+#include "G4OpticalPhoton.hh"
+#include "G4OpBoundaryProcess.hh"
+#include "G4ProcessManager.hh"
+#include "Randomize.hh"
+#include "G4LogicalVolume.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4RunManager.hh"
+#include "G4Tubs.hh"
+#include "G4TouchableHistory.hh"
+#include "G4AffineTransform.hh"
+
+#include "steppingAction.hh"
+#include "steppingActionMessenger.hh"
+#include "geometryConstruction.hh"
+#include "runAction.hh"
+#include "eventAction.hh"
+#include "neutronResponseModel.hh"
+#include "lightCollectionMap.hh"
+
+steppingAction::steppingAction(runAction *currentRun, eventAction *currentEvent)
+  : rnAction(currentRun),
+    evtAction(currentEvent),
+    boundaryProcess(nullptr),
+    killNeutronsOnExit(false),
+    neutronThreshold(0.)
+{
+  neutronDef = G4Neutron::NeutronDefinition();
+  opticalPhotonDef = G4OpticalPhoton::OpticalPhotonDefinition();
+
+  // The detector construction is shared by all threads and keeps
+  // track of the volumes of the current geometry
+  geometry = static_cast<const geometryConstruction *>
+    (G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+
+  // Create a messenger to allow user commands
+  stepMessenger = new steppingActionMessenger(this);
+}
+
+
+steppingAction::~steppingAction()
+{ delete stepMessenger; }
+
+
+void steppingAction::UserSteppingAction(const G4Step *aStep)
+{
+  stepProfile *profile = rnAction->GetStepProfile();
+  if(profile)
+    profile->Fill(aStep);
+
+  if(lightCollectionMap::GetMode() != lightCollectionMap::collectionOff)
+    CollectLight(aStep);
+
+  G4Track *track = aStep->GetTrack();
+  if(track->GetDefinition() != neutronDef)
+    return;
+
+  // Record the first entry of the primary neutron into the scintillator,
+  // in the cylinder's own frame
+  if(neutronResponseModel::IsRecordingEntries() and track->GetParentID() == 0
+     and !evtAction->HasNeutronEntry()){
+    const G4StepPoint *postStep = aStep->GetPostStepPoint();
+    const G4VPhysicalVolume *postVolume = postStep->GetPhysicalVolume();
+    if(postStep->GetStepStatus() == fGeomBoundary and postVolume
+       and postVolume->GetLogicalVolume() == geometry->GetScintVolume()){
+      const G4AffineTransform &toLocal = postStep->GetTouchable()->GetHistory()->GetTopTransform();
+      const G4Tubs *cylinder = static_cast<const G4Tubs *>(geometry->GetScintVolume()->GetSolid());
+      evtAction->SetNeutronEntry(postStep->GetKineticEnergy(),
+				 toLocal.TransformPoint(postStep->GetPosition()),
+				 toLocal.TransformAxis(postStep->GetMomentumDirection()),
+				 cylinder->GetOuterRadius(), cylinder->GetZHalfLength(),
+				 postStep->GetWeight());
+    }
+  }
+
+  // A neutron this slow can no longer make recoils that give useful
+  // light, so stop it before the long thermal tail and the capture
+  if(track->GetKineticEnergy() < neutronThreshold
+     and track->GetTrackStatus() == fAlive){
+    rnAction->AddKilledNeutron(track->GetKineticEnergy(), track->GetWeight());
+    track->SetTrackStatus(fStopAndKill);
+    return;
+  }
+
+  if(!killNeutronsOnExit)
+    return;
+
+  // Only a step that ends on the envelope boundary can leave it
+  const G4StepPoint *postStep = aStep->GetPostStepPoint();
+  if(postStep->GetStepStatus() != fGeomBoundary)
+    return;
+
+  const G4VPhysicalVolume *postVolume = postStep->GetPhysicalVolume();
+  if(postVolume == nullptr)
+    return;
+
+  // Stepping from the envelope into its mother means the neutron has
+  // left the detectors for good
+  if(aStep->GetPreStepPoint()->GetPhysicalVolume()->GetLogicalVolume() == geometry->GetEnvelopeVolume()
+     and postVolume->GetLogicalVolume() == geometry->GetWorldVolume())
+    track->SetTrackStatus(fStopAndKill);
+}
+
+
+void steppingAction::CollectLight(const G4Step *aStep)
+{
+  // Only light made in (or crossing) the scintillator matters
+  const G4StepPoint *preStep = aStep->GetPreStepPoint();
+  if(preStep->GetPhysicalVolume()->GetLogicalVolume() != geometry->GetScintVolume())
+    return;
+
+  const G4AffineTransform &toLocal = preStep->GetTouchable()->GetHistory()->GetTopTransform();
+  G4Track *track = aStep->GetTrack();
+
+  if(lightCollectionMap::GetMode() == lightCollectionMap::collectionCalibrate){
+    // A calibration photon is collected when it gets through the
+    // coupling into the readout window; the wrapping reflects or
+    // absorbs it everywhere else.  The post-step volume is the window
+    // whether the photon went through or was reflected, so the
+    // boundary process has the last word
+    const G4StepPoint *postStep = aStep->GetPostStepPoint();
+    if(track->GetDefinition() != opticalPhotonDef or postStep->GetStepStatus() != fGeomBoundary
+       or postStep->GetPhysicalVolume() == nullptr
+       or postStep->GetPhysicalVolume()->GetLogicalVolume() != geometry->GetReadoutVolume())
+      return;
+
+    if(boundaryProcess == nullptr){
+      G4ProcessVector *processes = opticalPhotonDef->GetProcessManager()->GetProcessList();
+      for(std::size_t i=0; i<processes->size(); i++)
+	if((*processes)[i]->GetProcessName() == "OpBoundary")
+	  boundaryProcess = static_cast<G4OpBoundaryProcess *>((*processes)[i]);
+    }
+    G4OpBoundaryProcessStatus status = boundaryProcess ? boundaryProcess->GetStatus() : Undefined;
+    if(status != FresnelRefraction and status != Transmission)
+      return;
+
+    evtAction->AddPhotonCollected(1, track->GetWeight(), preStep->GetTouchable()->GetCopyNumber());
+    track->SetTrackStatus(fStopAndKill);
+    return;
+  }
+
+  const lightCollectionMap *map = lightCollectionMap::GetMap();
+  std::size_t nSecondaries = aStep->GetNumberOfSecondariesInCurrentStep();
+  if(map == nullptr or nSecondaries == 0)
+    return;
+
+  G4int nPhotons = 0;
+  for(const G4Track *secondary : *aStep->GetSecondaryInCurrentStep())
+    if(secondary->GetDefinition() == opticalPhotonDef)
+      nPhotons++;
+  if(nPhotons == 0)
+    return;
+
+  // The photons of a step are spread along it; take them all from its
+  // middle, then collect each with the map's probability there
+  G4ThreeVector midPoint = 0.5*(preStep->GetPosition() + aStep->GetPostStepPoint()->GetPosition());
+  G4double probability = map->GetProbability(toLocal.TransformPoint(midPoint));
+  G4int nCollected = G4int(CLHEP::RandBinomial::shoot(nPhotons, probability));
+  if(nCollected > 0)
+    evtAction->AddPhotonCollected(nCollected, track->GetWeight(), preStep->GetTouchable()->GetCopyNumber(),
+				  evtAction->GetTrackOrigin(track->GetTrackID()));
+}
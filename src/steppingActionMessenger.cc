@@ -0,0 +1,52 @@
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+
+#include "steppingAction.hh"
+#include "steppingActionMessenger.hh"
+
+// steppingActionMessenger is how the user can switch the tracking
+// policies of steppingAction at runtime.
+
+steppingActionMessenger::steppingActionMessenger(steppingAction *theSteppingAction)
+  : SA(theSteppingAction)
+{
+  // Creates a new directory where the commands will live
+  trackingDir = new G4UIdirectory("/RMatrix/tracking/");
+  trackingDir -> SetGuidance("Track termination policies");
+
+  // Command will let the user kill neutrons leaving the envelope
+  killOnExitCommand = new G4UIcmdWithAString("/RMatrix/tracking/killNeutronsOnExit",this);
+  killOnExitCommand -> SetGuidance("Kill neutrons leaving the envelope around the detectors");
+  killOnExitCommand -> SetParameterName("choice",true);
+  killOnExitCommand -> SetDefaultValue("on");
+  killOnExitCommand -> SetCandidates("on off");
+  killOnExitCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  // Command will let the user kill neutrons below a kinetic energy
+  thresholdCommand = new G4UIcmdWithADoubleAndUnit("/RMatrix/tracking/setNeutronThreshold",this);
+  thresholdCommand -> SetGuidance("Kill neutrons whose kinetic energy falls below this value");
+  thresholdCommand -> SetGuidance("A threshold of 0 (the default) follows neutrons to the end");
+  thresholdCommand -> SetParameterName("threshold",false);
+  thresholdCommand -> SetRange("threshold>=0.");
+  thresholdCommand -> SetUnitCategory("Energy");
+  thresholdCommand -> AvailableForStates(G4State_PreInit, G4State_Idle);
+}
+
+steppingActionMessenger::~steppingActionMessenger()
+{
+  delete thresholdCommand;
+  delete killOnExitCommand;
+  delete trackingDir;
+}
+
+
+void steppingActionMessenger::SetNewValue(G4UIcommand *command,
+					  G4String newValue)
+{
+  if(command == killOnExitCommand)
+    SA -> SetKillOnExit(newValue);
+
+  if(command == thresholdCommand)
+    SA -> SetNeutronThreshold(thresholdCommand->GetNewDoubleValue(newValue));
+}
@@ -0,0 +1,81 @@
+#include "traceRecorder.hh"
+
+#ifdef RMATRIX_TRACING
+
+#include "G4Threading.hh"
+#include "G4AutoLock.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+
+namespace
+{
+  G4Mutex registryMutex = G4MUTEX_INITIALIZER;
+  std::vector<std::unique_ptr<traceRecorder::traceBuffer>> registry;
+}
+
+traceRecorder::traceBuffer &traceRecorder::ThreadBuffer()
+{
+  static G4ThreadLocal traceBuffer *buffer = nullptr;
+  if(buffer == nullptr){
+    buffer = new traceBuffer;
+    buffer->threadID = G4Threading::G4GetThreadId();
+    buffer->spans.resize(bufferSize);
+    buffer->nRecorded = 0;
+
+    G4AutoLock lock(&registryMutex);
+    registry.emplace_back(buffer);
+  }
+  return *buffer;
+}
+
+
+void traceRecorder::Write(const G4String &fileName)
+{
+  std::ofstream file(fileName.c_str());
+  if(!file.is_open()){
+    G4Exception("traceRecorder::Write()",
+		"traceRecorder-001",
+		JustWarning,
+		("Could not write the trace to " + fileName).c_str());
+    return;
+  }
+
+  // Workers are idle between runs, so their buffers can be read as
+  // they are.  The master is shown as thread 0, worker n as n+1
+  G4AutoLock lock(&registryMutex);
+
+  file << std::fixed << std::setprecision(3);
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  G4bool first = true;
+  for(const std::unique_ptr<traceBuffer> &buffer : registry){
+    G4int tid = buffer->threadID + 1;
+    file << (first ? "" : ",\n")
+	 << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << tid
+	 << ",\"args\":{\"name\":\""
+	 << (tid == 0 ? G4String("master") : "worker " + std::to_string(tid - 1)) << "\"}}";
+    first = false;
+
+    // Oldest first, once the ring has wrapped
+    std::size_t size = buffer->spans.size();
+    std::size_t nSpans = std::min(buffer->nRecorded, size);
+    std::size_t begin = buffer->nRecorded - nSpans;
+    for(std::size_t i=begin; i<buffer->nRecorded; i++){
+      const traceSpan &span = buffer->spans[i % size];
+      file << ",\n{\"name\":\"" << span.name << "\",\"cat\":\"RMatrix\",\"ph\":\"X\",\"pid\":0,\"tid\":" << tid
+	   << ",\"ts\":" << span.start/1000. << ",\"dur\":" << span.duration/1000. << "}";
+    }
+
+    if(buffer->nRecorded > size)
+      G4cout << " Trace of thread " << tid << " kept the last " << size
+	     << " of " << buffer->nRecorded << " spans" << G4endl;
+  }
+  file << "\n]}\n";
+
+  G4cout << " Trace written to " << fileName << G4endl;
+}
+
+#endif
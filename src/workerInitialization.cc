@@ -0,0 +1,188 @@
+#include "G4Threading.hh"
+#include "G4AutoLock.hh"
+#include "G4ios.hh"
+
+#include "workerInitialization.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+namespace
+{
+  G4Mutex placementMutex = G4MUTEX_INITIALIZER;
+
+  // From <linux/mempolicy.h>, which is not always installed
+  const int mpolLocal = 4;
+
+  // Parses a kernel CPU list such as "0-15,32-47"
+  std::vector<G4int> ParseCPUList(const std::string &list)
+  {
+    std::vector<G4int> cpus;
+    std::istringstream is(list);
+    std::string range;
+    while(std::getline(is, range, ',')){
+      std::size_t dash = range.find('-');
+      try{
+	G4int first = std::stoi(range.substr(0, dash));
+	G4int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+	for(G4int cpu=first; cpu<=last; cpu++)
+	  cpus.push_back(cpu);
+      }
+      catch(const std::exception &){;}
+    }
+    return cpus;
+  }
+}
+
+G4bool workerInitialization::pinThreads = false;
+G4bool workerInitialization::numaPlacement = false;
+std::vector<G4int> workerInitialization::cpuOrder;
+std::vector<G4int> workerInitialization::cpuNode;
+std::vector<workerInitialization::placement> workerInitialization::placements;
+
+workerInitialization::workerInitialization()
+{
+  // Read the topology once, on the master, before any worker starts
+  if(IsPinning())
+    FindCPUs();
+}
+
+
+workerInitialization::~workerInitialization()
+{;}
+
+
+void workerInitialization::WorkerInitialize() const
+{
+  if(IsPinning())
+    PlaceThread(G4Threading::G4GetThreadId());
+}
+
+
+void workerInitialization::FindCPUs()
+{
+  cpuOrder.clear();
+  cpuNode.clear();
+
+#ifdef __linux__
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    return;
+
+  // NUMA nodes from sysfs; without them everything is node 0
+  std::vector<std::vector<G4int>> nodeCPUs;
+  for(G4int node=0; ; node++){
+    std::ifstream list(("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist").c_str());
+    if(!list.is_open())
+      break;
+    std::string line;
+    std::getline(list, line);
+    nodeCPUs.push_back(ParseCPUList(line));
+  }
+  if(nodeCPUs.empty()){
+    nodeCPUs.resize(1);
+    for(G4int cpu=0; cpu<CPU_SETSIZE; cpu++)
+      nodeCPUs[0].push_back(cpu);
+  }
+
+  for(std::vector<G4int> &cpus : nodeCPUs)
+    cpus.erase(std::remove_if(cpus.begin(), cpus.end(),
+			      [&allowed](G4int cpu){ return !CPU_ISSET(cpu, &allowed); }),
+	       cpus.end());
+
+  // Compact: node by node.  NUMA: one CPU of each node in turn
+  if(numaPlacement){
+    std::size_t longest = 0;
+    for(const std::vector<G4int> &cpus : nodeCPUs)
+      longest = std::max(longest, cpus.size());
+    for(std::size_t i=0; i<longest; i++)
+      for(std::size_t node=0; node<nodeCPUs.size(); node++)
+	if(i < nodeCPUs[node].size()){
+	  cpuOrder.push_back(nodeCPUs[node][i]);
+	  cpuNode.push_back(G4int(node));
+	}
+  }
+  else{
+    for(std::size_t node=0; node<nodeCPUs.size(); node++)
+      for(G4int cpu : nodeCPUs[node]){
+	cpuOrder.push_back(cpu);
+	cpuNode.push_back(G4int(node));
+      }
+  }
+#else
+  G4Exception("workerInitialization::FindCPUs()",
+	      "workerInitialization-001",
+	      JustWarning,
+	      "Thread pinning is only supported on Linux, threads are left unpinned");
+#endif
+}
+
+
+void workerInitialization::PlaceThread(G4int workerID)
+{
+  if(cpuOrder.empty())
+    return;
+
+  // The master (or the only thread of a sequential run) has id -1
+  std::size_t index = std::size_t(std::max(workerID, 0)) % cpuOrder.size();
+  G4int cpu = cpuOrder[index];
+  G4int node = cpuNode[index];
+
+#ifdef __linux__
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  CPU_SET(cpu, &mask);
+  if(pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask) != 0){
+    G4Exception("workerInitialization::PlaceThread()",
+		"workerInitialization-002",
+		JustWarning,
+		("Could not pin worker " + std::to_string(workerID) + " to CPU " + std::to_string(cpu)).c_str());
+    return;
+  }
+
+  // Allocate on the node the thread runs on from now on
+  if(numaPlacement)
+    syscall(SYS_set_mempolicy, mpolLocal, nullptr, 0);
+
+  // Report where the thread actually is, once the move has happened
+  cpu = sched_getcpu();
+  std::vector<G4int>::const_iterator found = std::find(cpuOrder.begin(), cpuOrder.end(), cpu);
+  if(found != cpuOrder.end())
+    node = cpuNode[found - cpuOrder.begin()];
+#endif
+
+  G4AutoLock lock(&placementMutex);
+  placements.push_back({workerID, cpu, node});
+}
+
+
+void workerInitialization::ReportPlacement()
+{
+  if(!IsPinning())
+    return;
+
+  G4AutoLock lock(&placementMutex);
+  std::sort(placements.begin(), placements.end(),
+	    [](const placement &a, const placement &b){ return a.workerID < b.workerID; });
+
+  G4int nNodes = 0;
+  for(G4int node : cpuNode)
+    nNodes = std::max(nNodes, node + 1);
+
+  G4cout << "\n Thread placement (" << (numaPlacement ? "NUMA spread" : "compact")
+	 << ", " << cpuOrder.size() << " CPUs on " << nNodes << " node(s)):";
+  for(const placement &place : placements)
+    G4cout << "\n   " << (place.workerID < 0 ? G4String("main") : "worker " + std::to_string(place.workerID))
+	   << " -> CPU " << place.cpu << ", node " << place.node;
+  G4cout << G4endl;
+}